@@ -0,0 +1,68 @@
+// QOI against BMP on the task pool, encode then decode of the same synthetic image
+// usage: node bench/qoi.js [WxH] [rounds], runs 1920x1080 and 3840x2160 by default
+
+var sdl = require('../node-sdl2.js');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+var sizes = (process.argv[2] || "1920x1080,3840x2160").split(",").map(function(size) {
+  var wh = size.split("x");
+  return { w: parseInt(wh[0], 10), h: parseInt(wh[1] || wh[0], 10) };
+});
+var rounds = parseInt(process.argv[3] || "10", 10);
+var dir = os.tmpdir();
+
+// flat bands with noisy strips, roughly what screenshots and UI art look like
+function image(w, h) {
+  var surface = sdl.SDL_CreateRGBSurface(0, w, h, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+  for (var y = 0; y < h; y += 16) {
+    sdl.SDL_FillRect(surface, new sdl.SDL_Rect(0, y, w, 16), 0xff000000 | ((y * 2654435761) >>> 8));
+  }
+  for (var y = 0; y < h; y += 64) {
+    for (var x = 0; x < w; ++x) {
+      sdl.SDL_PutPixel(surface, x, y, (Math.random() * 0xffffffff) >>> 0);
+    }
+  }
+  return surface;
+}
+
+function ms(start) {
+  var t = process.hrtime(start);
+  return t[0] * 1e3 + t[1] / 1e6;
+}
+
+function run(label, surface, save, load, file) {
+  var save_ms = 0, load_ms = 0;
+  function round(index) {
+    if (index === rounds) {
+      var bytes = fs.statSync(file).size;
+      console.log(label + ": save " + (save_ms / rounds).toFixed(2) + " ms, load " + (load_ms / rounds).toFixed(2) + " ms, " + bytes + " bytes");
+      fs.unlinkSync(file);
+      return Promise.resolve();
+    }
+    var start = process.hrtime();
+    return save(surface, file).then(function() {
+      save_ms += ms(start);
+      start = process.hrtime();
+      return load(file);
+    }).then(function(loaded) {
+      load_ms += ms(start);
+      sdl.SDL_FreeSurface(loaded);
+      return round(index + 1);
+    });
+  }
+  return round(0);
+}
+
+sizes.reduce(function(done, size) {
+  return done.then(function() {
+    var name = size.w + "x" + size.h;
+    var surface = image(size.w, size.h);
+    return run(name + " bmp", surface, sdl.SDL_EXT_SaveBMPPromise, sdl.SDL_EXT_LoadBMPPromise, path.join(dir, "node-sdl2-bench.bmp")).then(function() {
+      return run(name + " qoi", surface, sdl.SDL_EXT_SaveQOIPromise, sdl.SDL_EXT_LoadQOIPromise, path.join(dir, "node-sdl2-bench.qoi"));
+    }).then(function() {
+      sdl.SDL_FreeSurface(surface);
+    });
+  });
+}, Promise.resolve());
@@ -0,0 +1,67 @@
+// tiled against serial command buffer replay into a software renderer, and a pixel check of the two
+// usage: node bench/tiled.js [size] [rects] [rounds]
+
+var sdl = require('../node-sdl2.js');
+
+var size = parseInt(process.argv[2] || "2048", 10);
+var count = parseInt(process.argv[3] || "20000", 10);
+var rounds = parseInt(process.argv[4] || "20", 10);
+
+// a clear, then blended filled rects and points in a few colors, with a clip change midway
+var command_buffer = sdl.SDL_EXT_CreateRenderCommandBuffer(16 + count * 16, 0);
+var words = new Int32Array(command_buffer.buffer);
+var length = 0;
+function emit() {
+  for (var i = 0; i < arguments.length; ++i) { words[length++] = arguments[i]; }
+}
+function random(n) { return Math.floor(Math.random() * n); }
+emit(sdl.SDL_EXT_RCMD_SET_COLOR, 16, 16, 32, 255);
+emit(sdl.SDL_EXT_RCMD_CLEAR);
+emit(sdl.SDL_EXT_RCMD_SET_BLEND, sdl.SDL_BlendMode.SDL_BLENDMODE_BLEND);
+for (var i = 0; i < count; ++i) {
+  if (i === (count >> 1)) { emit(sdl.SDL_EXT_RCMD_SET_CLIP, size >> 3, size >> 3, size >> 1, size >> 1); }
+  if ((i % 64) === 0) { emit(sdl.SDL_EXT_RCMD_SET_COLOR, random(256), random(256), random(256), 64 + random(192)); }
+  if ((i % 4) === 0) { emit(sdl.SDL_EXT_RCMD_POINT, random(size), random(size)); }
+  else { emit(sdl.SDL_EXT_RCMD_FILL_RECT, random(size) - 32, random(size) - 32, 1 + random(96), 1 + random(96)); }
+}
+
+function target() {
+  var surface = sdl.SDL_CreateRGBSurface(0, size, size, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+  return { surface: surface, renderer: sdl.SDL_CreateSoftwareRenderer(surface) };
+}
+var serial = target();
+var tiled = target();
+
+function ms(start) {
+  var t = process.hrtime(start);
+  return t[0] * 1e3 + t[1] / 1e6;
+}
+
+function time(name, submit) {
+  submit(); // warm up, the tiled path creates its band renderers here
+  var start = process.hrtime();
+  for (var round = 0; round < rounds; ++round) { submit(); }
+  console.log(name + ": " + (ms(start) / rounds).toFixed(2) + " ms");
+}
+
+time("serial", function() {
+  sdl.SDL_EXT_RenderCommandBufferSubmit(command_buffer, serial.renderer, length);
+  sdl.SDL_RenderPresent(serial.renderer);
+});
+time("tiled", function() {
+  sdl.SDL_EXT_RenderCommandBufferSubmitTiled(command_buffer, tiled.renderer, tiled.surface, length);
+  sdl.SDL_RenderPresent(tiled.renderer);
+});
+
+var a = sdl.SDL_EXT_SurfaceToImageData(serial.surface).data;
+var b = sdl.SDL_EXT_SurfaceToImageData(tiled.surface).data;
+var mismatch = 0;
+for (var i = 0; i < a.length; ++i) { if (a[i] !== b[i]) { ++mismatch; } }
+console.log((mismatch === 0) ? "pixels match" : (mismatch + " bytes differ"));
+
+[serial, tiled].forEach(function(t) {
+  sdl.SDL_DestroyRenderer(t.renderer);
+  sdl.SDL_FreeSurface(t.surface);
+});
+sdl.SDL_EXT_DestroyRenderCommandBuffer(command_buffer);
+process.exitCode = (mismatch === 0) ? 0 : 1;
@@ -0,0 +1,69 @@
+// WAV loads on the task pool, as stored and converted to a 48 kHz float device spec
+// usage: node bench/wav.js [files] [max seconds], loads 500 distinct files of varied length and format by default
+
+var sdl = require('../node-sdl2.js');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+var files = parseInt(process.argv[2] || "500", 10);
+var max_seconds = parseFloat(process.argv[3] || "2");
+var dir = fs.mkdtempSync(path.join(os.tmpdir(), "node-sdl2-bench-"));
+
+// a sound bank mixes rates, channel counts and sample formats, from short clicks to longer loops
+var freqs = [ 22050, 44100, 48000 ];
+var shapes = [ { tag: 1, bits: 8 }, { tag: 1, bits: 16 }, { tag: 3, bits: 32 } ]; // unsigned 8, signed 16, float 32
+
+function write(file, freq, channels, shape, frames) {
+  var sample_size = shape.bits / 8;
+  var data_size = frames * channels * sample_size;
+  var wav = Buffer.alloc(44 + data_size);
+  wav.write("RIFF", 0); wav.writeUInt32LE(36 + data_size, 4); wav.write("WAVE", 8);
+  wav.write("fmt ", 12); wav.writeUInt32LE(16, 16); wav.writeUInt16LE(shape.tag, 20); wav.writeUInt16LE(channels, 22);
+  wav.writeUInt32LE(freq, 24); wav.writeUInt32LE(freq * channels * sample_size, 28); wav.writeUInt16LE(channels * sample_size, 32); wav.writeUInt16LE(shape.bits, 34);
+  wav.write("data", 36); wav.writeUInt32LE(data_size, 40);
+  for (var i = 0; i < frames * channels; ++i) {
+    var offset = 44 + i * sample_size;
+    if (shape.bits === 8) { wav.writeUInt8((Math.random() * 256) | 0, offset); }
+    else if (shape.bits === 16) { wav.writeInt16LE(((Math.random() * 65536) | 0) - 32768, offset); }
+    else { wav.writeFloatLE(Math.random() * 2 - 1, offset); }
+  }
+  fs.writeFileSync(file, wav);
+}
+
+var paths = [];
+for (var i = 0; i < files; ++i) {
+  var freq = freqs[i % freqs.length];
+  var channels = 1 + ((i >> 1) & 1);
+  var shape = shapes[Math.floor(i / 4) % shapes.length];
+  var seconds = 0.05 + Math.random() * (max_seconds - 0.05);
+  var file = path.join(dir, "sound-" + i + ".wav");
+  write(file, freq, channels, shape, Math.floor(seconds * freq));
+  paths.push(file);
+}
+
+function ms(start) {
+  var t = process.hrtime(start);
+  return t[0] * 1e3 + t[1] / 1e6;
+}
+
+// every file at once, like a level's sound bank
+function run(name, load) {
+  var start = process.hrtime();
+  return Promise.all(paths.map(load)).then(function(results) {
+    var elapsed = ms(start);
+    var bytes = results.reduce(function(sum, result) { return sum + result.data.length; }, 0);
+    console.log(name + ": " + elapsed.toFixed(2) + " ms for " + files + " files, " + (elapsed / files).toFixed(3) + " ms per file, " + bytes + " bytes");
+  });
+}
+
+run("load", function(file) {
+  return sdl.SDL_EXT_LoadWAVPromise(file);
+}).then(function() {
+  return run("load as f32 48k", function(file) {
+    return sdl.SDL_EXT_LoadWAVAsPromise(file, { freq: 48000, format: sdl.AUDIO_F32SYS, channels: 2 });
+  });
+}).then(function() {
+  paths.forEach(function(file) { fs.unlinkSync(file); });
+  fs.rmdirSync(dir);
+});
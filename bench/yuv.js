@@ -0,0 +1,44 @@
+// SDL_EXT_ConvertYUV on I420 and NV12 frames, milliseconds per frame
+// usage: node bench/yuv.js [WxH] [rounds], runs 1280x720, 1920x1080 and 3840x2160 by default
+
+var sdl = require('../node-sdl2.js');
+
+var sizes = (process.argv[2] || "1280x720,1920x1080,3840x2160").split(",").map(function(size) {
+  var wh = size.split("x");
+  return { w: parseInt(wh[0], 10), h: parseInt(wh[1] || wh[0], 10) };
+});
+var rounds = parseInt(process.argv[3] || "100", 10);
+
+function noise(length) {
+  var plane = new Uint8Array(length);
+  for (var i = 0; i < length; ++i) { plane[i] = (Math.random() * 256) | 0; }
+  return plane;
+}
+
+function ms(start) {
+  var t = process.hrtime(start);
+  return t[0] * 1e3 + t[1] / 1e6;
+}
+
+function time(name, convert) {
+  convert(); // warm up, starts the fork-join pool
+  var start = process.hrtime();
+  for (var round = 0; round < rounds; ++round) { convert(); }
+  console.log(name + ": " + (ms(start) / rounds).toFixed(3) + " ms");
+}
+
+sizes.forEach(function(size) {
+  var w = size.w, h = size.h;
+  var chroma_w = (w + 1) >> 1, chroma_h = (h + 1) >> 1;
+  var dst = new Uint8Array(w * h * 4);
+  var y = noise(w * h);
+  var u = noise(chroma_w * chroma_h);
+  var v = noise(chroma_w * chroma_h);
+  var uv = noise(2 * chroma_w * chroma_h);
+  time("i420 " + w + "x" + h, function() {
+    sdl.SDL_EXT_ConvertYUV(dst, w * 4, w, h, y, w, u, chroma_w, v, chroma_w, sdl.SDL_EXT_YUV_BT601, false);
+  });
+  time("nv12 " + w + "x" + h, function() {
+    sdl.SDL_EXT_ConvertYUV(dst, w * 4, w, h, y, w, uv, 2 * chroma_w, null, 0, sdl.SDL_EXT_YUV_BT709, false);
+  });
+});
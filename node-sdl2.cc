@@ -31,8 +31,30 @@
 #define printf(...) __android_log_print(ANDROID_LOG_INFO, "printf", __VA_ARGS__)
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define _SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define _SIMD_NEON 1
+#endif
+
 #define countof(_a) (sizeof(_a)/sizeof((_a)[0]))
 
+// data and byte size of a typed array argument, before node 4 the size is in elements
+static void* _TypedArrayData(v8::Local<v8::Value> value, size_t* byte_length)
+{
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	v8::Local<v8::TypedArray> array = v8::Local<v8::TypedArray>::Cast(value);
+	*byte_length = array->ByteLength();
+	return static_cast<char*>(array->Buffer()->GetContents().Data()) + array->ByteOffset();
+	#else
+	v8::Local<v8::Object> array = v8::Local<v8::Object>::Cast(value);
+	*byte_length = array->GetIndexedPropertiesExternalArrayDataLength();
+	return array->GetIndexedPropertiesExternalArrayData();
+	#endif
+}
+
 static ::Uint32 _SDL_GetPixel(SDL_Surface* surface, int x, int y)
 {
 	::Uint32 pixel = 0;
@@ -105,6 +127,456 @@ static void _SDL_PutPixel(SDL_Surface* surface, int x, int y, ::Uint32 pixel)
 	}
 }
 
+// QOI image format, see https://qoiformat.org/qoi-specification.pdf
+
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define _QOI_PIXELFORMAT_RGBA SDL_PIXELFORMAT_ABGR8888 // bytes r, g, b, a
+#else
+#define _QOI_PIXELFORMAT_RGBA SDL_PIXELFORMAT_RGBA8888 // bytes r, g, b, a
+#endif
+
+#define _QOI_OP_INDEX 0x00
+#define _QOI_OP_DIFF 0x40
+#define _QOI_OP_LUMA 0x80
+#define _QOI_OP_RUN 0xc0
+#define _QOI_OP_RGB 0xfe
+#define _QOI_OP_RGBA 0xff
+#define _QOI_MASK_2 0xc0
+#define _QOI_HEADER_SIZE 14
+#define _QOI_PIXELS_MAX 400000000 // same limit as the reference codec
+#define _QOI_HASH(px) (((px)[0] * 3 + (px)[1] * 5 + (px)[2] * 7 + (px)[3] * 11) % 64)
+
+static const ::Uint8 _qoi_padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+// buffered RWops access, SDL_RWread/SDL_RWwrite per byte is far too slow
+
+struct _QOIStream
+{
+	SDL_RWops* rw;
+	size_t pos;
+	size_t len;
+	bool failed;
+	::Uint8 buf[64 * 1024];
+};
+
+static inline ::Uint8 _QOI_ReadByte(_QOIStream* s)
+{
+	if (s->pos == s->len)
+	{
+		s->pos = 0;
+		s->len = (s->failed)?(0):(SDL_RWread(s->rw, s->buf, 1, sizeof(s->buf)));
+		if (s->len == 0) { s->failed = true; return 0; }
+	}
+	return s->buf[s->pos++];
+}
+
+static void _QOI_Flush(_QOIStream* s)
+{
+	if (!s->failed && (s->pos > 0) && (SDL_RWwrite(s->rw, s->buf, 1, s->pos) != s->pos)) { s->failed = true; }
+	s->pos = 0;
+}
+
+static inline void _QOI_WriteByte(_QOIStream* s, ::Uint8 value)
+{
+	if (s->pos == sizeof(s->buf)) { _QOI_Flush(s); }
+	s->buf[s->pos++] = value;
+}
+
+static void _QOI_WriteBytes(_QOIStream* s, const ::Uint8* data, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) { _QOI_WriteByte(s, data[i]); }
+}
+
+// like SDL_LoadBMP_RW, returns an RGBA32 or RGB24 surface
+
+static SDL_Surface* _SDL_EXT_LoadQOI_RW(SDL_RWops* src, int freesrc)
+{
+	if (!src) { return NULL; } // SDL_RWFromFile has set the error
+	SDL_Surface* surface = NULL;
+	_QOIStream* s = static_cast<_QOIStream*>(SDL_malloc(sizeof(_QOIStream)));
+	::Uint8 header[_QOI_HEADER_SIZE];
+	if (!s)
+	{
+		SDL_OutOfMemory();
+	}
+	else if (SDL_RWread(src, header, 1, sizeof(header)) != sizeof(header))
+	{
+		SDL_SetError("QOI: truncated header");
+	}
+	else if ((header[0] != 'q') || (header[1] != 'o') || (header[2] != 'i') || (header[3] != 'f'))
+	{
+		SDL_SetError("QOI: bad magic");
+	}
+	else
+	{
+		::Uint32 w = (static_cast< ::Uint32 >(header[4]) << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
+		::Uint32 h = (static_cast< ::Uint32 >(header[8]) << 24) | (header[9] << 16) | (header[10] << 8) | header[11];
+		int channels = header[12];
+		if ((w == 0) || (h == 0) || ((channels != 3) && (channels != 4)) || (h >= (_QOI_PIXELS_MAX / w)))
+		{
+			SDL_SetError("QOI: bad header");
+		}
+		else
+		{
+			::Uint32 format = (channels == 4)?(_QOI_PIXELFORMAT_RGBA):(SDL_PIXELFORMAT_RGB24);
+			int depth = 0; ::Uint32 Rmask = 0, Gmask = 0, Bmask = 0, Amask = 0;
+			SDL_PixelFormatEnumToMasks(format, &depth, &Rmask, &Gmask, &Bmask, &Amask);
+			surface = SDL_CreateRGBSurface(0, w, h, depth, Rmask, Gmask, Bmask, Amask);
+		}
+	}
+	if (surface)
+	{
+		s->rw = src; s->pos = s->len = 0; s->failed = false;
+		::Uint8 index[64][4]; SDL_memset(index, 0, sizeof(index));
+		::Uint8 px[4] = { 0, 0, 0, 255 };
+		int run = 0;
+		int bpp = surface->format->BytesPerPixel;
+		for (int y = 0; (y < surface->h) && !s->failed; ++y)
+		{
+			::Uint8* row = static_cast< ::Uint8* >(surface->pixels) + y * surface->pitch;
+			for (int x = 0; x < surface->w; ++x, row += bpp)
+			{
+				if (run > 0)
+				{
+					--run;
+				}
+				else
+				{
+					int b1 = _QOI_ReadByte(s);
+					if (b1 == _QOI_OP_RGB)
+					{
+						px[0] = _QOI_ReadByte(s); px[1] = _QOI_ReadByte(s); px[2] = _QOI_ReadByte(s);
+					}
+					else if (b1 == _QOI_OP_RGBA)
+					{
+						px[0] = _QOI_ReadByte(s); px[1] = _QOI_ReadByte(s); px[2] = _QOI_ReadByte(s); px[3] = _QOI_ReadByte(s);
+					}
+					else if ((b1 & _QOI_MASK_2) == _QOI_OP_INDEX)
+					{
+						SDL_memcpy(px, index[b1], 4);
+					}
+					else if ((b1 & _QOI_MASK_2) == _QOI_OP_DIFF)
+					{
+						px[0] += ((b1 >> 4) & 0x03) - 2;
+						px[1] += ((b1 >> 2) & 0x03) - 2;
+						px[2] += (b1 & 0x03) - 2;
+					}
+					else if ((b1 & _QOI_MASK_2) == _QOI_OP_LUMA)
+					{
+						int b2 = _QOI_ReadByte(s);
+						int vg = (b1 & 0x3f) - 32;
+						px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+						px[1] += vg;
+						px[2] += vg - 8 + (b2 & 0x0f);
+					}
+					else // _QOI_OP_RUN
+					{
+						run = (b1 & 0x3f);
+					}
+					SDL_memcpy(index[_QOI_HASH(px)], px, 4);
+				}
+				SDL_memcpy(row, px, bpp);
+			}
+		}
+		if (s->failed) { SDL_SetError("QOI: truncated data"); SDL_FreeSurface(surface); surface = NULL; }
+	}
+	if (surface && !freesrc)
+	{
+		// the caller keeps reading, leave the stream just past the end marker rather than a buffer past it
+		size_t end = s->pos;
+		while ((end < s->len) && ((end - s->pos) < sizeof(_qoi_padding)) && (s->buf[end] == _qoi_padding[end - s->pos])) { ++end; }
+		if (end < s->len) { SDL_RWseek(src, -static_cast< ::Sint64 >(s->len - end), RW_SEEK_CUR); }
+		else
+		{
+			size_t rest = sizeof(_qoi_padding) - (end - s->pos);
+			if (SDL_RWread(src, s->buf, 1, rest) != rest) { SDL_RWseek(src, 0, RW_SEEK_END); }
+		}
+	}
+	SDL_free(s);
+	if (src && freesrc) { SDL_RWclose(src); }
+	return surface;
+}
+
+// like SDL_SaveBMP_RW, writes 4 channels when the surface has alpha, else 3
+
+static int _SDL_EXT_SaveQOI_RW(SDL_Surface* surface, SDL_RWops* dst, int freedst)
+{
+	if (!dst) { return -1; } // SDL_RWFromFile has set the error
+	if (!surface) { if (freedst) { SDL_RWclose(dst); } return SDL_SetError("null SDL_Surface object"); }
+	SDL_Surface* converted = NULL;
+	if (SDL_ISPIXELFORMAT_INDEXED(surface->format->format))
+	{
+		// SDL_ConvertPixels does not do palettes
+		surface = converted = SDL_ConvertSurfaceFormat(surface, _QOI_PIXELFORMAT_RGBA, 0);
+		if (!converted) { if (freedst) { SDL_RWclose(dst); } return -1; }
+	}
+	bool direct = (surface->format->format == _QOI_PIXELFORMAT_RGBA);
+	int w = surface->w, h = surface->h;
+	int channels = (surface->format->Amask)?(4):(3);
+	_QOIStream* s = static_cast<_QOIStream*>(SDL_malloc(sizeof(_QOIStream)));
+	::Uint8* row_rgba = static_cast< ::Uint8* >((direct)?(NULL):(SDL_malloc(w * 4)));
+	int err = 0;
+	if (!s || (!direct && !row_rgba)) { err = SDL_OutOfMemory(); }
+	else if (SDL_MUSTLOCK(surface) && (SDL_LockSurface(surface) < 0)) { err = -1; }
+	else
+	{
+		s->rw = dst; s->pos = s->len = 0; s->failed = false;
+		::Uint8 header[_QOI_HEADER_SIZE] = {
+			'q', 'o', 'i', 'f',
+			static_cast< ::Uint8 >(w >> 24), static_cast< ::Uint8 >(w >> 16), static_cast< ::Uint8 >(w >> 8), static_cast< ::Uint8 >(w),
+			static_cast< ::Uint8 >(h >> 24), static_cast< ::Uint8 >(h >> 16), static_cast< ::Uint8 >(h >> 8), static_cast< ::Uint8 >(h),
+			static_cast< ::Uint8 >(channels), 0 // sRGB with linear alpha
+		};
+		_QOI_WriteBytes(s, header, sizeof(header));
+		::Uint8 index[64][4]; SDL_memset(index, 0, sizeof(index));
+		::Uint8 prev[4] = { 0, 0, 0, 255 };
+		int run = 0;
+		for (int y = 0; (y < h) && (err == 0); ++y)
+		{
+			const ::Uint8* row = static_cast<const ::Uint8*>(surface->pixels) + y * surface->pitch;
+			if (!direct)
+			{
+				err = SDL_ConvertPixels(w, 1, surface->format->format, row, surface->pitch, _QOI_PIXELFORMAT_RGBA, row_rgba, w * 4);
+				row = row_rgba;
+			}
+			for (int x = 0; x < w; ++x)
+			{
+				const ::Uint8* px = row + x * 4;
+				if (SDL_memcmp(px, prev, 4) == 0)
+				{
+					if (++run == 62) { _QOI_WriteByte(s, _QOI_OP_RUN | (run - 1)); run = 0; }
+					continue;
+				}
+				if (run > 0) { _QOI_WriteByte(s, _QOI_OP_RUN | (run - 1)); run = 0; }
+				int hash = _QOI_HASH(px);
+				if (SDL_memcmp(index[hash], px, 4) == 0)
+				{
+					_QOI_WriteByte(s, _QOI_OP_INDEX | hash);
+				}
+				else
+				{
+					SDL_memcpy(index[hash], px, 4);
+					if (px[3] == prev[3])
+					{
+						signed char vr = static_cast<signed char>(px[0] - prev[0]);
+						signed char vg = static_cast<signed char>(px[1] - prev[1]);
+						signed char vb = static_cast<signed char>(px[2] - prev[2]);
+						signed char vg_r = vr - vg;
+						signed char vg_b = vb - vg;
+						if ((vr > -3) && (vr < 2) && (vg > -3) && (vg < 2) && (vb > -3) && (vb < 2))
+						{
+							_QOI_WriteByte(s, _QOI_OP_DIFF | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2));
+						}
+						else if ((vg_r > -9) && (vg_r < 8) && (vg > -33) && (vg < 32) && (vg_b > -9) && (vg_b < 8))
+						{
+							_QOI_WriteByte(s, _QOI_OP_LUMA | (vg + 32));
+							_QOI_WriteByte(s, ((vg_r + 8) << 4) | (vg_b + 8));
+						}
+						else
+						{
+							_QOI_WriteByte(s, _QOI_OP_RGB); _QOI_WriteBytes(s, px, 3);
+						}
+					}
+					else
+					{
+						_QOI_WriteByte(s, _QOI_OP_RGBA); _QOI_WriteBytes(s, px, 4);
+					}
+				}
+				SDL_memcpy(prev, px, 4);
+			}
+		}
+		if (run > 0) { _QOI_WriteByte(s, _QOI_OP_RUN | (run - 1)); }
+		_QOI_WriteBytes(s, _qoi_padding, sizeof(_qoi_padding));
+		_QOI_Flush(s);
+		if ((err == 0) && s->failed) { err = SDL_SetError("QOI: write failed"); }
+		if (SDL_MUSTLOCK(surface)) { SDL_UnlockSurface(surface); }
+	}
+	SDL_free(row_rgba);
+	SDL_free(s);
+	if (converted) { SDL_FreeSurface(converted); }
+	if (freedst) { SDL_RWclose(dst); }
+	return err;
+}
+
+// saves through a temporary file renamed over the target, so a failed encode never leaves a truncated image
+
+static int _SDL_EXT_SaveQOI(SDL_Surface* surface, const char* file)
+{
+	size_t size = strlen(file) + 6;
+	char* part = static_cast<char*>(SDL_malloc(size)); if (!part) { return SDL_OutOfMemory(); }
+	SDL_snprintf(part, size, "%s.part", file);
+	int err = _SDL_EXT_SaveQOI_RW(surface, SDL_RWFromFile(part, "wb"), 1);
+	#if defined(_WIN32)
+	if (err == 0) { remove(file); } // rename does not replace on windows
+	#endif
+	if ((err == 0) && (rename(part, file) != 0)) { err = SDL_SetError("QOI: could not rename %s", part); }
+	if (err < 0) { remove(part); }
+	SDL_free(part);
+	return err;
+}
+
+// stream a BMP into an existing surface, converting one row at a time to the surface format
+// dstrect x, y place the image, a non zero w, h clip it, the image is not scaled
+
+#define _BMP_BI_RGB 0
+#define _BMP_BI_BITFIELDS 3
+#define _BMP_BI_ALPHABITFIELDS 6
+
+static inline ::Uint16 _BMP_LE16(const ::Uint8* p) { return static_cast< ::Uint16 >(p[0] | (p[1] << 8)); }
+static inline ::Uint32 _BMP_LE32(const ::Uint8* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast< ::Uint32 >(p[3]) << 24); }
+
+static int _BMP_Skip(SDL_RWops* src, ::Uint32 size)
+{
+	::Uint8 scratch[256];
+	while (size > 0)
+	{
+		size_t part = SDL_min(size, static_cast< ::Uint32 >(sizeof(scratch)));
+		if (SDL_RWread(src, scratch, 1, part) != part) { return SDL_SetError("BMP: truncated file"); }
+		size -= static_cast< ::Uint32 >(part);
+	}
+	return 0;
+}
+
+static int _BMP_DecodeInto(SDL_RWops* src, SDL_Surface* dst, const SDL_Rect* dstrect)
+{
+	if (!dst) { return SDL_SetError("null SDL_Surface object"); }
+	if (SDL_ISPIXELFORMAT_INDEXED(dst->format->format)) { return SDL_SetError("BMP: destination surface can not be indexed"); }
+
+	// file header and info header
+	::Uint8 header[14 + 124];
+	if (SDL_RWread(src, header, 1, 18) != 18) { return SDL_SetError("BMP: truncated header"); }
+	if ((header[0] != 'B') || (header[1] != 'M')) { return SDL_SetError("BMP: bad magic"); }
+	::Uint32 offset = _BMP_LE32(header + 10);
+	::Uint32 info_size = _BMP_LE32(header + 14);
+	if ((info_size != 12) && ((info_size < 40) || (info_size > 124))) { return SDL_SetError("BMP: unsupported info header"); }
+	if (SDL_RWread(src, header + 18, 1, info_size - 4) != (info_size - 4)) { return SDL_SetError("BMP: truncated header"); }
+	::Uint32 consumed = 14 + info_size;
+	const ::Uint8* info = header + 14;
+	int w = 0, h = 0, bpp = 0;
+	::Uint32 compression = _BMP_BI_RGB, colors = 0;
+	::Uint32 masks[4] = { 0, 0, 0, 0 };
+	if (info_size == 12)
+	{
+		w = _BMP_LE16(info + 4); h = static_cast< ::Sint16 >(_BMP_LE16(info + 6)); bpp = _BMP_LE16(info + 10);
+	}
+	else
+	{
+		w = static_cast< ::Sint32 >(_BMP_LE32(info + 4)); h = static_cast< ::Sint32 >(_BMP_LE32(info + 8)); bpp = _BMP_LE16(info + 14);
+		compression = _BMP_LE32(info + 16); colors = _BMP_LE32(info + 32);
+		if (info_size >= 52) { masks[0] = _BMP_LE32(info + 40); masks[1] = _BMP_LE32(info + 44); masks[2] = _BMP_LE32(info + 48); }
+		if (info_size >= 56) { masks[3] = _BMP_LE32(info + 52); }
+	}
+	bool top_down = (h < 0); if (top_down) { h = -h; }
+	if ((w <= 0) || (h <= 0) || (w > 0x7fffff)) { return SDL_SetError("BMP: bad size"); }
+	if ((info_size < 52) && ((compression == _BMP_BI_BITFIELDS) || (compression == _BMP_BI_ALPHABITFIELDS)))
+	{
+		// masks follow the 40 byte info header
+		::Uint8 extra[16]; ::Uint32 extra_size = (compression == _BMP_BI_ALPHABITFIELDS)?(16):(12);
+		if (SDL_RWread(src, extra, 1, extra_size) != extra_size) { return SDL_SetError("BMP: truncated header"); }
+		for (::Uint32 i = 0; i < extra_size / 4; ++i) { masks[i] = _BMP_LE32(extra + i * 4); }
+		consumed += extra_size;
+	}
+
+	// source row format, palette formats are expanded to ARGB8888 first
+	::Uint32 format = SDL_PIXELFORMAT_UNKNOWN;
+	::Uint32 palette[256]; SDL_memset(palette, 0, sizeof(palette));
+	if (((bpp == 1) || (bpp == 4) || (bpp == 8)) && (compression == _BMP_BI_RGB))
+	{
+		format = SDL_PIXELFORMAT_ARGB8888;
+		::Uint32 count = (colors)?(SDL_min(colors, 256u)):(1u << bpp);
+		::Uint32 entry_size = (info_size == 12)?(3):(4);
+		::Uint8 entries[256 * 4];
+		if (SDL_RWread(src, entries, entry_size, count) != count) { return SDL_SetError("BMP: truncated palette"); }
+		for (::Uint32 i = 0; i < count; ++i)
+		{
+			const ::Uint8* bgr = entries + i * entry_size;
+			palette[i] = 0xff000000 | (bgr[2] << 16) | (bgr[1] << 8) | bgr[0];
+		}
+		consumed += entry_size * count;
+		if (colors > 256) { if (_BMP_Skip(src, (colors - 256) * entry_size) < 0) { return -1; } consumed += (colors - 256) * entry_size; }
+	}
+	else if ((bpp == 24) && (compression == _BMP_BI_RGB))
+	{
+		format = SDL_PIXELFORMAT_BGR24;
+	}
+	else if ((bpp == 16) || (bpp == 32))
+	{
+		if (compression == _BMP_BI_RGB)
+		{
+			// alpha in a 32 bit BI_RGB file is reserved, ignore it like SDL_LoadBMP
+			masks[0] = (bpp == 16)?(0x7c00):(0x00ff0000);
+			masks[1] = (bpp == 16)?(0x03e0):(0x0000ff00);
+			masks[2] = (bpp == 16)?(0x001f):(0x000000ff);
+			masks[3] = 0;
+		}
+		if ((compression == _BMP_BI_RGB) || (compression == _BMP_BI_BITFIELDS) || (compression == _BMP_BI_ALPHABITFIELDS))
+		{
+			format = SDL_MasksToPixelFormatEnum(bpp, masks[0], masks[1], masks[2], masks[3]);
+		}
+	}
+	if (format == SDL_PIXELFORMAT_UNKNOWN) { return SDL_SetError("BMP: unsupported bit depth or compression"); }
+	if (offset < consumed) { return SDL_SetError("BMP: bad pixel data offset"); }
+	if (_BMP_Skip(src, offset - consumed) < 0) { return -1; }
+
+	// clip the placed image against the surface and the optional region
+	SDL_Rect image = { (dstrect)?(dstrect->x):(0), (dstrect)?(dstrect->y):(0), w, h };
+	SDL_Rect clip = { 0, 0, dst->w, dst->h };
+	if (dstrect && (dstrect->w > 0) && (dstrect->h > 0)) { SDL_IntersectRect(&clip, dstrect, &clip); }
+	SDL_Rect area;
+	if (!SDL_IntersectRect(&image, &clip, &area)) { return 0; } // nothing visible
+
+	int src_pitch = ((w * bpp + 31) / 32) * 4;
+	int sx = area.x - image.x; // first visible image column
+	::Uint8* row = static_cast< ::Uint8* >(SDL_malloc(src_pitch));
+	::Uint32* expanded = static_cast< ::Uint32* >((bpp <= 8)?(SDL_malloc(area.w * 4)):(NULL));
+	if (!row || ((bpp <= 8) && !expanded)) { SDL_free(row); SDL_free(expanded); return SDL_OutOfMemory(); }
+	if (SDL_MUSTLOCK(dst) && (SDL_LockSurface(dst) < 0)) { SDL_free(row); SDL_free(expanded); return -1; }
+	int err = 0;
+	for (int i = 0; i < h; ++i)
+	{
+		int dy = image.y + ((top_down)?(i):(h - 1 - i));
+		if (top_down && (dy >= (area.y + area.h))) { break; } // rest is clipped
+		if (SDL_RWread(src, row, src_pitch, 1) != 1) { err = SDL_SetError("BMP: truncated pixel data"); break; }
+		if ((dy < area.y) || (dy >= (area.y + area.h))) { continue; }
+		const void* pixels = NULL;
+		if (bpp <= 8)
+		{
+			for (int x = 0; x < area.w; ++x)
+			{
+				int ix = sx + x;
+				int index = 0;
+				if (bpp == 8) { index = row[ix]; }
+				else if (bpp == 4) { index = (row[ix >> 1] >> ((ix & 1)?(0):(4))) & 0x0f; }
+				else { index = (row[ix >> 3] >> (7 - (ix & 7))) & 0x01; }
+				expanded[x] = palette[index];
+			}
+			pixels = expanded;
+		}
+		else
+		{
+			#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			if (bpp == 16) { ::Uint16* p = reinterpret_cast< ::Uint16* >(row) + sx; for (int x = 0; x < area.w; ++x) { p[x] = SDL_Swap16(p[x]); } }
+			if (bpp == 32) { ::Uint32* p = reinterpret_cast< ::Uint32* >(row) + sx; for (int x = 0; x < area.w; ++x) { p[x] = SDL_Swap32(p[x]); } }
+			#endif
+			pixels = row + sx * (bpp / 8);
+		}
+		::Uint8* out = static_cast< ::Uint8* >(dst->pixels) + dy * dst->pitch + area.x * dst->format->BytesPerPixel;
+		if (SDL_ConvertPixels(area.w, 1, format, pixels, src_pitch, dst->format->format, out, dst->pitch) < 0) { err = -1; break; }
+	}
+	if (SDL_MUSTLOCK(dst)) { SDL_UnlockSurface(dst); }
+	SDL_free(row);
+	SDL_free(expanded);
+	return err;
+}
+
+static int _SDL_EXT_LoadBMPInto_RW(SDL_RWops* src, int freesrc, SDL_Surface* dst, const SDL_Rect* dstrect)
+{
+	if (!src) { return -1; } // SDL_RWFromFile has set the error
+	int err = _BMP_DecodeInto(src, dst, dstrect);
+	if (freesrc) { SDL_RWclose(src); }
+	return err;
+}
+
 namespace node_sdl2 {
 
 static Nan::Persistent<v8::Value> _gl_current_window;
@@ -114,31 +586,29 @@ static Nan::Persistent<v8::Value> _gl_current_context;
 
 class TaskLoadBMP : public Nanx::SimpleTask
 {
-	public: Nan::Persistent<v8::Function> m_callback;
 	public: char* m_file;
 	public: SDL_Surface* m_surface;
-	public: TaskLoadBMP(v8::Local<v8::String> file, v8::Local<v8::Function> callback) :
+	public: TaskLoadBMP(v8::Local<v8::String> file) :
 		m_file(strdup(*v8::String::Utf8Value(file))),
 		m_surface(NULL)
 	{
-		m_callback.Reset(callback);
 	}
 	public: ~TaskLoadBMP()
 	{
-		m_callback.Reset();
 		free(m_file); m_file = NULL; // strdup
 		if (m_surface) { SDL_FreeSurface(m_surface); m_surface = NULL; }
 	}
 	public: void DoWork()
 	{
 		m_surface = SDL_LoadBMP(m_file);
+		if (!m_surface) { SetError(SDL_GetError()); }
 	}
-	public: void DoAfterWork(int status)
+	public: v8::Local<v8::Value> DoAfterWork(int status)
 	{
-		Nan::HandleScope scope;
-		v8::Local<v8::Value> argv[] = { WrapSurface::Hold(m_surface) };
-		Nan::MakeCallback(Nan::GetCurrentContext()->Global(), Nan::New<v8::Function>(m_callback), countof(argv), argv);
+		if (!m_surface) { return Nan::Null(); }
+		v8::Local<v8::Value> surface = WrapSurface::Hold(m_surface);
 		m_surface = NULL; // script owns pointer
+		return surface;
 	}
 };
 
@@ -147,33 +617,128 @@ class TaskLoadBMP : public Nanx::SimpleTask
 class TaskSaveBMP : public Nanx::SimpleTask
 {
 	public: Nan::Persistent<v8::Value> m_hold_surface;
-	public: Nan::Persistent<v8::Function> m_callback;
 	public: SDL_Surface* m_surface;
 	public: char* m_file;
 	public: int m_err;
-	public: TaskSaveBMP(v8::Local<v8::Value> surface, v8::Local<v8::String> file, v8::Local<v8::Function> callback) :
+	public: TaskSaveBMP(v8::Local<v8::Value> surface, v8::Local<v8::String> file) :
 		m_surface(WrapSurface::Peek(surface)),
 		m_file(strdup(*v8::String::Utf8Value(file))),
 		m_err(0)
 	{
 		m_hold_surface.Reset(surface);
-		m_callback.Reset(callback);
 	}
 	public: ~TaskSaveBMP()
 	{
 		m_hold_surface.Reset();
-		m_callback.Reset();
 		free(m_file); m_file = NULL; // strdup
 	}
 	public: void DoWork()
 	{
+		if (!m_surface) { m_err = -1; SetError("null SDL_Surface object"); return; }
 		m_err = SDL_SaveBMP(m_surface, m_file);
+		if (m_err < 0) { SetError(SDL_GetError()); }
 	}
-	public: void DoAfterWork(int status)
+	public: v8::Local<v8::Value> DoAfterWork(int status)
 	{
-		Nan::HandleScope scope;
-		v8::Local<v8::Value> argv[] = { Nan::New(m_err) };
-		Nan::MakeCallback(Nan::GetCurrentContext()->Global(), Nan::New<v8::Function>(m_callback), countof(argv), argv);
+		return Nan::New(m_err);
+	}
+};
+
+// load BMP into an existing surface
+
+class TaskLoadBMPInto : public Nanx::SimpleTask
+{
+	public: Nan::Persistent<v8::Value> m_hold_surface;
+	public: SDL_Surface* m_surface;
+	public: char* m_file;
+	public: SDL_Rect m_rect;
+	public: bool m_has_rect;
+	public: int m_err;
+	public: TaskLoadBMPInto(v8::Local<v8::String> file, v8::Local<v8::Value> surface, const SDL_Rect* rect) :
+		m_surface(WrapSurface::Peek(surface)),
+		m_file(strdup(*v8::String::Utf8Value(file))),
+		m_has_rect(rect != NULL),
+		m_err(0)
+	{
+		m_hold_surface.Reset(surface);
+		if (rect) { m_rect = *rect; } else { SDL_zero(m_rect); }
+	}
+	public: ~TaskLoadBMPInto()
+	{
+		m_hold_surface.Reset();
+		free(m_file); m_file = NULL; // strdup
+	}
+	public: void DoWork()
+	{
+		if (!m_surface) { m_err = -1; SetError("null SDL_Surface object"); return; }
+		m_err = _SDL_EXT_LoadBMPInto_RW(SDL_RWFromFile(m_file, "rb"), 1, m_surface, (m_has_rect)?(&m_rect):(NULL));
+		if (m_err < 0) { SetError(SDL_GetError()); }
+	}
+	public: v8::Local<v8::Value> DoAfterWork(int status)
+	{
+		return Nan::New(m_err);
+	}
+};
+
+// load QOI surface
+
+class TaskLoadQOI : public Nanx::SimpleTask
+{
+	public: char* m_file;
+	public: SDL_Surface* m_surface;
+	public: TaskLoadQOI(v8::Local<v8::String> file) :
+		m_file(strdup(*v8::String::Utf8Value(file))),
+		m_surface(NULL)
+	{
+	}
+	public: ~TaskLoadQOI()
+	{
+		free(m_file); m_file = NULL; // strdup
+		if (m_surface) { SDL_FreeSurface(m_surface); m_surface = NULL; }
+	}
+	public: void DoWork()
+	{
+		m_surface = _SDL_EXT_LoadQOI_RW(SDL_RWFromFile(m_file, "rb"), 1);
+		if (!m_surface) { SetError(SDL_GetError()); }
+	}
+	public: v8::Local<v8::Value> DoAfterWork(int status)
+	{
+		if (!m_surface) { return Nan::Null(); }
+		v8::Local<v8::Value> surface = WrapSurface::Hold(m_surface);
+		m_surface = NULL; // script owns pointer
+		return surface;
+	}
+};
+
+// save QOI surface
+
+class TaskSaveQOI : public Nanx::SimpleTask
+{
+	public: Nan::Persistent<v8::Value> m_hold_surface;
+	public: SDL_Surface* m_surface;
+	public: char* m_file;
+	public: int m_err;
+	public: TaskSaveQOI(v8::Local<v8::Value> surface, v8::Local<v8::String> file) :
+		m_surface(WrapSurface::Peek(surface)),
+		m_file(strdup(*v8::String::Utf8Value(file))),
+		m_err(0)
+	{
+		m_hold_surface.Reset(surface);
+	}
+	public: ~TaskSaveQOI()
+	{
+		m_hold_surface.Reset();
+		free(m_file); m_file = NULL; // strdup
+	}
+	public: void DoWork()
+	{
+		if (!m_surface) { m_err = -1; SetError("null SDL_Surface object"); return; }
+		m_err = _SDL_EXT_SaveQOI(m_surface, m_file);
+		if (m_err < 0) { SetError(SDL_GetError()); }
+	}
+	public: v8::Local<v8::Value> DoAfterWork(int status)
+	{
+		return Nan::New(m_err);
 	}
 };
 
@@ -201,9 +766,16 @@ NANX_EXPORT(SDL_InitSubSystem)
 	info.GetReturnValue().Set(Nan::New(err));
 }
 
+// the input sampler lives with SDL_joystick.h, it is stopped before joysticks go away
+static void _InputSamplerStop();
+static void _InputSamplerForget(const void* device);
+static void _RenderBandCacheTrim();
+
 NANX_EXPORT(SDL_QuitSubSystem)
 {
 	::Uint32 flags = NANX_Uint32(info[0]);
+	if (flags & (SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER)) { _InputSamplerStop(); } // it reads both
+	if (flags & SDL_INIT_VIDEO) { _RenderBandCacheTrim(); }
 	SDL_QuitSubSystem(flags);
 }
 
@@ -216,872 +788,4936 @@ NANX_EXPORT(SDL_WasInit)
 
 NANX_EXPORT(SDL_Quit)
 {
+	_InputSamplerStop();
+	_RenderBandCacheTrim();
 	SDL_Quit();
 }
 
 // SDL_assert.h
 // SDL_atomic.h
 // SDL_audio.h
-// SDL_bits.h
 
-// SDL_blendmode.h
+// extern DECLSPEC int SDLCALL SDL_GetNumAudioDrivers(void);
+NANX_EXPORT(SDL_GetNumAudioDrivers)
+{
+	info.GetReturnValue().Set(Nan::New(SDL_GetNumAudioDrivers()));
+}
 
-// SDL_clipboard.h
+// extern DECLSPEC const char *SDLCALL SDL_GetAudioDriver(int index);
+NANX_EXPORT(SDL_GetAudioDriver)
+{
+	int index = NANX_int(info[0]);
+	const char* name = SDL_GetAudioDriver(index);
+	if (!name) { return info.GetReturnValue().SetNull(); }
+	info.GetReturnValue().Set(NANX_STRING(name));
+}
 
-NANX_EXPORT(SDL_SetClipboardText)
+// extern DECLSPEC int SDLCALL SDL_AudioInit(const char *driver_name);
+// "disk" and "dummy" run without sound hardware, the disk driver captures from SDL_DISKAUDIOFILEIN
+NANX_EXPORT(SDL_AudioInit)
 {
-	v8::Local<v8::String> text = v8::Local<v8::String>::Cast(info[0]);
-	int err = SDL_SetClipboardText(*v8::String::Utf8Value(text));
+	int err = (info[0]->IsString())?(SDL_AudioInit(*v8::String::Utf8Value(info[0]))):(SDL_AudioInit(NULL));
 	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_GetClipboardText)
+// extern DECLSPEC void SDLCALL SDL_AudioQuit(void);
+NANX_EXPORT(SDL_AudioQuit)
 {
-	const char* clipboard_text = SDL_GetClipboardText();
-	info.GetReturnValue().Set(NANX_STRING(clipboard_text));
+	SDL_AudioQuit();
 }
 
-NANX_EXPORT(SDL_HasClipboardText)
+// extern DECLSPEC const char *SDLCALL SDL_GetCurrentAudioDriver(void);
+NANX_EXPORT(SDL_GetCurrentAudioDriver)
 {
-	SDL_bool has_clipboard_text = SDL_HasClipboardText();
-	info.GetReturnValue().Set(Nan::New(has_clipboard_text != SDL_FALSE));
+	const char* name = SDL_GetCurrentAudioDriver();
+	if (!name) { return info.GetReturnValue().SetNull(); }
+	info.GetReturnValue().Set(NANX_STRING(name));
 }
 
-// SDL_config.h
-// SDL_config_android.h
-// SDL_config_iphoneos.h
-// SDL_config_macosx.h
-// SDL_config_minimal.h
-// SDL_config_pandora.h
-// SDL_config_psp.h
-// SDL_config_windows.h
-// SDL_config_wiz.h
-// SDL_copying.h
+// single producer single consumer byte ring shared with an audio callback
+// each side only advances its own index, so neither side locks or waits on the other
+// the capacity is a power of two and the free running indices wrap through the mask
 
-// SDL_cpuinfo.h
+class AudioRing
+{
+	public: ::Uint8* m_data;
+	public: ::Uint32 m_mask;
+	public: SDL_atomic_t m_head; // bytes written so far, advanced by the producer
+	public: SDL_atomic_t m_tail; // bytes read so far, advanced by the consumer
+	public: AudioRing() : m_data(NULL), m_mask(0) { SDL_AtomicSet(&m_head, 0); SDL_AtomicSet(&m_tail, 0); }
+	public: ~AudioRing() { SDL_free(m_data); m_data = NULL; }
+	public: bool Alloc(::Uint32 size)
+	{
+		::Uint32 capacity = 1;
+		while ((capacity < size) && (capacity < 0x40000000)) { capacity <<= 1; }
+		m_data = static_cast< ::Uint8* >(SDL_calloc(1, capacity));
+		m_mask = (m_data)?(capacity - 1):(0);
+		return m_data != NULL;
+	}
+	public: ::Uint32 Capacity() const { return (m_data)?(m_mask + 1):(0); }
+	public: ::Uint32 Fill() { return static_cast< ::Uint32 >(SDL_AtomicGet(&m_head)) - static_cast< ::Uint32 >(SDL_AtomicGet(&m_tail)); }
+	// producer only, returns the bytes written
+	public: ::Uint32 Write(const void* src, ::Uint32 size)
+	{
+		::Uint32 head = static_cast< ::Uint32 >(SDL_AtomicGet(&m_head));
+		::Uint32 space = Capacity() - (head - static_cast< ::Uint32 >(SDL_AtomicGet(&m_tail)));
+		size = SDL_min(size, space);
+		::Uint32 offset = head & m_mask;
+		::Uint32 first = SDL_min(size, Capacity() - offset);
+		SDL_memcpy(m_data + offset, src, first);
+		SDL_memcpy(m_data, static_cast<const ::Uint8*>(src) + first, size - first);
+		SDL_AtomicSet(&m_head, static_cast<int>(head + size)); // publishes the bytes
+		return size;
+	}
+	// consumer only, returns the bytes read
+	public: ::Uint32 Read(void* dst, ::Uint32 size)
+	{
+		size = Peek(dst, size);
+		SDL_AtomicSet(&m_tail, static_cast<int>(static_cast< ::Uint32 >(SDL_AtomicGet(&m_tail)) + size)); // hands the space back
+		return size;
+	}
+	// consumer only, copies without taking the bytes, returns the bytes copied
+	public: ::Uint32 Peek(void* dst, ::Uint32 size)
+	{
+		::Uint32 tail = static_cast< ::Uint32 >(SDL_AtomicGet(&m_tail));
+		::Uint32 fill = static_cast< ::Uint32 >(SDL_AtomicGet(&m_head)) - tail;
+		size = SDL_min(size, fill);
+		::Uint32 offset = tail & m_mask;
+		::Uint32 first = SDL_min(size, Capacity() - offset);
+		SDL_memcpy(dst, m_data + offset, first);
+		SDL_memcpy(static_cast< ::Uint8* >(dst) + first, m_data, size - first);
+		return size;
+	}
+};
 
-// TODO: #define SDL_CACHELINE_SIZE  128
-// TODO: extern DECLSPEC int SDLCALL SDL_GetCPUCount(void);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetCPUCacheLineSize(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasRDTSC(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasAltiVec(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasMMX(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_Has3DNow(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE2(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE3(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE41(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE42(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX(void);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX2(void);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetSystemRAM(void);
+// a voice mixer that runs inside the audio callback, script drives it with small commands
+// commands travel through an AudioRing, samples the audio thread lets go of come back through another
+// voices are mixed in float, then a limiter and clip stage converts to the device format
+
+static const int SDL_EXT_MIXER_GAIN = 0;
+static const int SDL_EXT_MIXER_PAN = 1; // -1 left to 1 right
+static const int SDL_EXT_MIXER_PITCH = 2; // playback rate, 1 plays at the sample's own rate
+static const int SDL_EXT_MIXER_LOOP_START = 3; // frames
+static const int SDL_EXT_MIXER_LOOP_END = 4; // frames, 0 does not loop
+
+class AudioSample
+{
+	public: float* m_data; // interleaved
+	public: int m_channels; // 1 or 2
+	public: ::Uint32 m_frames;
+	public: int m_freq;
+	public: AudioSample() : m_data(NULL), m_channels(0), m_frames(0), m_freq(0) {}
+	public: ~AudioSample() { SDL_free(m_data); m_data = NULL; }
+};
+
+class AudioMixer
+{
+	public: static const int MAX_VOICES = 256;
+	public: static const int MAX_SAMPLES = 256;
+	private: static const int OP_SAMPLE = 0;
+	private: static const int OP_PLAY = 1;
+	private: static const int OP_STOP = 2;
+	private: static const int OP_PARAM = 3;
+	private: static const int OP_MASTER = 4;
+	private: struct Command
+	{
+		int op, voice, slot, param;
+		float gain, pan, pitch;
+		::Uint32 loop_start, loop_end;
+		AudioSample* sample;
+	};
+	private: struct Voice
+	{
+		bool active;
+		int slot;
+		AudioSample* sample;
+		::Uint64 pos, step; // frames in 32.32 fixed point
+		float gain, pan, pitch, left, right;
+		::Uint32 loop_start, loop_end;
+	};
+	private: int m_freq;
+	private: int m_channels;
+	private: SDL_AudioFormat m_format;
+	private: int m_voice_count;
+	private: Voice* m_voices; // audio thread only
+	private: AudioSample* m_samples[MAX_SAMPLES]; // audio thread only
+	private: float* m_scratch;
+	private: int m_scratch_size; // floats
+	private: float m_master;
+	private: float m_limiter; // gain the limiter ended the last block on
+	private: AudioRing m_commands; // script to audio thread
+	private: AudioRing m_garbage; // AudioSample pointers, audio thread to script
+	public: SDL_atomic_t m_active; // voices playing after the last block
+	public: AudioMixer() :
+		m_freq(0), m_channels(0), m_format(0), m_voice_count(0), m_voices(NULL),
+		m_scratch(NULL), m_scratch_size(0), m_master(1.0f), m_limiter(1.0f)
+	{
+		SDL_zero(m_samples);
+		SDL_AtomicSet(&m_active, 0);
+	}
+	public: ~AudioMixer()
+	{
+		// the audio thread is gone, so anything still in flight belongs to us
+		Command command;
+		while (m_commands.Read(&command, sizeof(command)) == sizeof(command))
+		{
+			if (command.op == OP_SAMPLE) { delete command.sample; }
+		}
+		Collect();
+		for (int slot = 0; slot < MAX_SAMPLES; ++slot) { delete m_samples[slot]; m_samples[slot] = NULL; }
+		SDL_free(m_voices); m_voices = NULL;
+		SDL_free(m_scratch); m_scratch = NULL;
+	}
+	public: int VoiceCount() const { return m_voice_count; }
+	public: bool Init(const SDL_AudioSpec& spec, int voice_count)
+	{
+		m_freq = spec.freq;
+		m_channels = spec.channels;
+		m_format = spec.format;
+		m_voice_count = SDL_max(1, SDL_min(voice_count, MAX_VOICES));
+		m_voices = static_cast<Voice*>(SDL_calloc(m_voice_count, sizeof(Voice)));
+		m_scratch_size = static_cast<int>(spec.size / (SDL_AUDIO_BITSIZE(spec.format) / 8));
+		m_scratch = static_cast<float*>(SDL_malloc(m_scratch_size * sizeof(float)));
+		return m_voices && m_scratch && m_commands.Alloc(256 * sizeof(Command)) && m_garbage.Alloc(2 * MAX_SAMPLES * sizeof(AudioSample*));
+	}
+	// script side, each returns false when the command queue is full
+	public: bool SetSample(int slot, AudioSample* sample)
+	{
+		Command command; SDL_zero(command); command.op = OP_SAMPLE; command.slot = slot; command.sample = sample;
+		return Send(command);
+	}
+	public: bool Play(int voice, int slot, float gain, float pan, float pitch, ::Uint32 loop_start, ::Uint32 loop_end)
+	{
+		Command command; SDL_zero(command); command.op = OP_PLAY; command.voice = voice; command.slot = slot;
+		command.gain = gain; command.pan = pan; command.pitch = pitch; command.loop_start = loop_start; command.loop_end = loop_end;
+		return Send(command);
+	}
+	public: bool Stop(int voice)
+	{
+		Command command; SDL_zero(command); command.op = OP_STOP; command.voice = voice;
+		return Send(command);
+	}
+	public: bool SetParam(int voice, int param, double value)
+	{
+		Command command; SDL_zero(command); command.op = OP_PARAM; command.voice = voice; command.param = param;
+		command.gain = static_cast<float>(value); command.loop_start = static_cast< ::Uint32 >(SDL_max(value, 0.0));
+		return Send(command);
+	}
+	public: bool SetMaster(float gain)
+	{
+		Command command; SDL_zero(command); command.op = OP_MASTER; command.gain = gain;
+		return Send(command);
+	}
+	// frees the samples the audio thread has released
+	public: void Collect()
+	{
+		AudioSample* sample = NULL;
+		while (m_garbage.Read(&sample, sizeof(sample)) == sizeof(sample)) { delete sample; }
+	}
+	private: bool Send(const Command& command)
+	{
+		Collect();
+		if ((m_commands.Capacity() - m_commands.Fill()) < sizeof(command)) { return false; }
+		m_commands.Write(&command, sizeof(command));
+		return true;
+	}
+	// audio thread side, never frees, Mix only applies a sample swap once the garbage ring has room
+	private: bool CanRelease() { return (m_garbage.Capacity() - m_garbage.Fill()) >= sizeof(AudioSample*); }
+	private: void Release(AudioSample* sample)
+	{
+		if (sample) { m_garbage.Write(&sample, sizeof(sample)); }
+	}
+	private: void Retune(Voice& voice)
+	{
+		double step = voice.pitch * voice.sample->m_freq / m_freq;
+		voice.step = static_cast< ::Uint64 >(SDL_max(step, 0.0) * 4294967296.0);
+	}
+	private: void Repan(Voice& voice)
+	{
+		double angle = (SDL_max(-1.0f, SDL_min(voice.pan, 1.0f)) + 1.0) * M_PI / 4; // constant power
+		voice.left = voice.gain * static_cast<float>(SDL_cos(angle));
+		voice.right = voice.gain * static_cast<float>(SDL_sin(angle));
+	}
+	private: void Apply(const Command& command)
+	{
+		switch (command.op)
+		{
+		case OP_SAMPLE:
+			for (int index = 0; index < m_voice_count; ++index)
+			{
+				if (m_voices[index].slot == command.slot) { m_voices[index].active = false; m_voices[index].sample = NULL; }
+			}
+			Release(m_samples[command.slot]);
+			m_samples[command.slot] = command.sample;
+			break;
+		case OP_PLAY:
+		{
+			Voice& voice = m_voices[command.voice];
+			voice.sample = m_samples[command.slot];
+			voice.active = (voice.sample != NULL) && (voice.sample->m_frames > 0);
+			if (!voice.active) { break; }
+			voice.slot = command.slot;
+			voice.pos = 0;
+			voice.gain = command.gain; voice.pan = command.pan; voice.pitch = command.pitch;
+			voice.loop_start = command.loop_start; voice.loop_end = command.loop_end;
+			Retune(voice); Repan(voice);
+			break;
+		}
+		case OP_STOP:
+			m_voices[command.voice].active = false;
+			break;
+		case OP_PARAM:
+		{
+			Voice& voice = m_voices[command.voice];
+			if (!voice.active) { break; }
+			switch (command.param)
+			{
+			case SDL_EXT_MIXER_GAIN: voice.gain = command.gain; Repan(voice); break;
+			case SDL_EXT_MIXER_PAN: voice.pan = command.gain; Repan(voice); break;
+			case SDL_EXT_MIXER_PITCH: voice.pitch = command.gain; Retune(voice); break;
+			case SDL_EXT_MIXER_LOOP_START: voice.loop_start = command.loop_start; break;
+			case SDL_EXT_MIXER_LOOP_END: voice.loop_end = command.loop_start; break;
+			}
+			break;
+		}
+		case OP_MASTER:
+			m_master = command.gain;
+			break;
+		}
+	}
+	// adds count source frames at unit rate, the common case of an untuned voice
+	private: static void _AddUnit(float* out, int out_channels, const float* src, int src_channels, int count, float left, float right)
+	{
+		int i = 0;
+		if (out_channels == 2)
+		{
+			#if defined(_SIMD_SSE2)
+			__m128 gain = _mm_setr_ps(left, right, left, right);
+			if (src_channels == 2)
+			{
+				for (; i + 2 <= count; i += 2)
+				{
+					_mm_storeu_ps(out + 2 * i, _mm_add_ps(_mm_loadu_ps(out + 2 * i), _mm_mul_ps(_mm_loadu_ps(src + 2 * i), gain)));
+				}
+			}
+			else
+			{
+				for (; i + 4 <= count; i += 4)
+				{
+					__m128 s = _mm_loadu_ps(src + i);
+					_mm_storeu_ps(out + 2 * i, _mm_add_ps(_mm_loadu_ps(out + 2 * i), _mm_mul_ps(_mm_unpacklo_ps(s, s), gain)));
+					_mm_storeu_ps(out + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(out + 2 * i + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), gain)));
+				}
+			}
+			#elif defined(_SIMD_NEON)
+			float32x4_t gain = { left, right, left, right };
+			if (src_channels == 2)
+			{
+				for (; i + 2 <= count; i += 2)
+				{
+					vst1q_f32(out + 2 * i, vmlaq_f32(vld1q_f32(out + 2 * i), vld1q_f32(src + 2 * i), gain));
+				}
+			}
+			else
+			{
+				for (; i + 4 <= count; i += 4)
+				{
+					float32x4x2_t s = vzipq_f32(vld1q_f32(src + i), vld1q_f32(src + i));
+					vst1q_f32(out + 2 * i, vmlaq_f32(vld1q_f32(out + 2 * i), s.val[0], gain));
+					vst1q_f32(out + 2 * i + 4, vmlaq_f32(vld1q_f32(out + 2 * i + 4), s.val[1], gain));
+				}
+			}
+			#endif
+		}
+		for (; i < count; ++i)
+		{
+			const float* s = src + i * src_channels;
+			float* o = out + i * out_channels;
+			float l = s[0], r = s[src_channels - 1];
+			if (out_channels == 1) { o[0] += (l * left + r * right) * 0.5f; }
+			else { o[0] += l * left; o[1] += r * right; }
+		}
+	}
+	// mixes one voice over count output frames, resampling linearly when the step is not unit
+	private: void MixVoice(Voice& voice, float* out, int count)
+	{
+		const AudioSample* sample = voice.sample;
+		const int src_channels = sample->m_channels;
+		while ((count > 0) && voice.active)
+		{
+			bool looping = (voice.loop_end > voice.loop_start) && (voice.loop_end <= sample->m_frames);
+			::Uint32 end = (looping)?(voice.loop_end):(sample->m_frames);
+			::Uint32 ipos = static_cast< ::Uint32 >(voice.pos >> 32);
+			if (ipos >= end)
+			{
+				if (looping) { voice.pos -= static_cast< ::Uint64 >(end - voice.loop_start) << 32; continue; }
+				voice.active = false; break;
+			}
+			if (voice.step == 0) { break; }
+			if ((voice.step == (static_cast< ::Uint64 >(1) << 32)) && ((voice.pos & 0xffffffff) == 0))
+			{
+				int run = static_cast<int>(SDL_min(static_cast< ::Uint32 >(count), end - ipos));
+				_AddUnit(out, m_channels, sample->m_data + ipos * src_channels, src_channels, run, voice.left, voice.right);
+				voice.pos += static_cast< ::Uint64 >(run) << 32;
+				out += run * m_channels; count -= run;
+				continue;
+			}
+			for (; (count > 0) && (ipos < end); --count, out += m_channels)
+			{
+				::Uint32 inext = (ipos + 1 < end)?(ipos + 1):((looping)?(voice.loop_start):(ipos));
+				float frac = static_cast<float>(voice.pos & 0xffffffff) * (1.0f / 4294967296.0f);
+				const float* a = sample->m_data + ipos * src_channels;
+				const float* b = sample->m_data + inext * src_channels;
+				float l = a[0] + (b[0] - a[0]) * frac;
+				float r = a[src_channels - 1] + (b[src_channels - 1] - a[src_channels - 1]) * frac;
+				if (m_channels == 1) { out[0] += (l * voice.left + r * voice.right) * 0.5f; }
+				else { out[0] += l * voice.left; out[1] += r * voice.right; }
+				voice.pos += voice.step;
+				ipos = static_cast< ::Uint32 >(voice.pos >> 32);
+			}
+		}
+	}
+	// master gain and a block limiter that ramps down to keep peaks under full scale, then clips and converts
+	private: void Limit(::Uint8* stream, int count)
+	{
+		float peak = 0.0f;
+		int i = 0;
+		#if defined(_SIMD_SSE2)
+		__m128 sign = _mm_set1_ps(-0.0f);
+		__m128 peak4 = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4) { peak4 = _mm_max_ps(peak4, _mm_andnot_ps(sign, _mm_loadu_ps(m_scratch + i))); }
+		float lanes[4]; _mm_storeu_ps(lanes, peak4);
+		peak = SDL_max(SDL_max(lanes[0], lanes[1]), SDL_max(lanes[2], lanes[3]));
+		#elif defined(_SIMD_NEON)
+		float32x4_t peak4 = vdupq_n_f32(0.0f);
+		for (; i + 4 <= count; i += 4) { peak4 = vmaxq_f32(peak4, vabsq_f32(vld1q_f32(m_scratch + i))); }
+		float lanes[4]; vst1q_f32(lanes, peak4);
+		peak = SDL_max(SDL_max(lanes[0], lanes[1]), SDL_max(lanes[2], lanes[3]));
+		#endif
+		for (; i < count; ++i) { peak = SDL_max(peak, SDL_fabs(m_scratch[i])); }
+		peak *= m_master;
+		float target = (peak > 1.0f)?(1.0f / peak):(1.0f);
+		// attack within the block, release over a few blocks
+		if (target > m_limiter) { target = m_limiter + (target - m_limiter) * 0.25f; }
+		float gain = m_limiter * m_master;
+		float delta = (count > 0)?((target - m_limiter) * m_master / count):(0.0f);
+		m_limiter = target;
+		if (m_format == AUDIO_F32SYS) { _LimitF32(reinterpret_cast<float*>(stream), m_scratch, count, gain, delta); }
+		else { _LimitS16(reinterpret_cast< ::Sint16* >(stream), m_scratch, count, gain, delta); }
+	}
+	private: static void _LimitF32(float* dst, const float* src, int count, float gain, float delta)
+	{
+		int i = 0;
+		#if defined(_SIMD_SSE2)
+		__m128 g = _mm_setr_ps(gain, gain + delta, gain + 2 * delta, gain + 3 * delta), dg = _mm_set1_ps(4 * delta);
+		__m128 hi = _mm_set1_ps(1.0f), lo = _mm_set1_ps(-1.0f);
+		for (; i + 4 <= count; i += 4, g = _mm_add_ps(g, dg))
+		{
+			_mm_storeu_ps(dst + i, _mm_max_ps(lo, _mm_min_ps(hi, _mm_mul_ps(_mm_loadu_ps(src + i), g))));
+		}
+		#elif defined(_SIMD_NEON)
+		float32x4_t g = { gain, gain + delta, gain + 2 * delta, gain + 3 * delta }, dg = vdupq_n_f32(4 * delta);
+		float32x4_t hi = vdupq_n_f32(1.0f), lo = vdupq_n_f32(-1.0f);
+		for (; i + 4 <= count; i += 4, g = vaddq_f32(g, dg))
+		{
+			vst1q_f32(dst + i, vmaxq_f32(lo, vminq_f32(hi, vmulq_f32(vld1q_f32(src + i), g))));
+		}
+		#endif
+		for (; i < count; ++i)
+		{
+			float x = src[i] * (gain + i * delta);
+			dst[i] = SDL_max(-1.0f, SDL_min(x, 1.0f));
+		}
+	}
+	private: static void _LimitS16(::Sint16* dst, const float* src, int count, float gain, float delta)
+	{
+		int i = 0;
+		#if defined(_SIMD_SSE2)
+		__m128 g = _mm_setr_ps(gain, gain + delta, gain + 2 * delta, gain + 3 * delta), dg = _mm_set1_ps(8 * delta);
+		__m128 g2 = _mm_add_ps(g, _mm_set1_ps(4 * delta)), scale = _mm_set1_ps(32767.0f);
+		for (; i + 8 <= count; i += 8, g = _mm_add_ps(g, dg), g2 = _mm_add_ps(g2, dg))
+		{
+			// the saturating pack does the clip
+			__m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(src + i), g), scale));
+			__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), g2), scale));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(a, b));
+		}
+		#elif defined(_SIMD_NEON)
+		float32x4_t g = { gain, gain + delta, gain + 2 * delta, gain + 3 * delta }, dg = vdupq_n_f32(4 * delta);
+		for (; i + 4 <= count; i += 4, g = vaddq_f32(g, dg))
+		{
+			int32x4_t x = vcvtq_s32_f32(vmulq_n_f32(vmulq_f32(vld1q_f32(src + i), g), 32767.0f));
+			vst1_s16(dst + i, vqmovn_s32(x));
+		}
+		#endif
+		for (; i < count; ++i)
+		{
+			float x = src[i] * (gain + i * delta);
+			dst[i] = static_cast< ::Sint16 >(SDL_max(-1.0f, SDL_min(x, 1.0f)) * 32767.0f);
+		}
+	}
+	// audio thread, mixes every voice on top of what the stream already holds
+	public: void Mix(::Uint8* stream, int len, bool has_input)
+	{
+		Command command;
+		while (m_commands.Peek(&command, sizeof(command)) == sizeof(command))
+		{
+			// the old sample stays in its slot, and this and later commands wait for script to collect
+			if ((command.op == OP_SAMPLE) && m_samples[command.slot] && !CanRelease()) { break; }
+			m_commands.Read(&command, sizeof(command));
+			Apply(command);
+		}
+		int count = SDL_min(len / (SDL_AUDIO_BITSIZE(m_format) / 8), m_scratch_size);
+		if (!has_input) { SDL_memset(m_scratch, 0, count * sizeof(float)); }
+		else if (m_format == AUDIO_F32SYS) { SDL_memcpy(m_scratch, stream, count * sizeof(float)); }
+		else
+		{
+			const ::Sint16* input = reinterpret_cast<const ::Sint16*>(stream);
+			for (int i = 0; i < count; ++i) { m_scratch[i] = input[i] * (1.0f / 32768.0f); }
+		}
+		int active = 0;
+		for (int index = 0; index < m_voice_count; ++index)
+		{
+			Voice& voice = m_voices[index];
+			if (voice.active) { MixVoice(voice, m_scratch, count / m_channels); }
+			if (voice.active) { ++active; }
+		}
+		SDL_AtomicSet(&m_active, active);
+		Limit(stream, count);
+	}
+};
+
+// callback timing and ring fill, gathered on the audio thread and read by script through a sequence lock
+// the audio thread never waits, a reader that races a publish simply copies again
+
+static const int SDL_EXT_AUDIO_TELEMETRY_CALLBACKS = 0;
+static const int SDL_EXT_AUDIO_TELEMETRY_PERIOD_US = 1; // nominal callback period
+static const int SDL_EXT_AUDIO_TELEMETRY_JITTER_MEAN_US = 2; // mean distance of the callback interval from the period
+static const int SDL_EXT_AUDIO_TELEMETRY_JITTER_MAX_US = 3;
+static const int SDL_EXT_AUDIO_TELEMETRY_BUSY_MEAN_US = 4; // time spent inside the callback
+static const int SDL_EXT_AUDIO_TELEMETRY_BUSY_MAX_US = 5;
+static const int SDL_EXT_AUDIO_TELEMETRY_UNDERRUNS = 6;
+static const int SDL_EXT_AUDIO_TELEMETRY_UNDERRUN_FRAMES = 7;
+static const int SDL_EXT_AUDIO_TELEMETRY_OVERRUNS = 8;
+static const int SDL_EXT_AUDIO_TELEMETRY_OVERRUN_FRAMES = 9;
+static const int SDL_EXT_AUDIO_TELEMETRY_FILL_HISTOGRAM = 10; // 8 bins of ring fill at callback entry, empty to full
+static const int SDL_EXT_AUDIO_TELEMETRY_SIZE = 18;
+
+class AudioTelemetry
+{
+	public: static const int FILL_BINS = 8;
+	private: struct Data
+	{
+		double callbacks;
+		double jitter_sum, jitter_max;
+		double busy_sum, busy_max;
+		double fill[FILL_BINS];
+	};
+	private: Data m_data; // audio thread only
+	private: Data m_published;
+	private: SDL_atomic_t m_sequence; // odd while publishing
+	private: SDL_atomic_t m_reset; // set by script, honoured by the audio thread
+	private: ::Uint64 m_last; // counter at the previous callback entry
+	private: double m_us_per_tick;
+	public: double m_period_us;
+	public: AudioTelemetry() : m_last(0), m_us_per_tick(0.0), m_period_us(0.0)
+	{
+		SDL_zero(m_data); SDL_zero(m_published);
+		SDL_AtomicSet(&m_sequence, 0);
+		SDL_AtomicSet(&m_reset, 0);
+	}
+	public: void Init(const SDL_AudioSpec& spec)
+	{
+		m_us_per_tick = 1e6 / static_cast<double>(SDL_GetPerformanceFrequency());
+		m_period_us = (spec.freq > 0)?(1e6 * spec.samples / spec.freq):(0.0);
+	}
+	// audio thread
+	public: ::Uint64 Begin(::Uint32 fill, ::Uint32 capacity)
+	{
+		::Uint64 now = SDL_GetPerformanceCounter();
+		if (SDL_AtomicGet(&m_reset)) { SDL_zero(m_data); m_last = 0; SDL_AtomicSet(&m_reset, 0); }
+		if (m_last)
+		{
+			double jitter = SDL_fabs((now - m_last) * m_us_per_tick - m_period_us);
+			m_data.jitter_sum += jitter;
+			m_data.jitter_max = SDL_max(m_data.jitter_max, jitter);
+		}
+		m_last = now;
+		int bin = (capacity)?(static_cast<int>(static_cast< ::Uint64 >(fill) * FILL_BINS / capacity)):(0);
+		m_data.fill[SDL_min(bin, FILL_BINS - 1)] += 1;
+		return now;
+	}
+	public: void End(::Uint64 start)
+	{
+		double busy = (SDL_GetPerformanceCounter() - start) * m_us_per_tick;
+		m_data.callbacks += 1;
+		m_data.busy_sum += busy;
+		m_data.busy_max = SDL_max(m_data.busy_max, busy);
+		SDL_AtomicAdd(&m_sequence, 1);
+		m_published = m_data;
+		SDL_AtomicAdd(&m_sequence, 1);
+	}
+	// script
+	public: void Reset() { SDL_AtomicSet(&m_reset, 1); }
+	public: void Read(double* out)
+	{
+		Data data;
+		for (;;)
+		{
+			int before = SDL_AtomicGet(&m_sequence);
+			if (before & 1) { SDL_Delay(0); continue; }
+			data = m_published;
+			if (SDL_AtomicAdd(&m_sequence, 0) == before) { break; } // full barrier, then check nothing was published meanwhile
+		}
+		double callbacks = SDL_max(data.callbacks, 1.0);
+		out[SDL_EXT_AUDIO_TELEMETRY_CALLBACKS] = data.callbacks;
+		out[SDL_EXT_AUDIO_TELEMETRY_PERIOD_US] = m_period_us;
+		out[SDL_EXT_AUDIO_TELEMETRY_JITTER_MEAN_US] = data.jitter_sum / SDL_max(data.callbacks - 1, 1.0);
+		out[SDL_EXT_AUDIO_TELEMETRY_JITTER_MAX_US] = data.jitter_max;
+		out[SDL_EXT_AUDIO_TELEMETRY_BUSY_MEAN_US] = data.busy_sum / callbacks;
+		out[SDL_EXT_AUDIO_TELEMETRY_BUSY_MAX_US] = data.busy_max;
+		for (int bin = 0; bin < FILL_BINS; ++bin) { out[SDL_EXT_AUDIO_TELEMETRY_FILL_HISTOGRAM + bin] = data.fill[bin]; }
+	}
+};
+
+// an open audio device whose callback pulls from a ring that script pushes into
+// the callback runs on the audio thread and never touches v8 or takes a lock
+// capture devices run the ring the other way and wake the loop to hand chunks to script
+// queue devices have no callback and use SDL_QueueAudio instead
+// offline devices have no SDL device at all, script pulls their output with SDL_EXT_AudioDeviceRender
+
+class AudioDevice
+{
+	public: SDL_AudioDeviceID m_id;
+	public: SDL_AudioSpec m_spec; // as obtained
+	public: int m_frame_size; // bytes per sample frame
+	public: bool m_queue;
+	public: bool m_capture;
+	public: bool m_offline;
+	public: AudioRing m_ring; // the queue itself on offline queue devices
+	public: AudioMixer* m_mixer; // mixes on top of the ring, see SDL_EXT_AudioDeviceCreateMixer
+	public: SDL_atomic_t m_callbacks;
+	public: SDL_atomic_t m_underruns; // callbacks that ran out of data
+	public: SDL_atomic_t m_underrun_frames; // silence frames played instead
+	public: SDL_atomic_t m_overruns; // capture callbacks that found the ring full
+	public: SDL_atomic_t m_overrun_frames; // captured frames dropped
+	public: AudioTelemetry m_telemetry;
+	public: uv_timer_t* m_feeder; // tops up the queue, see SDL_EXT_AudioDeviceFeed
+	public: ::Uint32 m_feed_target; // bytes to keep queued
+	public: Nan::Persistent<v8::Function> m_feed_callback;
+	public: Nan::Persistent<v8::Value> m_feed_hold; // the device object, kept while feeding
+	public: uv_async_t* m_capture_async; // read by the capture callback, changed under the device lock
+	public: ::Uint32 m_chunk_size; // bytes per delivered chunk
+	public: Nan::Persistent<v8::Function> m_capture_callback;
+	public: Nan::Persistent<v8::Array> m_chunk_pool; // chunks script handed back
+	public: int m_chunk_pool_count;
+	public: Nan::Persistent<v8::Value> m_capture_hold; // the device object, kept while capturing
+	public: AudioDevice() :
+		m_id(0), m_frame_size(0), m_queue(false), m_capture(false), m_offline(false), m_mixer(NULL), m_feeder(NULL), m_feed_target(0),
+		m_capture_async(NULL), m_chunk_size(0), m_chunk_pool_count(0)
+	{
+		SDL_zero(m_spec);
+		SDL_AtomicSet(&m_callbacks, 0);
+		SDL_AtomicSet(&m_underruns, 0);
+		SDL_AtomicSet(&m_underrun_frames, 0);
+		SDL_AtomicSet(&m_overruns, 0);
+		SDL_AtomicSet(&m_overrun_frames, 0);
+	}
+	public: ~AudioDevice() { Close(); }
+	public: void Close()
+	{
+		StopFeed();
+		StopCapture();
+		if (m_id) { SDL_CloseAudioDevice(m_id); m_id = 0; } // waits for a running callback
+		delete m_mixer; m_mixer = NULL;
+	}
+	public: void StopFeed()
+	{
+		if (m_feeder)
+		{
+			uv_timer_stop(m_feeder);
+			m_feeder->data = NULL; // tells a running _Feed the device is gone
+			uv_close(reinterpret_cast<uv_handle_t*>(m_feeder), _FeederClosed);
+			m_feeder = NULL;
+		}
+		m_feed_callback.Reset();
+		m_feed_hold.Reset();
+	}
+	public: void Lock() { if (m_id) { SDL_LockAudioDevice(m_id); } }
+	public: void Unlock() { if (m_id) { SDL_UnlockAudioDevice(m_id); } }
+	// queue devices queue through SDL, offline ones through the ring
+	public: int Queue(const void* data, ::Uint32 size)
+	{
+		if (m_offline)
+		{
+			if (size > (m_ring.Capacity() - m_ring.Fill())) { return SDL_SetError("offline queue is full"); }
+			m_ring.Write(data, size);
+			return 0;
+		}
+		#if SDL_VERSION_ATLEAST(2, 0, 4)
+		return SDL_QueueAudio(m_id, data, size);
+		#else
+		return SDL_Unsupported();
+		#endif
+	}
+	public: ::Uint32 Queued()
+	{
+		if (m_offline) { return m_ring.Fill(); }
+		#if SDL_VERSION_ATLEAST(2, 0, 4)
+		return SDL_GetQueuedAudioSize(m_id);
+		#else
+		return 0;
+		#endif
+	}
+	public: void ClearQueue()
+	{
+		if (m_offline) { SDL_AtomicSet(&m_ring.m_tail, SDL_AtomicGet(&m_ring.m_head)); return; }
+		#if SDL_VERSION_ATLEAST(2, 0, 4)
+		SDL_ClearQueuedAudio(m_id);
+		#endif
+	}
+	// runs the device's pipeline for size bytes in callback sized steps, as fast as it goes
+	public: void Render(::Uint8* stream, ::Uint32 size)
+	{
+		::Uint32 step = SDL_max(m_spec.size, static_cast< ::Uint32 >(m_frame_size));
+		for (::Uint32 done = 0; done < size; done += step)
+		{
+			Pull(stream + done, static_cast<int>(SDL_min(step, size - done)));
+		}
+	}
+	private: static void _FeederClosed(uv_handle_t* handle) { delete reinterpret_cast<uv_timer_t*>(handle); }
+	// asks script for what the queue is missing, script returns a typed array to queue or nothing
+	#if UV_VERSION_MAJOR >= 1
+	public: static void _Feed(uv_timer_t* timer)
+	#else
+	public: static void _Feed(uv_timer_t* timer, int status)
+	#endif
+	{
+		AudioDevice* device = static_cast<AudioDevice*>(timer->data); if (!device) { return; }
+		::Uint32 queued = device->Queued();
+		if (queued >= device->m_feed_target) { return; }
+		::Uint32 need = device->m_feed_target - queued;
+		need -= need % device->m_frame_size;
+		if (need == 0) { return; }
+		Nan::HandleScope scope;
+		v8::Local<v8::Value> argv[] = { Nan::New(need) };
+		v8::Local<v8::Value> result = Nan::MakeCallback(Nan::GetCurrentContext()->Global(), Nan::New<v8::Function>(device->m_feed_callback), countof(argv), argv);
+		device = static_cast<AudioDevice*>(timer->data); if (!device) { return; } // stopped or closed by the callback
+		#if NODE_VERSION_AT_LEAST(4, 0, 0)
+		if (!result.IsEmpty() && result->IsTypedArray())
+		{
+			size_t byte_length = 0;
+			const void* samples = _TypedArrayData(result, &byte_length);
+			::Uint32 size = static_cast< ::Uint32 >(byte_length);
+			device->Queue(samples, size - (size % device->m_frame_size));
+		}
+		#endif
+	}
+	public: void Pull(::Uint8* stream, int len)
+	{
+		SDL_AtomicAdd(&m_callbacks, 1);
+		::Uint64 start = m_telemetry.Begin(m_ring.Fill(), m_ring.Capacity());
+		::Uint32 size = static_cast< ::Uint32 >(len);
+		::Uint32 got = m_ring.Read(stream, size);
+		if (got < size)
+		{
+			SDL_memset(stream + got, m_spec.silence, size - got);
+			if (!m_mixer || (got > 0)) // a mixer may be all there is to play
+			{
+				SDL_AtomicAdd(&m_underruns, 1);
+				SDL_AtomicAdd(&m_underrun_frames, static_cast<int>((size - got) / m_frame_size));
+			}
+		}
+		if (m_mixer) { m_mixer->Mix(stream, len, got > 0); }
+		m_telemetry.End(start);
+	}
+	public: static void SDLCALL _Callback(void* userdata, ::Uint8* stream, int len)
+	{
+		static_cast<AudioDevice*>(userdata)->Pull(stream, len);
+	}
+	// audio thread, keeps whole frames that fit and drops the rest
+	public: void Capture(const ::Uint8* stream, int len)
+	{
+		SDL_AtomicAdd(&m_callbacks, 1);
+		::Uint64 start = m_telemetry.Begin(m_ring.Fill(), m_ring.Capacity());
+		::Uint32 size = static_cast< ::Uint32 >(len);
+		size -= size % m_frame_size;
+		::Uint32 space = m_ring.Capacity() - m_ring.Fill();
+		::Uint32 put = m_ring.Write(stream, SDL_min(size, space - (space % m_frame_size)));
+		if (put < size)
+		{
+			SDL_AtomicAdd(&m_overruns, 1);
+			SDL_AtomicAdd(&m_overrun_frames, static_cast<int>((size - put) / m_frame_size));
+		}
+		if (m_capture_async) { uv_async_send(m_capture_async); }
+		m_telemetry.End(start);
+	}
+	public: static void SDLCALL _CaptureCallback(void* userdata, ::Uint8* stream, int len)
+	{
+		static_cast<AudioDevice*>(userdata)->Capture(stream, len);
+	}
+	public: void StopCapture()
+	{
+		if (m_capture_async)
+		{
+			Lock();
+			uv_async_t* async = m_capture_async; m_capture_async = NULL;
+			Unlock();
+			async->data = NULL; // tells a running _Deliver the device is gone
+			uv_close(reinterpret_cast<uv_handle_t*>(async), _AsyncClosed);
+		}
+		m_capture_callback.Reset();
+		m_chunk_pool.Reset();
+		m_chunk_pool_count = 0;
+		m_capture_hold.Reset();
+	}
+	private: static void _AsyncClosed(uv_handle_t* handle) { delete reinterpret_cast<uv_async_t*>(handle); }
+	// a recycled chunk, or a new one typed after the device format
+	public: v8::Local<v8::Value> TakeChunk()
+	{
+		Nan::EscapableHandleScope scope;
+		if (m_chunk_pool_count > 0)
+		{
+			v8::Local<v8::Array> pool = Nan::New<v8::Array>(m_chunk_pool);
+			v8::Local<v8::Value> chunk = pool->Get(--m_chunk_pool_count);
+			pool->Set(m_chunk_pool_count, Nan::Undefined());
+			return scope.Escape(chunk);
+		}
+		#if NODE_VERSION_AT_LEAST(4, 0, 0)
+		v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), m_chunk_size);
+		switch (SDL_AUDIO_BITSIZE(m_spec.format))
+		{
+		case 32:
+			if (SDL_AUDIO_ISFLOAT(m_spec.format)) { return scope.Escape(v8::Float32Array::New(buffer, 0, m_chunk_size / 4)); }
+			return scope.Escape(v8::Int32Array::New(buffer, 0, m_chunk_size / 4));
+		case 16:
+			if (SDL_AUDIO_ISSIGNED(m_spec.format)) { return scope.Escape(v8::Int16Array::New(buffer, 0, m_chunk_size / 2)); }
+			return scope.Escape(v8::Uint16Array::New(buffer, 0, m_chunk_size / 2));
+		}
+		return scope.Escape(v8::Uint8Array::New(buffer, 0, m_chunk_size));
+		#else
+		return scope.Escape(Nan::Undefined());
+		#endif
+	}
+	// takes a chunk back unless the pool is full or already holds it, a duplicate would be handed out twice
+	public: void RecycleChunk(v8::Local<v8::Value> chunk)
+	{
+		if (m_chunk_pool.IsEmpty() || (m_chunk_pool_count >= 8)) { return; }
+		v8::Local<v8::Array> pool = Nan::New<v8::Array>(m_chunk_pool);
+		for (int index = 0; index < m_chunk_pool_count; ++index)
+		{
+			if (pool->Get(index)->StrictEquals(chunk)) { return; }
+		}
+		pool->Set(m_chunk_pool_count++, chunk);
+	}
+	// loop thread, hands every whole chunk in the ring to script
+	#if UV_VERSION_MAJOR >= 1
+	public: static void _Deliver(uv_async_t* async)
+	#else
+	public: static void _Deliver(uv_async_t* async, int status)
+	#endif
+	{
+		Nan::HandleScope scope;
+		AudioDevice* device = static_cast<AudioDevice*>(async->data);
+		while (device && (device->m_ring.Fill() >= device->m_chunk_size))
+		{
+			v8::Local<v8::Value> chunk;
+			size_t byte_length = 0;
+			void* data = NULL;
+			do // a recycled chunk may have been detached or swapped for a shorter one, drop it
+			{
+				chunk = device->TakeChunk();
+				data = _TypedArrayData(chunk, &byte_length);
+				#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+				byte_length *= SDL_AUDIO_BITSIZE(device->m_spec.format) / 8;
+				#endif
+			}
+			while ((!data || (byte_length < device->m_chunk_size)) && (device->m_chunk_pool_count > 0));
+			if (!data || (byte_length < device->m_chunk_size)) { break; }
+			device->m_ring.Read(data, device->m_chunk_size);
+			v8::Local<v8::Value> argv[] = { chunk };
+			Nan::MakeCallback(Nan::GetCurrentContext()->Global(), Nan::New<v8::Function>(device->m_capture_callback), countof(argv), argv);
+			device = static_cast<AudioDevice*>(async->data); // stopped or closed by the callback
+		}
+	}
+};
+
+class WrapAudioDevice : public Nan::ObjectWrap
+{
+private:
+	AudioDevice* m_device;
+public:
+	WrapAudioDevice(AudioDevice* device) : m_device(device) {}
+	~WrapAudioDevice() { Free(m_device); m_device = NULL; }
+public:
+	AudioDevice* Peek() { return m_device; }
+	AudioDevice* Drop() { AudioDevice* device = m_device; m_device = NULL; return device; }
+public:
+	static WrapAudioDevice* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
+	static WrapAudioDevice* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapAudioDevice>(object); }
+	static AudioDevice* Peek(v8::Local<v8::Value> value) { WrapAudioDevice* wrap = Unwrap(value); return (wrap)?(wrap->Peek()):(NULL); }
+public:
+	static v8::Local<v8::Value> Hold(AudioDevice* device) { return NewInstance(device); }
+	static AudioDevice* Drop(v8::Local<v8::Value> value) { WrapAudioDevice* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
+	static void Free(AudioDevice* device)
+	{
+		if (device) { delete device; device = NULL; }
+	}
+public:
+	static v8::Local<v8::Object> NewInstance(AudioDevice* device)
+	{
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::ObjectTemplate> object_template = GetObjectTemplate();
+		v8::Local<v8::Object> instance = object_template->NewInstance();
+		WrapAudioDevice* wrap = new WrapAudioDevice(device);
+		wrap->Wrap(instance);
+		return scope.Escape(instance);
+	}
+private:
+	static v8::Local<v8::ObjectTemplate> GetObjectTemplate()
+	{
+		Nan::EscapableHandleScope scope;
+		static Nan::Persistent<v8::ObjectTemplate> g_object_template;
+		if (g_object_template.IsEmpty())
+		{
+			v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>();
+			g_object_template.Reset(object_template);
+			object_template->SetInternalFieldCount(1);
+		}
+		v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>(g_object_template);
+		return scope.Escape(object_template);
+	}
+};
+
+// extern DECLSPEC int SDLCALL SDL_GetNumAudioDevices(int iscapture);
+NANX_EXPORT(SDL_GetNumAudioDevices)
+{
+	int iscapture = (info[0]->BooleanValue())?(1):(0);
+	info.GetReturnValue().Set(Nan::New(SDL_GetNumAudioDevices(iscapture)));
+}
+
+// extern DECLSPEC const char *SDLCALL SDL_GetAudioDeviceName(int index, int iscapture);
+NANX_EXPORT(SDL_GetAudioDeviceName)
+{
+	int index = NANX_int(info[0]);
+	int iscapture = (info[1]->BooleanValue())?(1):(0);
+	const char* name = SDL_GetAudioDeviceName(index, iscapture);
+	if (!name) { return info.GetReturnValue().SetNull(); }
+	info.GetReturnValue().Set(NANX_STRING(name));
+}
+
+// extern DECLSPEC int SDLCALL SDL_GetAudioDeviceSpec(int index, int iscapture, SDL_AudioSpec *spec);
+NANX_EXPORT(SDL_GetAudioDeviceSpec)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 16)
+	int index = NANX_int(info[0]);
+	int iscapture = (info[1]->BooleanValue())?(1):(0);
+	v8::Local<v8::Object> _spec = v8::Local<v8::Object>::Cast(info[2]);
+	SDL_AudioSpec spec;
+	SDL_zero(spec);
+	int err = SDL_GetAudioDeviceSpec(index, iscapture, &spec);
+	if (err == 0)
+	{
+		_spec->Set(NANX_SYMBOL("freq"), Nan::New(spec.freq));
+		_spec->Set(NANX_SYMBOL("format"), Nan::New(spec.format));
+		_spec->Set(NANX_SYMBOL("channels"), Nan::New(spec.channels));
+		_spec->Set(NANX_SYMBOL("samples"), Nan::New(spec.samples));
+	}
+	info.GetReturnValue().Set(Nan::New(err));
+	#else
+	return Nan::ThrowError("SDL_GetAudioDeviceSpec needs SDL 2.0.16 or later");
+	#endif
+}
+
+static bool _AudioSpecFromObject(v8::Local<v8::Value> value, SDL_AudioSpec* spec)
+{
+	SDL_zerop(spec);
+	if (!value->IsObject()) { return false; }
+	v8::Local<v8::Object> object = v8::Local<v8::Object>::Cast(value);
+	spec->freq = NANX_int(object->Get(NANX_SYMBOL("freq")));
+	spec->format = static_cast<SDL_AudioFormat>(NANX_Uint32(object->Get(NANX_SYMBOL("format"))));
+	spec->channels = static_cast< ::Uint8 >(NANX_Uint32(object->Get(NANX_SYMBOL("channels"))));
+	return true;
+}
+
+static void _AudioSpecToObject(const SDL_AudioSpec& spec, v8::Local<v8::Object> object)
+{
+	object->Set(NANX_SYMBOL("freq"), Nan::New(spec.freq));
+	object->Set(NANX_SYMBOL("format"), Nan::New(spec.format));
+	object->Set(NANX_SYMBOL("channels"), Nan::New(spec.channels));
+	object->Set(NANX_SYMBOL("silence"), Nan::New(spec.silence));
+	object->Set(NANX_SYMBOL("samples"), Nan::New(spec.samples));
+	object->Set(NANX_SYMBOL("size"), Nan::New(spec.size));
+}
+
+// extern DECLSPEC SDL_AudioDeviceID SDLCALL SDL_OpenAudioDevice(const char *device, int iscapture, const SDL_AudioSpec *desired, SDL_AudioSpec *obtained, int allowed_changes);
+// returns a device object or null, the native callback plays what SDL_EXT_AudioDevicePush queued
+// or keeps what was captured for SDL_EXT_AudioDeviceCapture
+// ring_frames sizes the ring, four callback periods by default, desired.queue opens without a callback
+NANX_EXPORT(SDL_OpenAudioDevice)
+{
+	v8::Local<v8::Object> _desired = v8::Local<v8::Object>::Cast(info[2]);
+	v8::Local<v8::Object> _obtained = v8::Local<v8::Object>::Cast(info[3]);
+	int allowed_changes = NANX_int(info[4]);
+	int iscapture = (info[1]->BooleanValue())?(1):(0);
+	bool queue = _desired->Get(NANX_SYMBOL("queue"))->BooleanValue(); // no callback, for SDL_QueueAudio and SDL_DequeueAudio
+	AudioDevice* device = new AudioDevice();
+	device->m_queue = queue;
+	device->m_capture = (iscapture != 0);
+	SDL_AudioSpec desired;
+	SDL_zero(desired);
+	desired.freq = NANX_int(_desired->Get(NANX_SYMBOL("freq")));
+	desired.format = static_cast<SDL_AudioFormat>(NANX_Uint32(_desired->Get(NANX_SYMBOL("format"))));
+	desired.channels = static_cast< ::Uint8 >(NANX_Uint32(_desired->Get(NANX_SYMBOL("channels"))));
+	desired.samples = static_cast< ::Uint16 >(NANX_Uint32(_desired->Get(NANX_SYMBOL("samples"))));
+	desired.callback = (queue)?(NULL):((iscapture)?(AudioDevice::_CaptureCallback):(AudioDevice::_Callback));
+	desired.userdata = device;
+	if (info[0]->IsString())
+	{
+		device->m_id = SDL_OpenAudioDevice(*v8::String::Utf8Value(info[0]), iscapture, &desired, &device->m_spec, allowed_changes);
+	}
+	else
+	{
+		device->m_id = SDL_OpenAudioDevice(NULL, iscapture, &desired, &device->m_spec, allowed_changes);
+	}
+	if (device->m_id == 0) { delete device; return info.GetReturnValue().SetNull(); }
+	device->m_frame_size = device->m_spec.channels * SDL_AUDIO_BITSIZE(device->m_spec.format) / 8;
+	device->m_telemetry.Init(device->m_spec);
+	int ring_frames = (info[5]->IsNumber())?(NANX_int(info[5])):(4 * device->m_spec.samples);
+	if (!queue && !device->m_ring.Alloc(static_cast< ::Uint32 >(SDL_max(ring_frames, 1)) * device->m_frame_size)) { delete device; SDL_OutOfMemory(); return info.GetReturnValue().SetNull(); }
+	_AudioSpecToObject(device->m_spec, _obtained);
+	v8::Local<v8::Object> instance = v8::Local<v8::Object>::Cast(WrapAudioDevice::Hold(device));
+	instance->Set(NANX_SYMBOL("id"), Nan::New(device->m_id)); // matches the which of SDL_AUDIODEVICEREMOVED
+	info.GetReturnValue().Set(instance);
+}
+
+// extern DECLSPEC void SDLCALL SDL_CloseAudioDevice(SDL_AudioDeviceID dev);
+NANX_EXPORT(SDL_CloseAudioDevice)
+{
+	AudioDevice* device = WrapAudioDevice::Drop(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	WrapAudioDevice::Free(device);
+}
+
+// extern DECLSPEC void SDLCALL SDL_PauseAudioDevice(SDL_AudioDeviceID dev, int pause_on);
+NANX_EXPORT(SDL_PauseAudioDevice)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	int pause_on = NANX_int(info[1]);
+	SDL_PauseAudioDevice(device->m_id, pause_on);
+}
+
+// extern DECLSPEC SDL_AudioStatus SDLCALL SDL_GetAudioDeviceStatus(SDL_AudioDeviceID dev);
+NANX_EXPORT(SDL_GetAudioDeviceStatus)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	info.GetReturnValue().Set(Nan::New(static_cast<int>(SDL_GetAudioDeviceStatus(device->m_id))));
+}
+
+// copies whole sample frames from a typed array in the device format into the ring,
+// returns the bytes taken, less than given when the ring is full
+NANX_EXPORT(SDL_EXT_AudioDevicePush)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	if (device->m_queue) { return Nan::ThrowError("queue devices take SDL_QueueAudio"); }
+	if (device->m_capture) { return Nan::ThrowError("capture devices cannot play"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsTypedArray()) { return Nan::ThrowError("samples are a typed array"); }
+	v8::Local<v8::TypedArray> _samples = v8::Local<v8::TypedArray>::Cast(info[1]);
+	if ((_samples->Length() > 0) && ((_samples->ByteLength() / _samples->Length()) != static_cast<size_t>(SDL_AUDIO_BITSIZE(device->m_spec.format) / 8)))
+	{
+		return Nan::ThrowError("sample type does not match the device format");
+	}
+	#endif
+	size_t byte_length = 0;
+	const void* samples = _TypedArrayData(info[1], &byte_length);
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= SDL_AUDIO_BITSIZE(device->m_spec.format) / 8;
+	#endif
+	::Uint32 size = static_cast< ::Uint32 >(SDL_min(byte_length, static_cast<size_t>(device->m_ring.Capacity())));
+	size -= size % device->m_frame_size;
+	::Uint32 space = device->m_ring.Capacity() - device->m_ring.Fill();
+	size = SDL_min(size, space - (space % device->m_frame_size));
+	info.GetReturnValue().Set(Nan::New(device->m_ring.Write(samples, size)));
+}
+
+// extern DECLSPEC int SDLCALL SDL_QueueAudio(SDL_AudioDeviceID dev, const void *data, Uint32 len);
+// queues the typed array's bytes, they are copied so the array can be reused at once
+NANX_EXPORT(SDL_QueueAudio)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsTypedArray()) { return Nan::ThrowError("data is a typed array"); }
+	#endif
+	size_t byte_length = 0;
+	const void* data = _TypedArrayData(info[1], &byte_length);
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= SDL_AUDIO_BITSIZE(device->m_spec.format) / 8;
+	#endif
+	int err = device->Queue(data, static_cast< ::Uint32 >(byte_length));
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// extern DECLSPEC Uint32 SDLCALL SDL_GetQueuedAudioSize(SDL_AudioDeviceID dev);
+NANX_EXPORT(SDL_GetQueuedAudioSize)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	info.GetReturnValue().Set(Nan::New(device->Queued()));
+}
+
+// extern DECLSPEC void SDLCALL SDL_ClearQueuedAudio(SDL_AudioDeviceID dev);
+NANX_EXPORT(SDL_ClearQueuedAudio)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	device->ClearQueue();
+}
+
+// extern DECLSPEC Uint32 SDLCALL SDL_DequeueAudio(SDL_AudioDeviceID dev, void *data, Uint32 len);
+// fills the typed array from a capture device, returns the bytes written
+NANX_EXPORT(SDL_DequeueAudio)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	#if SDL_VERSION_ATLEAST(2, 0, 5)
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsTypedArray()) { return Nan::ThrowError("data is a typed array"); }
+	#endif
+	size_t byte_length = 0;
+	void* data = _TypedArrayData(info[1], &byte_length);
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= SDL_AUDIO_BITSIZE(device->m_spec.format) / 8;
+	#endif
+	info.GetReturnValue().Set(Nan::New(SDL_DequeueAudio(device->m_id, data, static_cast< ::Uint32 >(byte_length))));
+	#else
+	return Nan::ThrowError("SDL_DequeueAudio needs SDL 2.0.5 or later");
+	#endif
+}
+
+// keeps about target_ms of audio queued on a queue device without script polling
+// every interval_ms, callback(bytes) is asked for what is missing and returns a typed array to queue, or nothing
+NANX_EXPORT(SDL_EXT_AudioDeviceFeed)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	if (!device->m_queue) { return Nan::ThrowError("feeding needs a queue device"); }
+	int target_ms = NANX_int(info[1]);
+	int interval_ms = SDL_max(1, NANX_int(info[2]));
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[3]);
+	device->StopFeed();
+	device->m_feed_target = static_cast< ::Uint32 >(static_cast<double>(SDL_max(target_ms, 0)) * device->m_spec.freq / 1000) * device->m_frame_size;
+	device->m_feed_callback.Reset(callback);
+	device->m_feed_hold.Reset(info[0]);
+	device->m_feeder = new uv_timer_t;
+	uv_timer_init(uv_default_loop(), device->m_feeder);
+	device->m_feeder->data = device;
+	uv_timer_start(device->m_feeder, AudioDevice::_Feed, 0, interval_ms);
+}
+
+NANX_EXPORT(SDL_EXT_AudioDeviceStopFeed)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	device->StopFeed();
+}
+
+// runs a native voice mixer inside the device callback, mixed on top of anything pushed to the ring
+// the device must play AUDIO_F32SYS or AUDIO_S16SYS in mono or stereo
+NANX_EXPORT(SDL_EXT_AudioDeviceCreateMixer)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	if (device->m_queue) { return Nan::ThrowError("queue devices have no callback to mix in"); }
+	if (device->m_capture) { return Nan::ThrowError("capture devices cannot play"); }
+	if (device->m_mixer) { return Nan::ThrowError("the device already has a mixer"); }
+	int voice_count = (info[1]->IsNumber())?(NANX_int(info[1])):(32);
+	if ((device->m_spec.format != AUDIO_F32SYS) && (device->m_spec.format != AUDIO_S16SYS))
+	{
+		SDL_SetError("the mixer needs an AUDIO_F32SYS or AUDIO_S16SYS device"); return info.GetReturnValue().Set(Nan::New(-1));
+	}
+	if ((device->m_spec.channels != 1) && (device->m_spec.channels != 2))
+	{
+		SDL_SetError("the mixer needs a mono or stereo device"); return info.GetReturnValue().Set(Nan::New(-1));
+	}
+	AudioMixer* mixer = new AudioMixer();
+	if (!mixer->Init(device->m_spec, voice_count)) { delete mixer; SDL_OutOfMemory(); return info.GetReturnValue().Set(Nan::New(-1)); }
+	device->Lock();
+	device->m_mixer = mixer;
+	device->Unlock();
+	info.GetReturnValue().Set(Nan::New(0));
+}
+
+NANX_EXPORT(SDL_EXT_AudioDeviceDestroyMixer)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	device->Lock();
+	AudioMixer* mixer = device->m_mixer; device->m_mixer = NULL;
+	device->Unlock();
+	delete mixer;
+}
+
+static AudioMixer* _AudioMixer(v8::Local<v8::Value> value)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(value);
+	return (device)?(device->m_mixer):(NULL);
+}
+
+static int _AudioMixerSent(bool sent)
+{
+	if (!sent) { return SDL_SetError("mixer command queue is full"); }
+	return 0;
+}
+
+// copies float32 frames into sample slot, replacing what the slot held once the audio thread lets go of it
+// returns 0, or -1 when the command queue is full
+NANX_EXPORT(SDL_EXT_AudioMixerLoadSample)
+{
+	AudioMixer* mixer = _AudioMixer(info[0]); if (!mixer) { return Nan::ThrowError("null AudioMixer object"); }
+	int slot = NANX_int(info[1]);
+	if ((slot < 0) || (slot >= AudioMixer::MAX_SAMPLES)) { return Nan::ThrowError("sample slot out of range"); }
+	int channels = NANX_int(info[3]);
+	if ((channels != 1) && (channels != 2)) { return Nan::ThrowError("samples have 1 or 2 channels"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[2]->IsFloat32Array()) { return Nan::ThrowError("samples are a Float32Array"); }
+	#endif
+	size_t byte_length = 0;
+	const float* frames = static_cast<const float*>(_TypedArrayData(info[2], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(float);
+	#endif
+	AudioSample* sample = new AudioSample();
+	sample->m_channels = channels;
+	sample->m_frames = static_cast< ::Uint32 >(byte_length / (channels * sizeof(float)));
+	sample->m_freq = NANX_int(info[4]);
+	sample->m_data = static_cast<float*>(SDL_malloc(SDL_max(sample->m_frames, 1u) * channels * sizeof(float)));
+	if (!sample->m_data) { delete sample; return info.GetReturnValue().Set(Nan::New(SDL_OutOfMemory())); }
+	SDL_memcpy(sample->m_data, frames, sample->m_frames * channels * sizeof(float));
+	bool sent = mixer->SetSample(slot, sample);
+	if (!sent) { delete sample; }
+	info.GetReturnValue().Set(Nan::New(_AudioMixerSent(sent)));
+}
+
+NANX_EXPORT(SDL_EXT_AudioMixerFreeSample)
+{
+	AudioMixer* mixer = _AudioMixer(info[0]); if (!mixer) { return Nan::ThrowError("null AudioMixer object"); }
+	int slot = NANX_int(info[1]);
+	if ((slot < 0) || (slot >= AudioMixer::MAX_SAMPLES)) { return Nan::ThrowError("sample slot out of range"); }
+	info.GetReturnValue().Set(Nan::New(_AudioMixerSent(mixer->SetSample(slot, NULL))));
+}
+
+// starts voice on a sample slot, loop_end 0 plays once
+NANX_EXPORT(SDL_EXT_AudioMixerPlay)
+{
+	AudioMixer* mixer = _AudioMixer(info[0]); if (!mixer) { return Nan::ThrowError("null AudioMixer object"); }
+	int voice = NANX_int(info[1]);
+	if ((voice < 0) || (voice >= mixer->VoiceCount())) { return Nan::ThrowError("voice out of range"); }
+	int slot = NANX_int(info[2]);
+	if ((slot < 0) || (slot >= AudioMixer::MAX_SAMPLES)) { return Nan::ThrowError("sample slot out of range"); }
+	float gain = (info[3]->IsNumber())?(static_cast<float>(info[3]->NumberValue())):(1.0f);
+	float pan = (info[4]->IsNumber())?(static_cast<float>(info[4]->NumberValue())):(0.0f);
+	float pitch = (info[5]->IsNumber())?(static_cast<float>(info[5]->NumberValue())):(1.0f);
+	::Uint32 loop_start = (info[6]->IsNumber())?(NANX_Uint32(info[6])):(0);
+	::Uint32 loop_end = (info[7]->IsNumber())?(NANX_Uint32(info[7])):(0);
+	info.GetReturnValue().Set(Nan::New(_AudioMixerSent(mixer->Play(voice, slot, gain, pan, pitch, loop_start, loop_end))));
+}
+
+NANX_EXPORT(SDL_EXT_AudioMixerStop)
+{
+	AudioMixer* mixer = _AudioMixer(info[0]); if (!mixer) { return Nan::ThrowError("null AudioMixer object"); }
+	int voice = NANX_int(info[1]);
+	if ((voice < 0) || (voice >= mixer->VoiceCount())) { return Nan::ThrowError("voice out of range"); }
+	info.GetReturnValue().Set(Nan::New(_AudioMixerSent(mixer->Stop(voice))));
+}
+
+// param is one of SDL_EXT_MIXER_GAIN, PAN, PITCH, LOOP_START or LOOP_END
+NANX_EXPORT(SDL_EXT_AudioMixerSetVoice)
+{
+	AudioMixer* mixer = _AudioMixer(info[0]); if (!mixer) { return Nan::ThrowError("null AudioMixer object"); }
+	int voice = NANX_int(info[1]);
+	if ((voice < 0) || (voice >= mixer->VoiceCount())) { return Nan::ThrowError("voice out of range"); }
+	int param = NANX_int(info[2]);
+	double value = info[3]->NumberValue();
+	info.GetReturnValue().Set(Nan::New(_AudioMixerSent(mixer->SetParam(voice, param, value))));
+}
+
+NANX_EXPORT(SDL_EXT_AudioMixerSetGain)
+{
+	AudioMixer* mixer = _AudioMixer(info[0]); if (!mixer) { return Nan::ThrowError("null AudioMixer object"); }
+	float gain = static_cast<float>(info[1]->NumberValue());
+	info.GetReturnValue().Set(Nan::New(_AudioMixerSent(mixer->SetMaster(gain))));
+}
+
+// calls callback(chunk) on the loop thread with each chunk_frames of captured audio
+// chunks are typed after the device format, hand them back with SDL_EXT_AudioDeviceRecycle to reuse them
+// latency is bounded by the ring, what does not fit is dropped and counted as an overrun
+NANX_EXPORT(SDL_EXT_AudioDeviceCapture)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	if (!device->m_capture || device->m_queue) { return Nan::ThrowError("capture needs a capture device opened without desired.queue"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	int chunk_frames = NANX_int(info[1]);
+	::Uint32 chunk_size = static_cast< ::Uint32 >(SDL_max(chunk_frames, 1)) * device->m_frame_size;
+	if (chunk_size > device->m_ring.Capacity()) { return Nan::ThrowError("chunk larger than the capture ring"); }
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[2]);
+	device->StopCapture();
+	device->m_chunk_size = chunk_size;
+	device->m_capture_callback.Reset(callback);
+	device->m_chunk_pool.Reset(Nan::New<v8::Array>());
+	device->m_capture_hold.Reset(info[0]);
+	uv_async_t* async = new uv_async_t;
+	uv_async_init(uv_default_loop(), async, AudioDevice::_Deliver);
+	async->data = device;
+	device->Lock();
+	device->m_capture_async = async;
+	device->Unlock();
+	uv_async_send(async); // delivers what was captured before
+	#else
+	return Nan::ThrowError("SDL_EXT_AudioDeviceCapture needs node 4 or later");
+	#endif
+}
+
+NANX_EXPORT(SDL_EXT_AudioDeviceStopCapture)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	device->StopCapture();
+}
+
+// returns a delivered chunk for reuse, script must not touch it afterwards
+// detached arrays, arrays of another size and chunks already returned are ignored
+NANX_EXPORT(SDL_EXT_AudioDeviceRecycle)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsTypedArray()) { return; }
+	v8::Local<v8::TypedArray> chunk = v8::Local<v8::TypedArray>::Cast(info[1]);
+	if (chunk->ByteLength() != device->m_chunk_size) { return; }
+	if (chunk->Buffer()->GetContents().Data() == NULL) { return; } // detached
+	device->RecycleChunk(chunk);
+	#endif
+}
+
+// copies the device's telemetry into a Float64Array of SDL_EXT_AUDIO_TELEMETRY_SIZE values,
+// indexed by the SDL_EXT_AUDIO_TELEMETRY constants, reset clears timing and fill once read
+NANX_EXPORT(SDL_EXT_AudioDeviceTelemetry)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsFloat64Array()) { return Nan::ThrowError("telemetry is a Float64Array"); }
+	#endif
+	size_t byte_length = 0;
+	double* out = static_cast<double*>(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(double);
+	#endif
+	if (byte_length < SDL_EXT_AUDIO_TELEMETRY_SIZE * sizeof(double)) { return Nan::ThrowError("telemetry array too small"); }
+	device->m_telemetry.Read(out);
+	out[SDL_EXT_AUDIO_TELEMETRY_UNDERRUNS] = SDL_AtomicGet(&device->m_underruns);
+	out[SDL_EXT_AUDIO_TELEMETRY_UNDERRUN_FRAMES] = SDL_AtomicGet(&device->m_underrun_frames);
+	out[SDL_EXT_AUDIO_TELEMETRY_OVERRUNS] = SDL_AtomicGet(&device->m_overruns);
+	out[SDL_EXT_AUDIO_TELEMETRY_OVERRUN_FRAMES] = SDL_AtomicGet(&device->m_overrun_frames);
+	if (info[2]->BooleanValue()) { device->m_telemetry.Reset(); }
+}
+
+// a device with the desired spec and no SDL device behind it, for tests and exports
+// desired.queue makes it a queue device whose queue holds ring_frames, a second by default,
+// otherwise it plays its ring and mixer like a callback device
+NANX_EXPORT(SDL_EXT_OpenOfflineAudioDevice)
+{
+	v8::Local<v8::Object> _desired = v8::Local<v8::Object>::Cast(info[0]);
+	v8::Local<v8::Object> _obtained = v8::Local<v8::Object>::Cast(info[1]);
+	SDL_AudioSpec spec; _AudioSpecFromObject(_desired, &spec);
+	spec.samples = static_cast< ::Uint16 >(NANX_Uint32(_desired->Get(NANX_SYMBOL("samples"))));
+	if (spec.samples == 0) { spec.samples = 1024; }
+	if ((spec.freq <= 0) || (spec.channels == 0) || (SDL_AUDIO_BITSIZE(spec.format) == 0))
+	{
+		SDL_SetError("offline devices need a freq, format and channels"); return info.GetReturnValue().SetNull();
+	}
+	spec.silence = (spec.format == AUDIO_U8)?(0x80):(0x00);
+	AudioDevice* device = new AudioDevice();
+	device->m_offline = true;
+	device->m_queue = _desired->Get(NANX_SYMBOL("queue"))->BooleanValue();
+	device->m_frame_size = spec.channels * SDL_AUDIO_BITSIZE(spec.format) / 8;
+	spec.size = spec.samples * device->m_frame_size;
+	device->m_spec = spec;
+	device->m_telemetry.Init(device->m_spec);
+	int ring_frames = (info[2]->IsNumber())?(NANX_int(info[2])):((device->m_queue)?(spec.freq):(4 * spec.samples));
+	if (!device->m_ring.Alloc(static_cast< ::Uint32 >(SDL_max(ring_frames, 1)) * device->m_frame_size)) { delete device; SDL_OutOfMemory(); return info.GetReturnValue().SetNull(); }
+	_AudioSpecToObject(device->m_spec, _obtained);
+	v8::Local<v8::Object> instance = v8::Local<v8::Object>::Cast(WrapAudioDevice::Hold(device));
+	instance->Set(NANX_SYMBOL("id"), Nan::New(0));
+	info.GetReturnValue().Set(instance);
+}
+
+// fills the typed array with the offline device's next frames, returns the bytes written
+NANX_EXPORT(SDL_EXT_AudioDeviceRender)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	if (!device->m_offline) { return Nan::ThrowError("rendering needs an offline device"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsTypedArray()) { return Nan::ThrowError("stream is a typed array"); }
+	#endif
+	size_t byte_length = 0;
+	::Uint8* stream = static_cast< ::Uint8* >(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= SDL_AUDIO_BITSIZE(device->m_spec.format) / 8;
+	#endif
+	::Uint32 size = static_cast< ::Uint32 >(byte_length);
+	size -= size % device->m_frame_size;
+	device->Render(stream, size);
+	info.GetReturnValue().Set(Nan::New(size));
+}
+
+NANX_EXPORT(SDL_EXT_AudioDeviceStats)
+{
+	AudioDevice* device = WrapAudioDevice::Peek(info[0]); if (!device) { return Nan::ThrowError("null SDL_AudioDevice object"); }
+	v8::Local<v8::Object> stats = Nan::New<v8::Object>();
+	stats->Set(NANX_SYMBOL("fill"), Nan::New(device->m_ring.Fill())); // bytes
+	stats->Set(NANX_SYMBOL("capacity"), Nan::New(device->m_ring.Capacity())); // bytes
+	stats->Set(NANX_SYMBOL("callbacks"), Nan::New(SDL_AtomicGet(&device->m_callbacks)));
+	stats->Set(NANX_SYMBOL("underruns"), Nan::New(SDL_AtomicGet(&device->m_underruns)));
+	stats->Set(NANX_SYMBOL("underrun_frames"), Nan::New(SDL_AtomicGet(&device->m_underrun_frames)));
+	stats->Set(NANX_SYMBOL("overruns"), Nan::New(SDL_AtomicGet(&device->m_overruns)));
+	stats->Set(NANX_SYMBOL("overrun_frames"), Nan::New(SDL_AtomicGet(&device->m_overrun_frames)));
+	if (device->m_mixer) { stats->Set(NANX_SYMBOL("voices"), Nan::New(SDL_AtomicGet(&device->m_mixer->m_active))); }
+	info.GetReturnValue().Set(stats);
+}
+
+// converts a whole buffer between specs, *out is SDL_malloc'd and may be larger than *out_len
+static int _ConvertAudio(const SDL_AudioSpec& src, const ::Uint8* data, ::Uint32 len, const SDL_AudioSpec& dst, ::Uint8** out, ::Uint32* out_len)
+{
+	*out = NULL; *out_len = 0;
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioStream* stream = SDL_NewAudioStream(src.format, src.channels, src.freq, dst.format, dst.channels, dst.freq);
+	if (!stream) { return -1; }
+	int err = SDL_AudioStreamPut(stream, data, static_cast<int>(len));
+	if (err == 0) { err = SDL_AudioStreamFlush(stream); }
+	int available = (err == 0)?(SDL_AudioStreamAvailable(stream)):(0);
+	if (err == 0)
+	{
+		*out = static_cast< ::Uint8* >(SDL_malloc(SDL_max(available, 1)));
+		if (!*out) { err = SDL_OutOfMemory(); }
+	}
+	if (err == 0)
+	{
+		int got = SDL_AudioStreamGet(stream, *out, available);
+		if (got < 0) { err = got; SDL_free(*out); *out = NULL; }
+		else { *out_len = static_cast< ::Uint32 >(got); }
+	}
+	SDL_FreeAudioStream(stream);
+	return err;
+	#else
+	SDL_AudioCVT cvt;
+	int built = SDL_BuildAudioCVT(&cvt, src.format, src.channels, src.freq, dst.format, dst.channels, dst.freq);
+	if (built < 0) { return built; }
+	cvt.len = static_cast<int>(len);
+	cvt.buf = static_cast< ::Uint8* >(SDL_malloc(SDL_max(static_cast<size_t>(len) * cvt.len_mult, 1)));
+	if (!cvt.buf) { return SDL_OutOfMemory(); }
+	SDL_memcpy(cvt.buf, data, len);
+	int err = (built)?(SDL_ConvertAudio(&cvt)):(0);
+	if (err < 0) { SDL_free(cvt.buf); return err; }
+	*out = cvt.buf; *out_len = static_cast< ::Uint32 >((built)?(cvt.len_cvt):(cvt.len));
+	return 0;
+	#endif
+}
+
+static void _FreeAudioData(char* data, void* hint) { SDL_free(data); }
+
+// load WAV, optionally converted to a target spec on the worker
+// resolves to { freq, format, channels, data } where data is a Buffer over the decoded samples, no copy is made
+
+class TaskLoadWAV : public Nanx::SimpleTask
+{
+	public: char* m_file;
+	public: bool m_convert;
+	public: SDL_AudioSpec m_target;
+	public: SDL_AudioSpec m_spec;
+	public: ::Uint8* m_data;
+	public: ::Uint32 m_len;
+	public: TaskLoadWAV(v8::Local<v8::String> file, const SDL_AudioSpec* target) :
+		m_file(strdup(*v8::String::Utf8Value(file))),
+		m_convert(target != NULL),
+		m_data(NULL),
+		m_len(0)
+	{
+		if (target) { m_target = *target; } else { SDL_zero(m_target); }
+		SDL_zero(m_spec);
+	}
+	public: ~TaskLoadWAV()
+	{
+		free(m_file); m_file = NULL; // strdup
+		SDL_free(m_data); m_data = NULL;
+	}
+	public: void DoWork()
+	{
+		if (!SDL_LoadWAV(m_file, &m_spec, &m_data, &m_len)) { m_data = NULL; SetError(SDL_GetError()); return; }
+		if (m_convert && ((m_spec.freq != m_target.freq) || (m_spec.format != m_target.format) || (m_spec.channels != m_target.channels)))
+		{
+			::Uint8* data = NULL; ::Uint32 len = 0;
+			int err = _ConvertAudio(m_spec, m_data, m_len, m_target, &data, &len);
+			SDL_FreeWAV(m_data); m_data = NULL;
+			if (err < 0) { SetError(SDL_GetError()); return; }
+			m_data = data; m_len = len;
+			m_spec.freq = m_target.freq; m_spec.format = m_target.format; m_spec.channels = m_target.channels;
+		}
+	}
+	public: v8::Local<v8::Value> DoAfterWork(int status)
+	{
+		if (!m_data) { return Nan::Null(); }
+		v8::Local<v8::Object> wav = Nan::New<v8::Object>();
+		wav->Set(NANX_SYMBOL("freq"), Nan::New(m_spec.freq));
+		wav->Set(NANX_SYMBOL("format"), Nan::New(m_spec.format));
+		wav->Set(NANX_SYMBOL("channels"), Nan::New(m_spec.channels));
+		wav->Set(NANX_SYMBOL("data"), Nan::NewBuffer(reinterpret_cast<char*>(m_data), m_len, _FreeAudioData, NULL).ToLocalChecked());
+		m_data = NULL; // script owns samples
+		return wav;
+	}
+};
+
+// extern DECLSPEC SDL_AudioSpec *SDLCALL SDL_LoadWAV_RW(SDL_RWops * src, int freesrc, SDL_AudioSpec * spec, Uint8 ** audio_buf, Uint32 * audio_len);
+NANX_EXPORT(SDL_LoadWAV)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[1]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	int id = Nanx::SimpleTask::Run(new TaskLoadWAV(file, NULL), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_LoadWAVPromise)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[1]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskLoadWAV(file, NULL), priority));
+}
+
+// loads and converts to spec { freq, format, channels }, typically a device's obtained spec
+NANX_EXPORT(SDL_EXT_LoadWAVAs)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	SDL_AudioSpec target; _AudioSpecFromObject(info[1], &target);
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[2]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[3]);
+	int id = Nanx::SimpleTask::Run(new TaskLoadWAV(file, &target), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_LoadWAVAsPromise)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	SDL_AudioSpec target; _AudioSpecFromObject(info[1], &target);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskLoadWAV(file, &target), priority));
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 7)
+
+class WrapAudioStream : public Nan::ObjectWrap
+{
+private:
+	SDL_AudioStream* m_stream;
+public:
+	WrapAudioStream(SDL_AudioStream* stream) : m_stream(stream) {}
+	~WrapAudioStream() { Free(m_stream); m_stream = NULL; }
+public:
+	SDL_AudioStream* Peek() { return m_stream; }
+	SDL_AudioStream* Drop() { SDL_AudioStream* stream = m_stream; m_stream = NULL; return stream; }
+public:
+	static WrapAudioStream* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
+	static WrapAudioStream* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapAudioStream>(object); }
+	static SDL_AudioStream* Peek(v8::Local<v8::Value> value) { WrapAudioStream* wrap = Unwrap(value); return (wrap)?(wrap->Peek()):(NULL); }
+public:
+	static v8::Local<v8::Value> Hold(SDL_AudioStream* stream) { if (stream) { return NewInstance(stream); } return Nan::Null(); }
+	static SDL_AudioStream* Drop(v8::Local<v8::Value> value) { WrapAudioStream* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
+	static void Free(SDL_AudioStream* stream)
+	{
+		if (stream) { SDL_FreeAudioStream(stream); stream = NULL; }
+	}
+public:
+	static v8::Local<v8::Object> NewInstance(SDL_AudioStream* stream)
+	{
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::ObjectTemplate> object_template = GetObjectTemplate();
+		v8::Local<v8::Object> instance = object_template->NewInstance();
+		WrapAudioStream* wrap = new WrapAudioStream(stream);
+		wrap->Wrap(instance);
+		return scope.Escape(instance);
+	}
+private:
+	static v8::Local<v8::ObjectTemplate> GetObjectTemplate()
+	{
+		Nan::EscapableHandleScope scope;
+		static Nan::Persistent<v8::ObjectTemplate> g_object_template;
+		if (g_object_template.IsEmpty())
+		{
+			v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>();
+			g_object_template.Reset(object_template);
+			object_template->SetInternalFieldCount(1);
+		}
+		v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>(g_object_template);
+		return scope.Escape(object_template);
+	}
+};
+
+#endif
+
+// extern DECLSPEC SDL_AudioStream * SDLCALL SDL_NewAudioStream(const SDL_AudioFormat src_format, const Uint8 src_channels, const int src_rate, const SDL_AudioFormat dst_format, const Uint8 dst_channels, const int dst_rate);
+NANX_EXPORT(SDL_NewAudioStream)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioFormat src_format = static_cast<SDL_AudioFormat>(NANX_Uint32(info[0]));
+	::Uint8 src_channels = static_cast< ::Uint8 >(NANX_Uint32(info[1]));
+	int src_rate = NANX_int(info[2]);
+	SDL_AudioFormat dst_format = static_cast<SDL_AudioFormat>(NANX_Uint32(info[3]));
+	::Uint8 dst_channels = static_cast< ::Uint8 >(NANX_Uint32(info[4]));
+	int dst_rate = NANX_int(info[5]);
+	SDL_AudioStream* stream = SDL_NewAudioStream(src_format, src_channels, src_rate, dst_format, dst_channels, dst_rate);
+	info.GetReturnValue().Set(WrapAudioStream::Hold(stream));
+	#else
+	return Nan::ThrowError("SDL_NewAudioStream needs SDL 2.0.7 or later");
+	#endif
+}
+
+// extern DECLSPEC int SDLCALL SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len);
+NANX_EXPORT(SDL_AudioStreamPut)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioStream* stream = WrapAudioStream::Peek(info[0]); if (!stream) { return Nan::ThrowError("null SDL_AudioStream object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsTypedArray()) { return Nan::ThrowError("data is a typed array"); }
+	#endif
+	size_t byte_length = 0;
+	const void* data = _TypedArrayData(info[1], &byte_length);
+	int err = SDL_AudioStreamPut(stream, data, static_cast<int>(byte_length));
+	info.GetReturnValue().Set(Nan::New(err));
+	#else
+	return Nan::ThrowError("SDL_AudioStreamPut needs SDL 2.0.7 or later");
+	#endif
+}
+
+// extern DECLSPEC int SDLCALL SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len);
+// fills the typed array, returns the bytes written or an error
+NANX_EXPORT(SDL_AudioStreamGet)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioStream* stream = WrapAudioStream::Peek(info[0]); if (!stream) { return Nan::ThrowError("null SDL_AudioStream object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsTypedArray()) { return Nan::ThrowError("data is a typed array"); }
+	#endif
+	size_t byte_length = 0;
+	void* data = _TypedArrayData(info[1], &byte_length);
+	info.GetReturnValue().Set(Nan::New(SDL_AudioStreamGet(stream, data, static_cast<int>(byte_length))));
+	#else
+	return Nan::ThrowError("SDL_AudioStreamGet needs SDL 2.0.7 or later");
+	#endif
+}
+
+// extern DECLSPEC int SDLCALL SDL_AudioStreamAvailable(SDL_AudioStream *stream);
+NANX_EXPORT(SDL_AudioStreamAvailable)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioStream* stream = WrapAudioStream::Peek(info[0]); if (!stream) { return Nan::ThrowError("null SDL_AudioStream object"); }
+	info.GetReturnValue().Set(Nan::New(SDL_AudioStreamAvailable(stream)));
+	#else
+	return Nan::ThrowError("SDL_AudioStreamAvailable needs SDL 2.0.7 or later");
+	#endif
+}
+
+// extern DECLSPEC int SDLCALL SDL_AudioStreamFlush(SDL_AudioStream *stream);
+NANX_EXPORT(SDL_AudioStreamFlush)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioStream* stream = WrapAudioStream::Peek(info[0]); if (!stream) { return Nan::ThrowError("null SDL_AudioStream object"); }
+	info.GetReturnValue().Set(Nan::New(SDL_AudioStreamFlush(stream)));
+	#else
+	return Nan::ThrowError("SDL_AudioStreamFlush needs SDL 2.0.7 or later");
+	#endif
+}
+
+// extern DECLSPEC void SDLCALL SDL_AudioStreamClear(SDL_AudioStream *stream);
+NANX_EXPORT(SDL_AudioStreamClear)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioStream* stream = WrapAudioStream::Peek(info[0]); if (!stream) { return Nan::ThrowError("null SDL_AudioStream object"); }
+	SDL_AudioStreamClear(stream);
+	#else
+	return Nan::ThrowError("SDL_AudioStreamClear needs SDL 2.0.7 or later");
+	#endif
+}
+
+// extern DECLSPEC void SDLCALL SDL_FreeAudioStream(SDL_AudioStream *stream);
+NANX_EXPORT(SDL_FreeAudioStream)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	SDL_AudioStream* stream = WrapAudioStream::Drop(info[0]); if (!stream) { return Nan::ThrowError("null SDL_AudioStream object"); }
+	WrapAudioStream::Free(stream);
+	#else
+	return Nan::ThrowError("SDL_FreeAudioStream needs SDL 2.0.7 or later");
+	#endif
+}
+
+// SDL_bits.h
+
+// SDL_blendmode.h
+
+// SDL_clipboard.h
+
+NANX_EXPORT(SDL_SetClipboardText)
+{
+	v8::Local<v8::String> text = v8::Local<v8::String>::Cast(info[0]);
+	int err = SDL_SetClipboardText(*v8::String::Utf8Value(text));
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+NANX_EXPORT(SDL_GetClipboardText)
+{
+	const char* clipboard_text = SDL_GetClipboardText();
+	info.GetReturnValue().Set(NANX_STRING(clipboard_text));
+}
+
+NANX_EXPORT(SDL_HasClipboardText)
+{
+	SDL_bool has_clipboard_text = SDL_HasClipboardText();
+	info.GetReturnValue().Set(Nan::New(has_clipboard_text != SDL_FALSE));
+}
+
+// SDL_config.h
+// SDL_config_android.h
+// SDL_config_iphoneos.h
+// SDL_config_macosx.h
+// SDL_config_minimal.h
+// SDL_config_pandora.h
+// SDL_config_psp.h
+// SDL_config_windows.h
+// SDL_config_wiz.h
+// SDL_copying.h
+
+// SDL_cpuinfo.h
+
+// TODO: #define SDL_CACHELINE_SIZE  128
+// TODO: extern DECLSPEC int SDLCALL SDL_GetCPUCount(void);
+// TODO: extern DECLSPEC int SDLCALL SDL_GetCPUCacheLineSize(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasRDTSC(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasAltiVec(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasMMX(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_Has3DNow(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE2(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE3(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE41(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE42(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX(void);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX2(void);
+// TODO: extern DECLSPEC int SDLCALL SDL_GetSystemRAM(void);
 
 // SDL_endian.h
 
-// SDL_error.h
+// SDL_error.h
+
+NANX_EXPORT(SDL_GetError)
+{
+	const char* sdl_error = SDL_GetError();
+	info.GetReturnValue().Set(NANX_STRING(sdl_error));
+}
+
+NANX_EXPORT(SDL_ClearError)
+{
+	SDL_ClearError();
+}
+
+// SDL_events.h
+
+NANX_EXPORT(SDL_PollEvent)
+{
+	SDL_Event event;
+	if (!SDL_PollEvent(&event))
+	{
+		info.GetReturnValue().SetNull();
+		return;
+	}
+
+	v8::Local<v8::Object> evt = Nan::New<v8::Object>();
+	evt->Set(NANX_SYMBOL("type"), Nan::New(event.type));
+	evt->Set(NANX_SYMBOL("timestamp"), Nan::New(event.common.timestamp));
+
+	switch (event.type)
+	{
+	case SDL_QUIT:
+		//info.GetReturnValue().Set(n_SDL_QuitEvent::NewInstance(event.quit));
+		break;
+	case SDL_APP_TERMINATING:
+	case SDL_APP_LOWMEMORY:
+	case SDL_APP_WILLENTERBACKGROUND:
+	case SDL_APP_DIDENTERBACKGROUND:
+	case SDL_APP_WILLENTERFOREGROUND:
+	case SDL_APP_DIDENTERFOREGROUND:
+		//info.GetReturnValue().Set(WrapCommonEvent::NewInstance(event.common));
+		break;
+	case SDL_WINDOWEVENT:
+		//info.GetReturnValue().Set(WrapWindowEvent::NewInstance(event.window));
+		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.window.windowID));
+		evt->Set(NANX_SYMBOL("event"), Nan::New(event.window.event));
+		evt->Set(NANX_SYMBOL("data1"), Nan::New(event.window.data1));
+		evt->Set(NANX_SYMBOL("data2"), Nan::New(event.window.data2));
+		if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+		{
+			SDL_Window* window = SDL_GetWindowFromID(event.window.windowID);
+			if (window) { WrapSurface::InvalidateWindowSurface(window); } // SDL frees the old surface on the next get
+		}
+		break;
+	case SDL_SYSWMEVENT:
+		// TODO
+		break;
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.key.windowID));
+		evt->Set(NANX_SYMBOL("state"), Nan::New(event.key.state));
+		evt->Set(NANX_SYMBOL("repeat"), Nan::New(event.key.repeat));
+		evt->Set(NANX_SYMBOL("scancode"), Nan::New(event.key.keysym.scancode));
+		evt->Set(NANX_SYMBOL("sym"), Nan::New(event.key.keysym.sym));
+		evt->Set(NANX_SYMBOL("mod"), Nan::New(event.key.keysym.mod));
+		break;
+	case SDL_TEXTEDITING:
+	case SDL_TEXTINPUT:
+		// TODO
+		break;
+	case SDL_MOUSEMOTION:
+		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.motion.windowID));
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.motion.which));
+		evt->Set(NANX_SYMBOL("state"), Nan::New(event.motion.state));
+		evt->Set(NANX_SYMBOL("x"), Nan::New(event.motion.x));
+		evt->Set(NANX_SYMBOL("y"), Nan::New(event.motion.y));
+		evt->Set(NANX_SYMBOL("xrel"), Nan::New(event.motion.xrel));
+		evt->Set(NANX_SYMBOL("yrel"), Nan::New(event.motion.yrel));
+		{
+			int w = 0, h = 0;
+			SDL_GetWindowSize(SDL_GetWindowFromID(event.motion.windowID), &w, &h);
+			evt->Set(NANX_SYMBOL("nx"), Nan::New((2.0f * float(event.motion.x) / w) - 1.0f));
+			evt->Set(NANX_SYMBOL("ny"), Nan::New(1.0f - (2.0f * float(event.motion.y) / h)));
+		}
+		break;
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.button.windowID));
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.button.which));
+		evt->Set(NANX_SYMBOL("button"), Nan::New(event.button.button));
+		evt->Set(NANX_SYMBOL("state"), Nan::New(event.button.state));
+		evt->Set(NANX_SYMBOL("x"), Nan::New(event.button.x));
+		evt->Set(NANX_SYMBOL("y"), Nan::New(event.button.y));
+		{
+			int w = 0, h = 0;
+			SDL_GetWindowSize(SDL_GetWindowFromID(event.button.windowID), &w, &h);
+			evt->Set(NANX_SYMBOL("nx"), Nan::New((2.0f * float(event.button.x) / w) - 1.0f));
+			evt->Set(NANX_SYMBOL("ny"), Nan::New(1.0f - (2.0f * float(event.button.y) / h)));
+		}
+		break;
+	case SDL_MOUSEWHEEL:
+		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.wheel.windowID));
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.wheel.which));
+		evt->Set(NANX_SYMBOL("x"), Nan::New(event.wheel.x));
+		evt->Set(NANX_SYMBOL("y"), Nan::New(event.wheel.y));
+		break;
+	case SDL_JOYAXISMOTION:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jaxis.which));
+		evt->Set(NANX_SYMBOL("axis"), Nan::New(event.jaxis.axis));
+		evt->Set(NANX_SYMBOL("value"), Nan::New(event.jaxis.value));
+		break;
+	case SDL_JOYBALLMOTION:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jball.which));
+		evt->Set(NANX_SYMBOL("ball"), Nan::New(event.jball.ball));
+		evt->Set(NANX_SYMBOL("xrel"), Nan::New(event.jball.xrel));
+		evt->Set(NANX_SYMBOL("yrel"), Nan::New(event.jball.yrel));
+		break;
+	case SDL_JOYHATMOTION:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jhat.which));
+		evt->Set(NANX_SYMBOL("hat"), Nan::New(event.jhat.hat));
+		evt->Set(NANX_SYMBOL("value"), Nan::New(event.jhat.value));
+		break;
+	case SDL_JOYBUTTONDOWN:
+	case SDL_JOYBUTTONUP:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jbutton.which));
+		evt->Set(NANX_SYMBOL("button"), Nan::New(event.jbutton.button));
+		evt->Set(NANX_SYMBOL("state"), Nan::New(event.jbutton.state));
+		break;
+	case SDL_JOYDEVICEADDED:
+	case SDL_JOYDEVICEREMOVED:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jdevice.which));
+		break;
+	case SDL_CONTROLLERAXISMOTION:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.caxis.which));
+		evt->Set(NANX_SYMBOL("axis"), Nan::New(event.caxis.axis));
+		evt->Set(NANX_SYMBOL("value"), Nan::New(event.caxis.value));
+		break;
+	case SDL_CONTROLLERBUTTONDOWN:
+	case SDL_CONTROLLERBUTTONUP:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.cbutton.which));
+		evt->Set(NANX_SYMBOL("button"), Nan::New(event.cbutton.button));
+		evt->Set(NANX_SYMBOL("state"), Nan::New(event.cbutton.state));
+		break;
+	case SDL_CONTROLLERDEVICEADDED:
+	case SDL_CONTROLLERDEVICEREMOVED:
+	case SDL_CONTROLLERDEVICEREMAPPED:
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.cdevice.which));
+		break;
+	case SDL_FINGERDOWN:
+	case SDL_FINGERUP:
+	case SDL_FINGERMOTION:
+		//evt->Set(NANX_SYMBOL("touchId"), Nan::New((int32_t) event.tfinger.touchId)); // TODO: 64 bit integer
+		//evt->Set(NANX_SYMBOL("fingerId"), Nan::New((int32_t) event.tfinger.fingerId)); // TODO: 64 bit integer
+		{
+			char buffer[64];
+			SDL_snprintf(buffer, sizeof(buffer), "%" SDL_PRIs64, event.tfinger.touchId);
+			evt->Set(NANX_SYMBOL("touchId"), NANX_STRING(buffer));
+			SDL_snprintf(buffer, sizeof(buffer), "%" SDL_PRIs64, event.tfinger.fingerId);
+			evt->Set(NANX_SYMBOL("fingerId"), NANX_STRING(buffer));
+		}
+		evt->Set(NANX_SYMBOL("x"), Nan::New(event.tfinger.x));
+		evt->Set(NANX_SYMBOL("y"), Nan::New(event.tfinger.y));
+		evt->Set(NANX_SYMBOL("dx"), Nan::New(event.tfinger.dx));
+		evt->Set(NANX_SYMBOL("dy"), Nan::New(event.tfinger.dy));
+		evt->Set(NANX_SYMBOL("pressure"), Nan::New(event.tfinger.pressure));
+		evt->Set(NANX_SYMBOL("nx"), Nan::New((2.0f * float(event.tfinger.x)) - 1.0f));
+		evt->Set(NANX_SYMBOL("ny"), Nan::New(1.0f - (2.0f * float(event.tfinger.y))));
+		break;
+	#if SDL_VERSION_ATLEAST(2,0,4)
+	case SDL_RENDER_TARGETS_RESET:
+	case SDL_RENDER_DEVICE_RESET:
+		WrapRenderer::TargetsReset(); // target texture contents are lost, layers redraw on next update
+		break;
+	#endif
+	#if SDL_VERSION_ATLEAST(2,0,4)
+	case SDL_AUDIODEVICEADDED:
+	case SDL_AUDIODEVICEREMOVED:
+		// which is a device index when added and an open device id when removed
+		evt->Set(NANX_SYMBOL("which"), Nan::New(event.adevice.which));
+		evt->Set(NANX_SYMBOL("iscapture"), Nan::New(event.adevice.iscapture != 0));
+		break;
+	#endif
+	case SDL_DOLLARGESTURE:
+	case SDL_DOLLARRECORD:
+	case SDL_MULTIGESTURE:
+	case SDL_CLIPBOARDUPDATE:
+	case SDL_DROPFILE:
+	#if SDL_VERSION_ATLEAST(2,0,5)
+	case SDL_DROPTEXT:
+	case SDL_DROPBEGIN:
+	case SDL_DROPCOMPLETE:
+	#endif
+	case SDL_USEREVENT:
+		// TODO
+		break;
+	default:
+		break;
+	}
+
+	info.GetReturnValue().Set(evt);
+}
+
+// SDL_gamecontroller.h
+
+// extern DECLSPEC int SDLCALL SDL_GameControllerAddMapping(const char* mappingString);
+NANX_EXPORT(SDL_GameControllerAddMapping)
+{
+	v8::Local<v8::String> mapping = v8::Local<v8::String>::Cast(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_GameControllerAddMapping(*v8::String::Utf8Value(mapping))));
+}
+
+// add mappings from a gamecontrollerdb.txt style file
+// the file is read on the worker, the mappings are added on the loop thread since SDL does not
+// guard its mapping list against a concurrent SDL_GameControllerOpen or event pump
+
+// drops comments, blank lines and the lines of other platforms in place, lines without a platform field stay
+// SDL skips the same lines, filtering them on a worker leaves it only this platform's lines to parse
+static size_t _GameControllerMappingsFilter(char* data, size_t size)
+{
+	static const char field[] = "platform:";
+	const char* platform = SDL_GetPlatform();
+	size_t platform_length = SDL_strlen(platform);
+	size_t kept = 0;
+	for (size_t line = 0; line < size; )
+	{
+		size_t end = line;
+		while ((end < size) && (data[end] != '\n')) { ++end; }
+		size_t next = (end < size)?(end + 1):(end);
+		size_t first = line;
+		while ((first < end) && ((data[first] == ' ') || (data[first] == '\t') || (data[first] == '\r'))) { ++first; }
+		bool keep = (first < end) && (data[first] != '#');
+		if (keep)
+		{
+			char saved = data[end]; data[end] = '\0'; // data has room for a terminator past size
+			const char* value = SDL_strstr(data + first, field);
+			data[end] = saved;
+			if (value)
+			{
+				value += sizeof(field) - 1;
+				size_t value_length = 0;
+				while ((value + value_length < data + end) && (value[value_length] != ',') && (value[value_length] != '\r')) { ++value_length; }
+				keep = (value_length == platform_length) && (SDL_strncasecmp(value, platform, platform_length) == 0);
+			}
+		}
+		if (keep) { SDL_memmove(data + kept, data + line, next - line); kept += next - line; }
+		line = next;
+	}
+	return kept;
+}
+
+class TaskGameControllerAddMappings : public Nanx::SimpleTask
+{
+	public: char* m_file;
+	public: void* m_data;
+	public: size_t m_size;
+	public: int m_count;
+	public: TaskGameControllerAddMappings(v8::Local<v8::String> file) :
+		m_file(strdup(*v8::String::Utf8Value(file))),
+		m_data(NULL),
+		m_size(0),
+		m_count(0)
+	{
+	}
+	public: ~TaskGameControllerAddMappings()
+	{
+		free(m_file); m_file = NULL; // strdup
+		SDL_free(m_data); m_data = NULL;
+	}
+	public: void DoWork()
+	{
+		SDL_RWops* src = SDL_RWFromFile(m_file, "rb");
+		Sint64 size = (src)?(SDL_RWsize(src)):(-1);
+		m_data = (size >= 0)?(SDL_malloc(static_cast<size_t>(size) + 1)):(NULL);
+		m_size = (m_data)?(SDL_RWread(src, m_data, 1, static_cast<size_t>(size))):(0);
+		if (src) { SDL_RWclose(src); }
+		if (m_data) { m_size = _GameControllerMappingsFilter(static_cast<char*>(m_data), m_size); }
+		m_count = (m_data)?(0):(-1);
+		if (m_count < 0) { SetError(SDL_GetError()); }
+	}
+	// SDL's mapping list is not locked, so the filtered lines are still parsed and added on the loop thread
+	public: v8::Local<v8::Value> DoAfterWork(int status)
+	{
+		if (m_data)
+		{
+			m_count = SDL_GameControllerAddMappingsFromRW(SDL_RWFromConstMem(m_data, static_cast<int>(m_size)), 1);
+			SDL_free(m_data); m_data = NULL;
+			if (m_count < 0) { SetError(SDL_GetError()); }
+		}
+		return Nan::New(m_count);
+	}
+};
+
+// resolves to the number of mappings added, or -1
+NANX_EXPORT(SDL_GameControllerAddMappingsFromFile)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[1]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	int id = Nanx::SimpleTask::Run(new TaskGameControllerAddMappings(file), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_GameControllerAddMappingsFromFilePromise)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[1]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskGameControllerAddMappings(file), priority));
+}
+
+// extern DECLSPEC char * SDLCALL SDL_GameControllerMapping(SDL_GameController * gamecontroller);
+NANX_EXPORT(SDL_GameControllerMapping)
+{
+	SDL_GameController* gamecontroller = WrapGameController::Peek(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+	char* mapping = SDL_GameControllerMapping(gamecontroller);
+	if (!mapping) { return info.GetReturnValue().SetNull(); }
+	info.GetReturnValue().Set(NANX_STRING(mapping));
+	SDL_free(mapping);
+}
+
+// extern DECLSPEC SDL_bool SDLCALL SDL_IsGameController(int joystick_index);
+NANX_EXPORT(SDL_IsGameController)
+{
+	int joystick_index = NANX_int(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_IsGameController(joystick_index) != SDL_FALSE));
+}
+
+// extern DECLSPEC const char *SDLCALL SDL_GameControllerNameForIndex(int joystick_index);
+NANX_EXPORT(SDL_GameControllerNameForIndex)
+{
+	int joystick_index = NANX_int(info[0]);
+	const char* name = SDL_GameControllerNameForIndex(joystick_index);
+	if (!name) { return info.GetReturnValue().SetNull(); }
+	info.GetReturnValue().Set(NANX_STRING(name));
+}
+
+// extern DECLSPEC SDL_GameController *SDLCALL SDL_GameControllerOpen(int joystick_index);
+NANX_EXPORT(SDL_GameControllerOpen)
+{
+	int joystick_index = NANX_int(info[0]);
+	SDL_GameController* gamecontroller = SDL_GameControllerOpen(joystick_index);
+	info.GetReturnValue().Set(WrapGameController::Hold(gamecontroller));
+}
+
+// extern DECLSPEC const char *SDLCALL SDL_GameControllerName(SDL_GameController *gamecontroller);
+NANX_EXPORT(SDL_GameControllerName)
+{
+	SDL_GameController* gamecontroller = WrapGameController::Peek(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+	const char* name = SDL_GameControllerName(gamecontroller);
+	if (!name) { return info.GetReturnValue().SetNull(); }
+	info.GetReturnValue().Set(NANX_STRING(name));
+}
+
+// extern DECLSPEC SDL_bool SDLCALL SDL_GameControllerGetAttached(SDL_GameController *gamecontroller);
+NANX_EXPORT(SDL_GameControllerGetAttached)
+{
+	SDL_GameController* gamecontroller = WrapGameController::Peek(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+	info.GetReturnValue().Set(Nan::New(SDL_GameControllerGetAttached(gamecontroller) != SDL_FALSE));
+}
+
+// the instance id of the controller's joystick, as in the which of controller events
+NANX_EXPORT(SDL_EXT_GameControllerInstanceID)
+{
+	SDL_GameController* gamecontroller = WrapGameController::Peek(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+	info.GetReturnValue().Set(Nan::New(SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(gamecontroller))));
+}
+
+// extern DECLSPEC void SDLCALL SDL_GameControllerUpdate(void);
+NANX_EXPORT(SDL_GameControllerUpdate)
+{
+	SDL_GameControllerUpdate();
+}
+
+// extern DECLSPEC Sint16 SDLCALL SDL_GameControllerGetAxis(SDL_GameController *gamecontroller, SDL_GameControllerAxis axis);
+NANX_EXPORT(SDL_GameControllerGetAxis)
+{
+	SDL_GameController* gamecontroller = WrapGameController::Peek(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+	SDL_GameControllerAxis axis = static_cast<SDL_GameControllerAxis>(NANX_int(info[1]));
+	info.GetReturnValue().Set(Nan::New(SDL_GameControllerGetAxis(gamecontroller, axis)));
+}
+
+// extern DECLSPEC Uint8 SDLCALL SDL_GameControllerGetButton(SDL_GameController *gamecontroller, SDL_GameControllerButton button);
+NANX_EXPORT(SDL_GameControllerGetButton)
+{
+	SDL_GameController* gamecontroller = WrapGameController::Peek(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+	SDL_GameControllerButton button = static_cast<SDL_GameControllerButton>(NANX_int(info[1]));
+	info.GetReturnValue().Set(Nan::New(SDL_GameControllerGetButton(gamecontroller, button)));
+}
+
+// extern DECLSPEC void SDLCALL SDL_GameControllerClose(SDL_GameController *gamecontroller);
+NANX_EXPORT(SDL_GameControllerClose)
+{
+	SDL_GameController* gamecontroller = WrapGameController::Drop(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+	_InputSamplerForget(gamecontroller);
+	SDL_GameControllerClose(gamecontroller);
+}
+
+// whole controller state in one crossing, like SDL_EXT_JoystickSnapshot, SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE values each
+// axes and buttons are indexed by SDL_GameControllerAxis and SDL_GameControllerButton
+
+static const int SDL_EXT_GAMECONTROLLER_SNAPSHOT_ATTACHED = 0;
+static const int SDL_EXT_GAMECONTROLLER_SNAPSHOT_INSTANCE_ID = 1; // truncated to 16 bits
+static const int SDL_EXT_GAMECONTROLLER_SNAPSHOT_AXES = 2; // 8 axes
+static const int SDL_EXT_GAMECONTROLLER_SNAPSHOT_BUTTONS = 10; // 32 buttons, 0 or 1
+static const int SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE = 42;
+
+static void _GameControllerSnapshot(SDL_GameController* gamecontroller, ::Sint16* record)
+{
+	SDL_memset(record, 0, SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE * sizeof(::Sint16));
+	if (!gamecontroller || !SDL_GameControllerGetAttached(gamecontroller)) { return; }
+	record[SDL_EXT_GAMECONTROLLER_SNAPSHOT_ATTACHED] = 1;
+	record[SDL_EXT_GAMECONTROLLER_SNAPSHOT_INSTANCE_ID] = static_cast< ::Sint16 >(SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(gamecontroller)));
+	for (int i = 0; i < SDL_min(static_cast<int>(SDL_CONTROLLER_AXIS_MAX), 8); ++i)
+	{
+		record[SDL_EXT_GAMECONTROLLER_SNAPSHOT_AXES + i] = SDL_GameControllerGetAxis(gamecontroller, static_cast<SDL_GameControllerAxis>(i));
+	}
+	for (int i = 0; i < SDL_min(static_cast<int>(SDL_CONTROLLER_BUTTON_MAX), 32); ++i)
+	{
+		record[SDL_EXT_GAMECONTROLLER_SNAPSHOT_BUTTONS + i] = SDL_GameControllerGetButton(gamecontroller, static_cast<SDL_GameControllerButton>(i));
+	}
+}
+
+// gamecontrollers is a controller, an array of them, or null for every open controller in the order they were opened
+// calls SDL_GameControllerUpdate once, returns the number of records written
+NANX_EXPORT(SDL_EXT_GameControllerSnapshot)
+{
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsInt16Array()) { return Nan::ThrowError("snapshot is an Int16Array"); }
+	#endif
+	size_t byte_length = 0;
+	::Sint16* out = static_cast< ::Sint16* >(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(::Sint16);
+	#endif
+	int capacity = static_cast<int>(byte_length / (SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE * sizeof(::Sint16)));
+	SDL_GameControllerUpdate();
+	int count = 0;
+	if (info[0]->IsArray())
+	{
+		v8::Local<v8::Array> gamecontrollers = v8::Local<v8::Array>::Cast(info[0]);
+		for (int index = 0; (index < static_cast<int>(gamecontrollers->Length())) && (count < capacity); ++index)
+		{
+			_GameControllerSnapshot(WrapGameController::Peek(gamecontrollers->Get(index)), out + SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE * count++);
+		}
+	}
+	else if (info[0]->IsObject())
+	{
+		SDL_GameController* gamecontroller = WrapGameController::Peek(info[0]); if (!gamecontroller) { return Nan::ThrowError("null SDL_GameController object"); }
+		if (capacity > 0) { _GameControllerSnapshot(gamecontroller, out); count = 1; }
+	}
+	else
+	{
+		for (WrapGameController* wrap = WrapGameController::First(); wrap && (count < capacity); wrap = wrap->Next())
+		{
+			_GameControllerSnapshot(wrap->Peek(), out + SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE * count++);
+		}
+	}
+	info.GetReturnValue().Set(Nan::New(count));
+}
+
+// SDL_gesture.h
+// SDL_haptic.h
+
+// SDL_hints.h
+
+NANX_EXPORT(SDL_SetHintWithPriority)
+{
+	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
+	v8::Local<v8::String> value = v8::Local<v8::String>::Cast(info[1]);
+	SDL_HintPriority priority = NANX_SDL_HintPriority(info[2]);
+	SDL_bool ret = SDL_SetHintWithPriority(*v8::String::Utf8Value(name), *v8::String::Utf8Value(value), priority);
+	info.GetReturnValue().Set(Nan::New(ret != SDL_FALSE));
+}
+
+NANX_EXPORT(SDL_SetHint)
+{
+	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
+	v8::Local<v8::String> value = v8::Local<v8::String>::Cast(info[1]);
+	SDL_bool ret = SDL_SetHint(*v8::String::Utf8Value(name), *v8::String::Utf8Value(value));
+	info.GetReturnValue().Set(Nan::New(ret != SDL_FALSE));
+}
+
+NANX_EXPORT(SDL_GetHint)
+{
+	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
+	const char* value = SDL_GetHint(*v8::String::Utf8Value(name));
+	info.GetReturnValue().Set(NANX_STRING(value));
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+NANX_EXPORT(SDL_GetHintBoolean)
+{
+	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
+	SDL_bool default_value = (info[1]->IsBoolean())?(NANX_SDL_bool(info[1])):(SDL_FALSE);
+	SDL_bool value = SDL_GetHintBoolean(*v8::String::Utf8Value(name), default_value);
+	info.GetReturnValue().Set(Nan::New(value));
+}
+#endif
+
+// TODO: typedef void (*SDL_HintCallback)(void *userdata, const char *name, const char *oldValue, const char *newValue);
+// TODO: extern DECLSPEC void SDLCALL SDL_AddHintCallback(const char *name, SDL_HintCallback callback, void *userdata);
+// TODO: extern DECLSPEC void SDLCALL SDL_DelHintCallback(const char *name, SDL_HintCallback callback, void *userdata);
+
+NANX_EXPORT(SDL_ClearHints)
+{
+	SDL_ClearHints();
+}
+
+// SDL_joystick.h
+
+NANX_EXPORT(SDL_NumJoysticks)
+{
+	info.GetReturnValue().Set(Nan::New(SDL_NumJoysticks()));
+}
+
+NANX_EXPORT(SDL_JoystickNameForIndex)
+{
+	int device_index = NANX_int(info[0]);
+	const char* name = SDL_JoystickNameForIndex(device_index);
+	info.GetReturnValue().Set(NANX_STRING(name));
+}
+
+NANX_EXPORT(SDL_JoystickOpen)
+{
+	int device_index = NANX_int(info[0]);
+	SDL_Joystick* joystick = SDL_JoystickOpen(device_index);
+	info.GetReturnValue().Set(WrapJoystick::Hold(joystick));
+}
+
+NANX_EXPORT(SDL_JoystickName)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	const char* name = SDL_JoystickName(joystick);
+	info.GetReturnValue().Set(NANX_STRING(name));
+}
+
+// TODO: extern DECLSPEC SDL_JoystickGUID SDLCALL SDL_JoystickGetDeviceGUID(int device_index);
+// TODO: extern DECLSPEC SDL_JoystickGUID SDLCALL SDL_JoystickGetGUID(SDL_Joystick * joystick);
+// TODO: extern DECLSPEC void SDL_JoystickGetGUIDString(SDL_JoystickGUID guid, char *pszGUID, int cbGUID);
+// TODO: extern DECLSPEC SDL_JoystickGUID SDLCALL SDL_JoystickGetGUIDFromString(const char *pchGUID);
+
+NANX_EXPORT(SDL_JoystickGetAttached)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	SDL_bool attached = SDL_JoystickGetAttached(joystick);
+	info.GetReturnValue().Set(Nan::New(attached != SDL_FALSE));
+}
+
+NANX_EXPORT(SDL_JoystickInstanceID)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	SDL_JoystickID id = SDL_JoystickInstanceID(joystick);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_JoystickNumAxes)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int num = SDL_JoystickNumAxes(joystick);
+	info.GetReturnValue().Set(Nan::New(num));
+}
+
+NANX_EXPORT(SDL_JoystickNumBalls)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int num = SDL_JoystickNumBalls(joystick);
+	info.GetReturnValue().Set(Nan::New(num));
+}
+
+NANX_EXPORT(SDL_JoystickNumHats)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int num = SDL_JoystickNumHats(joystick);
+	info.GetReturnValue().Set(Nan::New(num));
+}
+
+NANX_EXPORT(SDL_JoystickNumButtons)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int num = SDL_JoystickNumButtons(joystick);
+	info.GetReturnValue().Set(Nan::New(num));
+}
+
+NANX_EXPORT(SDL_JoystickUpdate)
+{
+	SDL_JoystickUpdate();
+}
+
+NANX_EXPORT(SDL_JoystickEventState)
+{
+	int state = NANX_int(info[0]);
+	int err = SDL_JoystickEventState(state);
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+NANX_EXPORT(SDL_JoystickGetAxis)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int index = NANX_int(info[1]);
+	Sint16 value = SDL_JoystickGetAxis(joystick, index);
+	info.GetReturnValue().Set(Nan::New(value));
+}
+
+NANX_EXPORT(SDL_JoystickGetBall)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int index = NANX_int(info[1]);
+	int dx = 0; // TODO
+	int dy = 0; // TODO
+	int value = SDL_JoystickGetBall(joystick, index, &dx, &dy);
+	info.GetReturnValue().Set(Nan::New(value));
+}
+
+NANX_EXPORT(SDL_JoystickGetHat)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int index = NANX_int(info[1]);
+	Uint8 value = SDL_JoystickGetHat(joystick, index);
+	info.GetReturnValue().Set(Nan::New(value));
+}
+
+NANX_EXPORT(SDL_JoystickGetButton)
+{
+	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	int index = NANX_int(info[1]);
+	Uint8 value = SDL_JoystickGetButton(joystick, index);
+	info.GetReturnValue().Set(Nan::New(value));
+}
+
+NANX_EXPORT(SDL_JoystickClose)
+{
+	SDL_Joystick* joystick = WrapJoystick::Drop(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+	_InputSamplerForget(joystick);
+	SDL_JoystickClose(joystick);
+}
+
+// whole joystick state in one crossing, each joystick fills SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE values of an Int16Array
+// counts are the joystick's own, values past the fixed maximums are left out
+// the instance id is truncated to 16 bits, balls report motion since the last read
+
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_ATTACHED = 0;
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_INSTANCE_ID = 1;
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_NUM_AXES = 2;
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_NUM_BUTTONS = 3;
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_NUM_HATS = 4;
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_NUM_BALLS = 5;
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_AXES = 6; // 16 axes
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_BUTTONS = 22; // 32 buttons, 0 or 1
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_HATS = 54; // 4 hats
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_BALLS = 58; // 4 balls, dx then dy
+static const int SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE = 66;
+
+static void _JoystickSnapshot(SDL_Joystick* joystick, ::Sint16* record)
+{
+	SDL_memset(record, 0, SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE * sizeof(::Sint16));
+	if (!joystick || !SDL_JoystickGetAttached(joystick)) { return; }
+	int num_axes = SDL_JoystickNumAxes(joystick);
+	int num_buttons = SDL_JoystickNumButtons(joystick);
+	int num_hats = SDL_JoystickNumHats(joystick);
+	int num_balls = SDL_JoystickNumBalls(joystick);
+	record[SDL_EXT_JOYSTICK_SNAPSHOT_ATTACHED] = 1;
+	record[SDL_EXT_JOYSTICK_SNAPSHOT_INSTANCE_ID] = static_cast< ::Sint16 >(SDL_JoystickInstanceID(joystick));
+	record[SDL_EXT_JOYSTICK_SNAPSHOT_NUM_AXES] = static_cast< ::Sint16 >(num_axes);
+	record[SDL_EXT_JOYSTICK_SNAPSHOT_NUM_BUTTONS] = static_cast< ::Sint16 >(num_buttons);
+	record[SDL_EXT_JOYSTICK_SNAPSHOT_NUM_HATS] = static_cast< ::Sint16 >(num_hats);
+	record[SDL_EXT_JOYSTICK_SNAPSHOT_NUM_BALLS] = static_cast< ::Sint16 >(num_balls);
+	for (int i = 0; i < SDL_min(num_axes, 16); ++i) { record[SDL_EXT_JOYSTICK_SNAPSHOT_AXES + i] = SDL_JoystickGetAxis(joystick, i); }
+	for (int i = 0; i < SDL_min(num_buttons, 32); ++i) { record[SDL_EXT_JOYSTICK_SNAPSHOT_BUTTONS + i] = SDL_JoystickGetButton(joystick, i); }
+	for (int i = 0; i < SDL_min(num_hats, 4); ++i) { record[SDL_EXT_JOYSTICK_SNAPSHOT_HATS + i] = SDL_JoystickGetHat(joystick, i); }
+	for (int i = 0; i < SDL_min(num_balls, 4); ++i)
+	{
+		int dx = 0, dy = 0;
+		SDL_JoystickGetBall(joystick, i, &dx, &dy);
+		record[SDL_EXT_JOYSTICK_SNAPSHOT_BALLS + 2 * i] = static_cast< ::Sint16 >(SDL_max(-32768, SDL_min(dx, 32767)));
+		record[SDL_EXT_JOYSTICK_SNAPSHOT_BALLS + 2 * i + 1] = static_cast< ::Sint16 >(SDL_max(-32768, SDL_min(dy, 32767)));
+	}
+}
+
+// joysticks is a joystick, an array of them, or null for every open joystick in the order they were opened
+// calls SDL_JoystickUpdate once, returns the number of records written
+NANX_EXPORT(SDL_EXT_JoystickSnapshot)
+{
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsInt16Array()) { return Nan::ThrowError("snapshot is an Int16Array"); }
+	#endif
+	size_t byte_length = 0;
+	::Sint16* out = static_cast< ::Sint16* >(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(::Sint16);
+	#endif
+	int capacity = static_cast<int>(byte_length / (SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE * sizeof(::Sint16)));
+	SDL_JoystickUpdate();
+	int count = 0;
+	if (info[0]->IsArray())
+	{
+		v8::Local<v8::Array> joysticks = v8::Local<v8::Array>::Cast(info[0]);
+		for (int index = 0; (index < static_cast<int>(joysticks->Length())) && (count < capacity); ++index)
+		{
+			_JoystickSnapshot(WrapJoystick::Peek(joysticks->Get(index)), out + SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE * count++);
+		}
+	}
+	else if (info[0]->IsObject())
+	{
+		SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
+		if (capacity > 0) { _JoystickSnapshot(joystick, out); count = 1; }
+	}
+	else
+	{
+		for (WrapJoystick* wrap = WrapJoystick::First(); wrap && (count < capacity); wrap = wrap->Next())
+		{
+			_JoystickSnapshot(wrap->Peek(), out + SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE * count++);
+		}
+	}
+	info.GetReturnValue().Set(Nan::New(count));
+}
+
+// a native thread that samples joysticks and game controllers at a fixed rate, away from script and gc pauses
+// each sample is its time in ms on the SDL_GetPerformanceCounter clock, then the joystick records, then the controller records
+// the latest sample is handed over through a triple buffer and every sample through an AudioRing for the history
+// the sampler updates joysticks from its own thread under SDL_LockJoysticks, which needs SDL 2.0.7
+// backends that only deliver input on the main thread's run loop refresh no faster than it pumps
+
+#if SDL_VERSION_ATLEAST(2, 0, 7)
+
+class InputSampler
+{
+	public: enum { MAX_DEVICES = 16, FRESH = 4 };
+	private: bool m_running;
+	private: uv_thread_t m_thread;
+	private: uv_mutex_t m_mutex;
+	private: uv_cond_t m_cond;
+	private: bool m_stop; // guarded by m_mutex
+	public: int m_rate;
+	private: ::Uint64 m_period; // performance counter ticks
+	public: int m_joystick_count;
+	public: int m_gamecontroller_count;
+	private: SDL_Joystick* m_joysticks[MAX_DEVICES]; // nulled under SDL_LockJoysticks when closed
+	private: SDL_GameController* m_gamecontrollers[MAX_DEVICES];
+	private: Nan::Persistent<v8::Value> m_hold_joysticks[MAX_DEVICES];
+	private: Nan::Persistent<v8::Value> m_hold_gamecontrollers[MAX_DEVICES];
+	public: int m_values; // Sint16 values per sample
+	private: ::Uint32 m_sample_size; // bytes, the time then the values, a multiple of 8
+	private: ::Uint8* m_slots; // triple buffer
+	private: ::Uint8* m_scratch; // one sample, script side
+	private: int m_back; // sampler only
+	private: int m_front; // script only
+	private: SDL_atomic_t m_middle; // slot index, or'd with FRESH when published since the last swap
+	public: AudioRing m_history;
+	public: SDL_atomic_t m_samples;
+	public: SDL_atomic_t m_dropped; // samples the history had no room for
+	public: SDL_atomic_t m_late; // periods skipped because the sampler fell behind
+	private: InputSampler() :
+		m_running(false), m_stop(false), m_rate(0), m_period(0), m_joystick_count(0), m_gamecontroller_count(0),
+		m_values(0), m_sample_size(0), m_slots(NULL), m_scratch(NULL), m_back(0), m_front(0)
+	{
+		uv_mutex_init(&m_mutex);
+		uv_cond_init(&m_cond);
+		SDL_AtomicSet(&m_middle, 0);
+		SDL_AtomicSet(&m_samples, 0);
+		SDL_AtomicSet(&m_dropped, 0);
+		SDL_AtomicSet(&m_late, 0);
+	}
+	public: static InputSampler& Instance() { static InputSampler sampler; return sampler; }
+	public: bool IsRunning() const { return m_running; }
+	// restarts a running sampler, returns NULL or an error
+	public: const char* Start(v8::Local<v8::Value> joysticks, v8::Local<v8::Value> gamecontrollers, int rate, int history)
+	{
+		Stop();
+		int joystick_count = (joysticks->IsArray())?(static_cast<int>(v8::Local<v8::Array>::Cast(joysticks)->Length())):(0);
+		int gamecontroller_count = (gamecontrollers->IsArray())?(static_cast<int>(v8::Local<v8::Array>::Cast(gamecontrollers)->Length())):(0);
+		if ((joystick_count > MAX_DEVICES) || (gamecontroller_count > MAX_DEVICES)) { return "too many devices for the input sampler"; }
+		for (int index = 0; index < joystick_count; ++index)
+		{
+			v8::Local<v8::Value> joystick = v8::Local<v8::Array>::Cast(joysticks)->Get(index);
+			m_joysticks[index] = WrapJoystick::Peek(joystick); if (!m_joysticks[index]) { Clear(); return "null SDL_Joystick object"; }
+			m_hold_joysticks[index].Reset(joystick);
+			m_joystick_count = index + 1;
+		}
+		for (int index = 0; index < gamecontroller_count; ++index)
+		{
+			v8::Local<v8::Value> gamecontroller = v8::Local<v8::Array>::Cast(gamecontrollers)->Get(index);
+			m_gamecontrollers[index] = WrapGameController::Peek(gamecontroller); if (!m_gamecontrollers[index]) { Clear(); return "null SDL_GameController object"; }
+			m_hold_gamecontrollers[index].Reset(gamecontroller);
+			m_gamecontroller_count = index + 1;
+		}
+		m_rate = SDL_max(1, SDL_min(rate, 8000));
+		m_period = SDL_max(SDL_GetPerformanceFrequency() / m_rate, 1);
+		m_values = m_joystick_count * SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE + m_gamecontroller_count * SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE;
+		m_sample_size = (sizeof(double) + m_values * sizeof(::Sint16) + 7) & ~7;
+		m_slots = static_cast< ::Uint8* >(SDL_calloc(3, m_sample_size));
+		m_scratch = static_cast< ::Uint8* >(SDL_malloc(m_sample_size));
+		history = SDL_max(1, SDL_min(history, 1 << 16));
+		if (!m_slots || !m_scratch || !m_history.Alloc(history * m_sample_size)) { Clear(); return "out of memory"; }
+		for (int slot = 0; slot < 3; ++slot) { double never = -1; SDL_memcpy(m_slots + slot * m_sample_size, &never, sizeof(double)); }
+		m_back = 0; m_front = 2; SDL_AtomicSet(&m_middle, 1);
+		SDL_AtomicSet(&m_samples, 0);
+		SDL_AtomicSet(&m_dropped, 0);
+		SDL_AtomicSet(&m_late, 0);
+		m_stop = false;
+		if (uv_thread_create(&m_thread, _Thread, this) != 0) { Clear(); return "input sampler thread failed to start"; }
+		m_running = true;
+		return NULL;
+	}
+	public: void Stop()
+	{
+		if (m_running)
+		{
+			uv_mutex_lock(&m_mutex);
+			m_stop = true;
+			uv_cond_signal(&m_cond);
+			uv_mutex_unlock(&m_mutex);
+			uv_thread_join(&m_thread);
+			m_running = false;
+		}
+		Clear();
+	}
+	// drops a device that is about to be closed, once this returns the sampler no longer touches it
+	public: void Forget(const void* device)
+	{
+		if (!m_running || !device) { return; }
+		SDL_LockJoysticks();
+		for (int index = 0; index < m_joystick_count; ++index)
+		{
+			if (m_joysticks[index] == device) { m_joysticks[index] = NULL; m_hold_joysticks[index].Reset(); }
+		}
+		for (int index = 0; index < m_gamecontroller_count; ++index)
+		{
+			if (m_gamecontrollers[index] == device) { m_gamecontrollers[index] = NULL; m_hold_gamecontrollers[index].Reset(); }
+		}
+		SDL_UnlockJoysticks();
+	}
+	// script only, copies the newest sample and returns its time, -1 before the first sample
+	public: double Latest(::Sint16* values)
+	{
+		if (SDL_AtomicGet(&m_middle) & FRESH) { m_front = SDL_AtomicSet(&m_middle, m_front) & ~FRESH; }
+		const ::Uint8* slot = m_slots + m_front * m_sample_size;
+		double time = -1; SDL_memcpy(&time, slot, sizeof(double));
+		SDL_memcpy(values, slot + sizeof(double), m_values * sizeof(::Sint16));
+		return time;
+	}
+	public: int Pending() { return (m_sample_size)?(static_cast<int>(m_history.Fill() / m_sample_size)):(0); }
+	// script only, takes up to max samples from the history, oldest first
+	public: int Read(::Sint16* values, double* times, int max)
+	{
+		int count = SDL_min(max, Pending());
+		for (int index = 0; index < count; ++index)
+		{
+			m_history.Read(m_scratch, m_sample_size);
+			SDL_memcpy(&times[index], m_scratch, sizeof(double));
+			SDL_memcpy(values + index * m_values, m_scratch + sizeof(double), m_values * sizeof(::Sint16));
+		}
+		return count;
+	}
+	private: void Clear()
+	{
+		for (int index = 0; index < MAX_DEVICES; ++index)
+		{
+			m_joysticks[index] = NULL; m_hold_joysticks[index].Reset();
+			m_gamecontrollers[index] = NULL; m_hold_gamecontrollers[index].Reset();
+		}
+		m_joystick_count = 0; m_gamecontroller_count = 0; m_values = 0; m_sample_size = 0;
+		SDL_free(m_slots); m_slots = NULL;
+		SDL_free(m_scratch); m_scratch = NULL;
+		SDL_free(m_history.m_data); m_history.m_data = NULL; m_history.m_mask = 0;
+		SDL_AtomicSet(&m_history.m_head, 0); SDL_AtomicSet(&m_history.m_tail, 0);
+	}
+	// sampler thread only
+	private: void Sample(double time)
+	{
+		::Uint8* slot = m_slots + m_back * m_sample_size;
+		SDL_memcpy(slot, &time, sizeof(double));
+		::Sint16* record = reinterpret_cast< ::Sint16* >(slot + sizeof(double));
+		SDL_LockJoysticks();
+		SDL_JoystickUpdate();
+		for (int index = 0; index < m_joystick_count; ++index, record += SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE) { _JoystickSnapshot(m_joysticks[index], record); }
+		for (int index = 0; index < m_gamecontroller_count; ++index, record += SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE) { _GameControllerSnapshot(m_gamecontrollers[index], record); }
+		SDL_UnlockJoysticks();
+		if (m_history.Capacity() - m_history.Fill() >= m_sample_size) { m_history.Write(slot, m_sample_size); } else { SDL_AtomicAdd(&m_dropped, 1); }
+		m_back = SDL_AtomicSet(&m_middle, m_back | FRESH) & ~FRESH;
+		SDL_AtomicAdd(&m_samples, 1);
+	}
+	private: static void _Thread(void* arg)
+	{
+		InputSampler* sampler = static_cast<InputSampler*>(arg);
+		double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+		::Uint64 period = sampler->m_period;
+		::Uint64 deadline = SDL_GetPerformanceCounter();
+		uv_mutex_lock(&sampler->m_mutex);
+		while (!sampler->m_stop)
+		{
+			uv_mutex_unlock(&sampler->m_mutex);
+			sampler->Sample(1000.0 * SDL_GetPerformanceCounter() / frequency);
+			deadline += period;
+			::Uint64 now = SDL_GetPerformanceCounter();
+			if (now >= deadline + period) { SDL_AtomicAdd(&sampler->m_late, static_cast<int>((now - deadline) / period)); deadline = now; }
+			uv_mutex_lock(&sampler->m_mutex);
+			// waits are only as fine as the os timer allows
+			while (!sampler->m_stop && ((now = SDL_GetPerformanceCounter()) < deadline))
+			{
+				uv_cond_timedwait(&sampler->m_cond, &sampler->m_mutex, static_cast<uint64_t>((deadline - now) * 1e9 / frequency));
+			}
+		}
+		uv_mutex_unlock(&sampler->m_mutex);
+	}
+};
+
+#endif
+
+static void _InputSamplerStop()
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	InputSampler::Instance().Stop();
+	#endif
+}
+
+static void _InputSamplerForget(const void* device)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	InputSampler::Instance().Forget(device);
+	#endif
+}
+
+// joysticks and gamecontrollers are arrays of open devices, at most 16 of each, closing one leaves zeroed records
+// rate is in samples per second, history is how many samples are kept for SDL_EXT_InputSamplerRead
+// restarts a running sampler, returns the number of Int16 values in a sample
+NANX_EXPORT(SDL_EXT_InputSamplerStart)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	int rate = (info[2]->IsNumber())?(NANX_int(info[2])):(1000);
+	int history = (info[3]->IsNumber())?(NANX_int(info[3])):(rate);
+	InputSampler& sampler = InputSampler::Instance();
+	const char* err = sampler.Start(info[0], info[1], rate, history);
+	if (err) { return Nan::ThrowError(err); }
+	info.GetReturnValue().Set(Nan::New(sampler.m_values));
+	#else
+	return Nan::ThrowError("SDL_EXT_InputSamplerStart needs SDL 2.0.7 or later");
+	#endif
+}
+
+NANX_EXPORT(SDL_EXT_InputSamplerStop)
+{
+	_InputSamplerStop();
+}
+
+// copies the newest sample into an Int16Array, returns its time or -1 before the first sample, never waits
+NANX_EXPORT(SDL_EXT_InputSamplerLatest)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	InputSampler& sampler = InputSampler::Instance();
+	if (!sampler.IsRunning()) { return Nan::ThrowError("input sampler not running"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[0]->IsInt16Array()) { return Nan::ThrowError("sample is an Int16Array"); }
+	#endif
+	size_t byte_length = 0;
+	::Sint16* values = static_cast< ::Sint16* >(_TypedArrayData(info[0], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(::Sint16);
+	#endif
+	if (byte_length < sampler.m_values * sizeof(::Sint16)) { return Nan::ThrowError("sample is too small"); }
+	info.GetReturnValue().Set(Nan::New(sampler.Latest(values)));
+	#else
+	return Nan::ThrowError("SDL_EXT_InputSamplerLatest needs SDL 2.0.7 or later");
+	#endif
+}
+
+// takes the samples taken since the last read, oldest first, as many as fit both the Int16Array and the Float64Array of times
+// returns the number of samples, never waits
+NANX_EXPORT(SDL_EXT_InputSamplerRead)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	InputSampler& sampler = InputSampler::Instance();
+	if (!sampler.IsRunning()) { return Nan::ThrowError("input sampler not running"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[0]->IsInt16Array()) { return Nan::ThrowError("samples is an Int16Array"); }
+	if (!info[1]->IsFloat64Array()) { return Nan::ThrowError("times is a Float64Array"); }
+	#endif
+	size_t values_length = 0;
+	::Sint16* values = static_cast< ::Sint16* >(_TypedArrayData(info[0], &values_length));
+	size_t times_length = 0;
+	double* times = static_cast<double*>(_TypedArrayData(info[1], &times_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	values_length *= sizeof(::Sint16);
+	times_length *= sizeof(double);
+	#endif
+	int max = static_cast<int>(times_length / sizeof(double));
+	if (sampler.m_values > 0) { max = SDL_min(max, static_cast<int>(values_length / (sampler.m_values * sizeof(::Sint16)))); }
+	info.GetReturnValue().Set(Nan::New(sampler.Read(values, times, max)));
+	#else
+	return Nan::ThrowError("SDL_EXT_InputSamplerRead needs SDL 2.0.7 or later");
+	#endif
+}
+
+NANX_EXPORT(SDL_EXT_InputSamplerStats)
+{
+	v8::Local<v8::Object> stats = Nan::New<v8::Object>();
+	#if SDL_VERSION_ATLEAST(2, 0, 7)
+	InputSampler& sampler = InputSampler::Instance();
+	stats->Set(NANX_SYMBOL("running"), Nan::New(sampler.IsRunning()));
+	stats->Set(NANX_SYMBOL("rate"), Nan::New(sampler.m_rate));
+	stats->Set(NANX_SYMBOL("values"), Nan::New(sampler.m_values));
+	stats->Set(NANX_SYMBOL("pending"), Nan::New(sampler.Pending()));
+	stats->Set(NANX_SYMBOL("samples"), Nan::New(SDL_AtomicGet(&sampler.m_samples)));
+	stats->Set(NANX_SYMBOL("dropped"), Nan::New(SDL_AtomicGet(&sampler.m_dropped)));
+	stats->Set(NANX_SYMBOL("late"), Nan::New(SDL_AtomicGet(&sampler.m_late)));
+	#else
+	stats->Set(NANX_SYMBOL("running"), Nan::New(false));
+	#endif
+	info.GetReturnValue().Set(stats);
+}
+
+// SDL_keyboard.h
+// SDL_keycode.h
+// SDL_loadso.h
+// SDL_log.h
+// SDL_main.h
+// SDL_messagebox.h
+// SDL_mouse.h
+// SDL_mutex.h
+// SDL_name.h
+// SDL_opengl.h
+// SDL_opengles.h
+// SDL_opengles2.h
+// SDL_pixels.h
+
+NANX_EXPORT(SDL_PIXELFLAG)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_PIXELFLAG(format)));
+}
+
+NANX_EXPORT(SDL_PIXELTYPE)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_PIXELTYPE(format)));
+}
+
+NANX_EXPORT(SDL_PIXELORDER)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_PIXELORDER(format)));
+}
+
+NANX_EXPORT(SDL_PIXELLAYOUT)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_PIXELLAYOUT(format)));
+}
+
+NANX_EXPORT(SDL_BITSPERPIXEL)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_BITSPERPIXEL(format)));
+}
+
+NANX_EXPORT(SDL_BYTESPERPIXEL)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_BYTESPERPIXEL(format)));
+}
+
+NANX_EXPORT(SDL_ISPIXELFORMAT_INDEXED)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_ISPIXELFORMAT_INDEXED(format) != SDL_FALSE));
+}
+
+NANX_EXPORT(SDL_ISPIXELFORMAT_ALPHA)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_ISPIXELFORMAT_ALPHA(format) != SDL_FALSE));
+}
+
+NANX_EXPORT(SDL_ISPIXELFORMAT_FOURCC)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	info.GetReturnValue().Set(Nan::New(SDL_ISPIXELFORMAT_FOURCC(format) != SDL_FALSE));
+}
+
+NANX_EXPORT(SDL_GetPixelFormatName)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	const char* name = SDL_GetPixelFormatName(format);
+	info.GetReturnValue().Set(NANX_STRING(name));
+}
+
+NANX_EXPORT(SDL_PixelFormatEnumToMasks)
+{
+	::Uint32 format = NANX_Uint32(info[0]);
+	int bpp = 0;
+	::Uint32 Rmask = 0;
+	::Uint32 Gmask = 0;
+	::Uint32 Bmask = 0;
+	::Uint32 Amask = 0;
+	SDL_bool success = SDL_PixelFormatEnumToMasks(format, &bpp, &Rmask, &Gmask, &Bmask, &Amask);
+	if (info[1]->IsObject())
+	{
+		v8::Local<v8::Object> masks = v8::Local<v8::Object>::Cast(info[1]);
+		masks->Set(NANX_SYMBOL("bpp"), Nan::New(bpp));
+		masks->Set(NANX_SYMBOL("Rmask"), Nan::New(Rmask));
+		masks->Set(NANX_SYMBOL("Gmask"), Nan::New(Gmask));
+		masks->Set(NANX_SYMBOL("Bmask"), Nan::New(Bmask));
+		masks->Set(NANX_SYMBOL("Amask"), Nan::New(Amask));
+	}
+	info.GetReturnValue().Set(Nan::New(success != SDL_FALSE));
+}
+
+NANX_EXPORT(SDL_MasksToPixelFormatEnum)
+{
+	int bpp = NANX_int(info[0]);
+	::Uint32 Rmask = NANX_Uint32(info[1]);
+	::Uint32 Gmask = NANX_Uint32(info[2]);
+	::Uint32 Bmask = NANX_Uint32(info[3]);
+	::Uint32 Amask = NANX_Uint32(info[4]);
+	::Uint32 format = SDL_MasksToPixelFormatEnum(bpp, Rmask, Gmask, Bmask, Amask);
+	info.GetReturnValue().Set(Nan::New(format));
+}
+
+// extern DECLSPEC SDL_PixelFormat * SDLCALL SDL_AllocFormat(Uint32 pixel_format);
+NANX_EXPORT(SDL_AllocFormat)
+{
+	::Uint32 pixel_format = NANX_Uint32(info[0]);
+	SDL_PixelFormat* format = SDL_AllocFormat(pixel_format);
+	info.GetReturnValue().Set(WrapPixelFormat::Hold(format));
+}
+
+// extern DECLSPEC void SDLCALL SDL_FreeFormat(SDL_PixelFormat *format);
+NANX_EXPORT(SDL_FreeFormat)
+{
+	SDL_PixelFormat* format = WrapPixelFormat::Drop(info[0]); if (!format) { return Nan::ThrowError("null SDL_PixelFormat object"); }
+	SDL_FreeFormat(format); format = NULL;
+}
+
+// TODO: extern DECLSPEC SDL_Palette *SDLCALL SDL_AllocPalette(int ncolors);
+// TODO: extern DECLSPEC int SDLCALL SDL_SetPixelFormatPalette(SDL_PixelFormat * format, SDL_Palette *palette);
+// TODO: extern DECLSPEC int SDLCALL SDL_SetPaletteColors(SDL_Palette * palette, const SDL_Color * colors, int firstcolor, int ncolors);
+// TODO: extern DECLSPEC void SDLCALL SDL_FreePalette(SDL_Palette * palette);
+
+// extern DECLSPEC Uint32 SDLCALL SDL_MapRGB(const SDL_PixelFormat * format, Uint8 r, Uint8 g, Uint8 b);
+NANX_EXPORT(SDL_MapRGB)
+{
+	SDL_PixelFormat* format = WrapPixelFormat::Peek(info[0]); if (!format) { return Nan::ThrowError("null SDL_PixelFormat object"); }
+	::Uint8 r = NANX_Uint8(info[1]);
+	::Uint8 g = NANX_Uint8(info[2]);
+	::Uint8 b = NANX_Uint8(info[3]);
+	::Uint32 pixel = SDL_MapRGB(format, r, g, b);
+	info.GetReturnValue().Set(Nan::New(pixel));
+}
+
+// extern DECLSPEC Uint32 SDLCALL SDL_MapRGBA(const SDL_PixelFormat * format, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+NANX_EXPORT(SDL_MapRGBA)
+{
+	SDL_PixelFormat* format = WrapPixelFormat::Peek(info[0]); if (!format) { return Nan::ThrowError("null SDL_PixelFormat object"); }
+	::Uint8 r = NANX_Uint8(info[1]);
+	::Uint8 g = NANX_Uint8(info[2]);
+	::Uint8 b = NANX_Uint8(info[3]);
+	::Uint8 a = NANX_Uint8(info[4]);
+	::Uint32 pixel = SDL_MapRGBA(format, r, g, b, a);
+	info.GetReturnValue().Set(Nan::New(pixel));
+}
+
+// TODO: extern DECLSPEC void SDLCALL SDL_GetRGB(Uint32 pixel, const SDL_PixelFormat * format, Uint8 * r, Uint8 * g, Uint8 * b);
+// TODO: extern DECLSPEC void SDLCALL SDL_GetRGBA(Uint32 pixel, const SDL_PixelFormat * format, Uint8 * r, Uint8 * g, Uint8 * b, Uint8 * a);
+// TODO: extern DECLSPEC void SDLCALL SDL_CalculateGammaRamp(float gamma, Uint16 * ramp);
+
+// SDL_platform.h
+
+// extern DECLSPEC const char * SDLCALL SDL_GetPlatform (void);
+NANX_EXPORT(SDL_GetPlatform)
+{
+	info.GetReturnValue().Set(NANX_STRING(SDL_GetPlatform()));
+}
+
+// SDL_power.h
+
+// extern DECLSPEC SDL_PowerState SDLCALL SDL_GetPowerInfo(int *secs, int *pct);
+NANX_EXPORT(SDL_GetPowerInfo)
+{
+	int secs = 0;
+	int pct = 0;
+	SDL_PowerState power_state = SDL_GetPowerInfo(&secs, &pct);
+	if (info[1]->IsObject())
+	{
+		// var info = { secs: -1, pct: -1 };
+		// var power_state = sdl.SDL_GetPowerInfo(info);
+		v8::Local<v8::Object> _info = v8::Local<v8::Object>::Cast(info[1]);
+		_info->Set(NANX_SYMBOL("secs"), Nan::New(secs));
+		_info->Set(NANX_SYMBOL("pct"), Nan::New(pct));
+	}
+	else
+	{
+		// var a_secs = [ -1 ];
+		// var a_pct = [ -1 ];
+		// var power_state = sdl.SDL_GetPowerInfo(a_secs, a_pct);
+		// var secs = a_secs[0];
+		// var pct = a_pcs[0];
+		if (info[1]->IsArray())
+		{
+			v8::Local<v8::Object> a = v8::Local<v8::Object>::Cast(info[1]);
+			a->Set(0, Nan::New(secs));
+		}
+		if (info[2]->IsArray())
+		{
+			v8::Local<v8::Object> a = v8::Local<v8::Object>::Cast(info[2]);
+			a->Set(0, Nan::New(pct));
+		}
+	}
+	info.GetReturnValue().Set(Nan::New(power_state));
+}
+
+// SDL_quit.h
+
+NANX_EXPORT(SDL_QuitRequested)
+{
+	info.GetReturnValue().Set(Nan::New(SDL_QuitRequested() != SDL_FALSE));
+}
+
+// SDL_rect.h
+
+// SDL_FORCE_INLINE SDL_bool SDL_RectEmpty(const SDL_Rect *r)
+NANX_EXPORT(SDL_RectEmpty)
+{
+	WrapRect* r = WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[0]));
+	info.GetReturnValue().Set(Nan::New(SDL_RectEmpty(&r->GetRect()) != SDL_FALSE));
+}
+
+// SDL_FORCE_INLINE SDL_bool SDL_RectEquals(const SDL_Rect *a, const SDL_Rect *b)
+NANX_EXPORT(SDL_RectEquals)
+{
+	WrapRect* a = WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[0]));
+	WrapRect* b = WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]));
+	info.GetReturnValue().Set(Nan::New(SDL_RectEquals(&a->GetRect(), &b->GetRect()) != SDL_FALSE));
+}
+
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasIntersection(const SDL_Rect * A, const SDL_Rect * B);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_IntersectRect(const SDL_Rect * A, const SDL_Rect * B, SDL_Rect * result);
+// TODO: extern DECLSPEC void SDLCALL SDL_UnionRect(const SDL_Rect * A, const SDL_Rect * B, SDL_Rect * result);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_EnclosePoints(const SDL_Point * points, int count, const SDL_Rect * clip, SDL_Rect * result);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_IntersectRectAndLine(const SDL_Rect *rect, int *X1, int *Y1, int *X2, int *Y2);
+
+// fork and join pool for splitting one call across cores, the caller works too
+// unlike Nanx::TaskPool the caller blocks until every job is done, main thread only
+
+class ForkJoinPool
+{
+	public: typedef void (*Job)(void* data, int index);
+	private: enum { MAX_THREADS = 7 };
+	public: enum { MAX_WIDTH = 1 + MAX_THREADS }; // the caller's thread works too
+	private: bool m_started;
+	private: bool m_stop;
+	private: uv_mutex_t m_mutex;
+	private: uv_cond_t m_start;
+	private: uv_cond_t m_done;
+	private: uv_thread_t m_threads[MAX_THREADS];
+	private: int m_thread_count;
+	private: unsigned int m_generation;
+	private: Job m_job;
+	private: void* m_data;
+	private: int m_count;
+	private: int m_next;
+	private: int m_pending;
+	private: ForkJoinPool() : m_started(false), m_stop(false), m_thread_count(0), m_generation(0), m_job(NULL), m_data(NULL), m_count(0), m_next(0), m_pending(0) {}
+	public: static ForkJoinPool& Instance() { static ForkJoinPool pool; return pool; }
+	public: int GetWidth() { Start(); return 1 + m_thread_count; }
+	public: void Run(Job job, void* data, int count)
+	{
+		Start();
+		uv_mutex_lock(&m_mutex);
+		m_job = job; m_data = data; m_count = count; m_next = 0; m_pending = count;
+		++m_generation;
+		uv_cond_broadcast(&m_start);
+		Work();
+		while (m_pending > 0) { uv_cond_wait(&m_done, &m_mutex); }
+		m_job = NULL; m_data = NULL;
+		uv_mutex_unlock(&m_mutex);
+	}
+	// joins the threads at teardown, a later Run starts them again
+	public: void Stop()
+	{
+		if (!m_started) { return; }
+		uv_mutex_lock(&m_mutex);
+		m_stop = true;
+		uv_cond_broadcast(&m_start);
+		uv_mutex_unlock(&m_mutex);
+		for (int index = 0; index < m_thread_count; ++index) { uv_thread_join(&m_threads[index]); }
+		uv_cond_destroy(&m_done);
+		uv_cond_destroy(&m_start);
+		uv_mutex_destroy(&m_mutex);
+		m_thread_count = 0;
+		m_stop = false;
+		m_started = false;
+	}
+	private: void Start()
+	{
+		if (m_started) { return; }
+		m_started = true;
+		uv_mutex_init(&m_mutex);
+		uv_cond_init(&m_start);
+		uv_cond_init(&m_done);
+		int count = SDL_min(SDL_GetCPUCount() - 1, static_cast<int>(MAX_THREADS));
+		for (int index = 0; index < count; ++index)
+		{
+			if (uv_thread_create(&m_threads[m_thread_count], _Thread, this) != 0) { break; }
+			++m_thread_count;
+		}
+	}
+	// takes jobs until none are left, called with the mutex held
+	private: void Work()
+	{
+		while (m_next < m_count)
+		{
+			int index = m_next++;
+			Job job = m_job; void* data = m_data;
+			uv_mutex_unlock(&m_mutex);
+			job(data, index);
+			uv_mutex_lock(&m_mutex);
+			if (--m_pending == 0) { uv_cond_signal(&m_done); }
+		}
+	}
+	private: static void _Thread(void* arg)
+	{
+		ForkJoinPool* pool = static_cast<ForkJoinPool*>(arg);
+		unsigned int generation = 0;
+		uv_mutex_lock(&pool->m_mutex);
+		for (;;)
+		{
+			while (!pool->m_stop && (generation == pool->m_generation)) { uv_cond_wait(&pool->m_start, &pool->m_mutex); }
+			if (pool->m_stop) { break; }
+			generation = pool->m_generation;
+			pool->Work();
+		}
+		uv_mutex_unlock(&pool->m_mutex);
+	}
+};
+
+// SDL_render.h
+
+// driver infos never change while the library is loaded, query them once
+static const SDL_RendererInfo* _RenderDriverInfo(int index)
+{
+	static SDL_RendererInfo g_info[16];
+	static bool g_valid[16];
+	if ((index < 0) || (index >= static_cast<int>(countof(g_info))) || (index >= SDL_GetNumRenderDrivers())) { SDL_SetError("render driver index out of range"); return NULL; }
+	if (!g_valid[index]) { g_valid[index] = (SDL_GetRenderDriverInfo(index, &g_info[index]) == 0); }
+	return (g_valid[index])?(&g_info[index]):(NULL);
+}
+
+static void _RendererInfoToObject(const SDL_RendererInfo* renderer_info, v8::Local<v8::Object> object)
+{
+	object->Set(NANX_SYMBOL("name"), NANX_STRING(renderer_info->name));
+	object->Set(NANX_SYMBOL("flags"), Nan::New(renderer_info->flags));
+	v8::Local<v8::Array> texture_formats = Nan::New<v8::Array>(renderer_info->num_texture_formats);
+	for (::Uint32 i = 0; i < renderer_info->num_texture_formats; ++i)
+	{
+		texture_formats->Set(i, Nan::New(renderer_info->texture_formats[i]));
+	}
+	object->Set(NANX_SYMBOL("num_texture_formats"), Nan::New(renderer_info->num_texture_formats));
+	object->Set(NANX_SYMBOL("texture_formats"), texture_formats);
+	object->Set(NANX_SYMBOL("max_texture_width"), Nan::New(renderer_info->max_texture_width));
+	object->Set(NANX_SYMBOL("max_texture_height"), Nan::New(renderer_info->max_texture_height));
+}
+
+// extern DECLSPEC int SDLCALL SDL_GetNumRenderDrivers(void);
+NANX_EXPORT(SDL_GetNumRenderDrivers)
+{
+	info.GetReturnValue().Set(Nan::New(SDL_GetNumRenderDrivers()));
+}
+
+// extern DECLSPEC int SDLCALL SDL_GetRenderDriverInfo(int index, SDL_RendererInfo * info);
+NANX_EXPORT(SDL_GetRenderDriverInfo)
+{
+	int index = NANX_int(info[0]);
+	v8::Local<v8::Object> _info = v8::Local<v8::Object>::Cast(info[1]);
+	const SDL_RendererInfo* renderer_info = _RenderDriverInfo(index);
+	if (renderer_info) { _RendererInfoToObject(renderer_info, _info); }
+	info.GetReturnValue().Set(Nan::New((renderer_info)?(0):(-1)));
+}
+
+// draws a short fill and copy workload on a hidden window, returns milliseconds per frame or -1
+static double _ProbeRenderDriver(SDL_Window* window, int index, ::Uint32 flags)
+{
+	SDL_Renderer* renderer = SDL_CreateRenderer(window, index, flags & ~SDL_RENDERER_PRESENTVSYNC); // vsync would time the display
+	if (!renderer) { return -1; }
+	static ::Uint32 pixels[64 * 64];
+	for (int i = 0; i < 64 * 64; ++i) { pixels[i] = 0x80000000 | ((i * 2654435761u) >> 8); }
+	SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 64, 64);
+	double ms = -1;
+	if (texture && (SDL_UpdateTexture(texture, NULL, pixels, 64 * sizeof(::Uint32)) == 0))
+	{
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+		static const int frames = 8;
+		::Uint64 start = 0;
+		::Uint32 pixel = 0;
+		for (int frame = -1; frame < frames; ++frame) // one warm up frame
+		{
+			if (frame == 0) { start = SDL_GetPerformanceCounter(); }
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			SDL_RenderClear(renderer);
+			for (int i = 0; i < 256; ++i)
+			{
+				SDL_Rect rect = { (i * 37) % 192, (i * 53) % 192, 64, 64 };
+				SDL_SetRenderDrawColor(renderer, i, 255 - i, (i * 7) & 0xff, 128);
+				SDL_RenderFillRect(renderer, &rect);
+				SDL_RenderCopy(renderer, texture, NULL, &rect);
+			}
+			SDL_Rect one = { 0, 0, 1, 1 };
+			SDL_RenderReadPixels(renderer, &one, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel)); // waits for the frame
+		}
+		ms = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() / frames;
+	}
+	if (texture) { SDL_DestroyTexture(texture); }
+	SDL_DestroyRenderer(renderer);
+	return ms;
+}
+
+static int _FindRenderDriver(const char* name, ::Uint32 flags)
+{
+	for (int index = 0; index < SDL_GetNumRenderDrivers(); ++index)
+	{
+		const SDL_RendererInfo* renderer_info = _RenderDriverInfo(index);
+		if (renderer_info && (SDL_strcmp(renderer_info->name, name) == 0) && ((renderer_info->flags & flags & ~SDL_RENDERER_PRESENTVSYNC) == (flags & ~SDL_RENDERER_PRESENTVSYNC))) { return index; }
+	}
+	return -1;
+}
+
+// picks the fastest render driver supporting flags and returns its index for SDL_CreateRenderer, or -1
+// the choice is kept in file when given, later calls read it back instead of probing again
+// result, when given, receives name, cached, and ms with the milliseconds per probe frame of each driver
+NANX_EXPORT(SDL_EXT_SelectRenderDriver)
+{
+	::Uint32 flags = NANX_Uint32(info[0]);
+	bool has_file = info[1]->IsString();
+	v8::Local<v8::Object> result = (info[2]->IsObject())?(v8::Local<v8::Object>::Cast(info[2])):(Nan::New<v8::Object>());
+	int best = -1;
+	if (has_file)
+	{
+		char name[64] = { 0 };
+		SDL_RWops* src = SDL_RWFromFile(*v8::String::Utf8Value(info[1]), "rb");
+		if (src)
+		{
+			size_t size = SDL_RWread(src, name, 1, sizeof(name) - 1);
+			SDL_RWclose(src);
+			while ((size > 0) && ((name[size - 1] == '\n') || (name[size - 1] == '\r'))) { name[--size] = 0; }
+			best = _FindRenderDriver(name, flags);
+		}
+	}
+	result->Set(NANX_SYMBOL("cached"), Nan::New(best >= 0));
+	if (best < 0)
+	{
+		v8::Local<v8::Object> times = Nan::New<v8::Object>();
+		result->Set(NANX_SYMBOL("ms"), times);
+		SDL_Window* window = SDL_CreateWindow("", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 256, 256, SDL_WINDOW_HIDDEN);
+		if (!window) { info.GetReturnValue().Set(Nan::New(-1)); return; }
+		double best_ms = 0;
+		for (int index = 0; index < SDL_GetNumRenderDrivers(); ++index)
+		{
+			const SDL_RendererInfo* renderer_info = _RenderDriverInfo(index);
+			if (!renderer_info || ((renderer_info->flags & flags & ~SDL_RENDERER_PRESENTVSYNC) != (flags & ~SDL_RENDERER_PRESENTVSYNC))) { continue; }
+			double ms = _ProbeRenderDriver(window, index, flags);
+			if (ms < 0) { continue; }
+			times->Set(NANX_STRING(renderer_info->name), Nan::New(ms));
+			if ((best < 0) || (ms < best_ms)) { best = index; best_ms = ms; }
+		}
+		SDL_DestroyWindow(window);
+		if ((best >= 0) && has_file)
+		{
+			const char* name = _RenderDriverInfo(best)->name;
+			SDL_RWops* dst = SDL_RWFromFile(*v8::String::Utf8Value(info[1]), "wb");
+			if (dst) { SDL_RWwrite(dst, name, 1, SDL_strlen(name)); SDL_RWwrite(dst, "\n", 1, 1); SDL_RWclose(dst); }
+		}
+	}
+	if (best >= 0) { result->Set(NANX_SYMBOL("name"), NANX_STRING(_RenderDriverInfo(best)->name)); }
+	info.GetReturnValue().Set(Nan::New(best));
+}
+
+// TODO: extern DECLSPEC int SDLCALL SDL_CreateWindowAndRenderer(int width, int height, Uint32 window_flags, SDL_Window **window, SDL_Renderer **renderer);
+
+// extern DECLSPEC SDL_Renderer * SDLCALL SDL_CreateRenderer(SDL_Window * window,
+NANX_EXPORT(SDL_CreateRenderer)
+{
+	SDL_Window* window = WrapWindow::Peek(info[0]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
+	int index = NANX_int(info[1]);
+	::Uint32 flags = NANX_Uint32(info[2]);
+	SDL_Renderer* renderer = SDL_CreateRenderer(window, index, flags);
+	info.GetReturnValue().Set(WrapRenderer::Hold(renderer));
+}
+
+// extern DECLSPEC SDL_Renderer * SDLCALL SDL_CreateSoftwareRenderer(SDL_Surface * surface);
+NANX_EXPORT(SDL_CreateSoftwareRenderer)
+{
+	SDL_Surface* surface = WrapSurface::Peek(info[0]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
+	SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(surface);
+	info.GetReturnValue().Set(WrapRenderer::Hold(renderer));
+}
+
+// TODO: extern DECLSPEC SDL_Renderer * SDLCALL SDL_GetRenderer(SDL_Window * window);
+// extern DECLSPEC int SDLCALL SDL_GetRendererInfo(SDL_Renderer * renderer, SDL_RendererInfo * info);
+NANX_EXPORT(SDL_GetRendererInfo)
+{
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	v8::Local<v8::Object> _info = v8::Local<v8::Object>::Cast(info[1]);
+	SDL_RendererInfo renderer_info; // queried afresh, the flags can change after creation
+	int err = SDL_GetRendererInfo(renderer, &renderer_info);
+	if (err == 0) { _RendererInfoToObject(&renderer_info, _info); }
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// extern DECLSPEC int SDLCALL SDL_GetRendererOutputSize(SDL_Renderer * renderer, int *w, int *h);
+NANX_EXPORT(SDL_GetRendererOutputSize)
+{
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	v8::Local<v8::Object> size = v8::Local<v8::Object>::Cast(info[1]);
+	int w = 0;
+	int h = 0;
+	int err = SDL_GetRendererOutputSize(renderer, &w, &h);
+	size->Set(NANX_SYMBOL("w"), Nan::New(w));
+	size->Set(NANX_SYMBOL("h"), Nan::New(h));
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+
+// extern DECLSPEC SDL_Texture * SDLCALL SDL_CreateTexture(SDL_Renderer * renderer, Uint32 format, int access, int w, int h);
+NANX_EXPORT(SDL_CreateTexture)
+{
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	::Uint32 format = NANX_Uint32(info[1]);
+	int access = NANX_int(info[2]);
+	int w = NANX_int(info[3]);
+	int h = NANX_int(info[4]);
+	SDL_Texture* texture = SDL_CreateTexture(renderer, format, access, w, h);
+	info.GetReturnValue().Set(WrapTexture::Hold(texture, info[0]));
+}
 
-NANX_EXPORT(SDL_GetError)
+// extern DECLSPEC SDL_Texture * SDLCALL SDL_CreateTextureFromSurface(SDL_Renderer * renderer, SDL_Surface * surface);
+NANX_EXPORT(SDL_CreateTextureFromSurface)
 {
-	const char* sdl_error = SDL_GetError();
-	info.GetReturnValue().Set(NANX_STRING(sdl_error));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Surface* surface = WrapSurface::Peek(info[1]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
+	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+	info.GetReturnValue().Set(WrapTexture::Hold(texture, info[0]));
 }
 
-NANX_EXPORT(SDL_ClearError)
+// extern DECLSPEC int SDLCALL SDL_QueryTexture(SDL_Texture * texture, Uint32 * format, int *access, int *w, int *h);
+NANX_EXPORT(SDL_QueryTexture)
 {
-	SDL_ClearError();
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	v8::Local<v8::Object> query = v8::Local<v8::Object>::Cast(info[1]);
+	::Uint32 format = 0;
+	int access = 0;
+	int w = 0;
+	int h = 0;
+	int err = SDL_QueryTexture(texture, &format, &access, &w, &h);
+	query->Set(NANX_SYMBOL("format"), Nan::New(format));
+	query->Set(NANX_SYMBOL("access"), Nan::New(access));
+	query->Set(NANX_SYMBOL("w"), Nan::New(w));
+	query->Set(NANX_SYMBOL("h"), Nan::New(h));
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// SDL_events.h
+// extern DECLSPEC int SDLCALL SDL_SetTextureColorMod(SDL_Texture * texture, Uint8 r, Uint8 g, Uint8 b);
+NANX_EXPORT(SDL_SetTextureColorMod)
+{
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	::Uint8 r = NANX_Uint8(info[1]);
+	::Uint8 g = NANX_Uint8(info[2]);
+	::Uint8 b = NANX_Uint8(info[3]);
+	int err = SDL_SetTextureColorMod(texture, r, g, b);
+	info.GetReturnValue().Set(Nan::New(err));
+}
 
-NANX_EXPORT(SDL_PollEvent)
+// extern DECLSPEC int SDLCALL SDL_GetTextureColorMod(SDL_Texture * texture, Uint8 * r, Uint8 * g, Uint8 * b);
+NANX_EXPORT(SDL_GetTextureColorMod)
 {
-	SDL_Event event;
-	if (!SDL_PollEvent(&event))
-	{
-		info.GetReturnValue().SetNull();
-		return;
-	}
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	v8::Local<v8::Object> color = v8::Local<v8::Object>::Cast(info[1]);
+	::Uint8 r = 0;
+	::Uint8 g = 0;
+	::Uint8 b = 0;
+	int err = SDL_GetTextureColorMod(texture, &r, &g, &b);
+	color->Set(NANX_SYMBOL("r"), Nan::New(r));
+	color->Set(NANX_SYMBOL("g"), Nan::New(g));
+	color->Set(NANX_SYMBOL("b"), Nan::New(b));
+	info.GetReturnValue().Set(Nan::New(err));
+}
 
-	v8::Local<v8::Object> evt = Nan::New<v8::Object>();
-	evt->Set(NANX_SYMBOL("type"), Nan::New(event.type));
-	evt->Set(NANX_SYMBOL("timestamp"), Nan::New(event.common.timestamp));
+// extern DECLSPEC int SDLCALL SDL_SetTextureAlphaMod(SDL_Texture * texture, Uint8 alpha);
+NANX_EXPORT(SDL_SetTextureAlphaMod)
+{
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	::Uint8 alpha = NANX_Uint8(info[1]);
+	int err = SDL_SetTextureAlphaMod(texture, alpha);
+	info.GetReturnValue().Set(Nan::New(err));
+}
 
-	switch (event.type)
+// extern DECLSPEC int SDLCALL SDL_GetTextureAlphaMod(SDL_Texture * texture, Uint8 * alpha);
+NANX_EXPORT(SDL_GetTextureAlphaMod)
+{
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	v8::Local<v8::Array> ret_value = v8::Local<v8::Array>::Cast(info[1]);
+	::Uint8 alpha = 0;
+	int err = SDL_GetTextureAlphaMod(texture, &alpha);
+	ret_value->Set(0, Nan::New(alpha));
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// extern DECLSPEC int SDLCALL SDL_SetTextureBlendMode(SDL_Texture * texture, SDL_BlendMode blendMode);
+NANX_EXPORT(SDL_SetTextureBlendMode)
+{
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_BlendMode mode = NANX_SDL_BlendMode(info[1]);
+	int err = SDL_SetTextureBlendMode(texture, mode);
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// extern DECLSPEC int SDLCALL SDL_GetTextureBlendMode(SDL_Texture * texture, SDL_BlendMode *blendMode);
+NANX_EXPORT(SDL_GetTextureBlendMode)
+{
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	v8::Local<v8::Array> ret_value = v8::Local<v8::Array>::Cast(info[1]);
+	SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+	int err = SDL_GetTextureBlendMode(texture, &mode);
+	ret_value->Set(0, Nan::New(static_cast<int>(mode)));
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// rows must not overlap or run backwards, checked before _SDL_EXT_TextureDataSize
+static bool _SDL_EXT_TexturePitchValid(::Uint32 format, int w, int h, int pitch)
+{
+	return (w <= 0) || (h <= 0) || (static_cast< ::Sint64 >(pitch) >= static_cast< ::Sint64 >(w) * SDL_BYTESPERPIXEL(format));
+}
+
+// bytes needed for a w x h area of pixels with the given pitch
+static size_t _SDL_EXT_TextureDataSize(::Uint32 format, int w, int h, int pitch)
+{
+	if ((w <= 0) || (h <= 0)) { return 0; }
+	if (!_SDL_EXT_TexturePitchValid(format, w, h, pitch)) { return static_cast<size_t>(-1); } // never fits
+	if (SDL_ISPIXELFORMAT_FOURCC(format))
 	{
-	case SDL_QUIT:
-		//info.GetReturnValue().Set(n_SDL_QuitEvent::NewInstance(event.quit));
-		break;
-	case SDL_APP_TERMINATING:
-	case SDL_APP_LOWMEMORY:
-	case SDL_APP_WILLENTERBACKGROUND:
-	case SDL_APP_DIDENTERBACKGROUND:
-	case SDL_APP_WILLENTERFOREGROUND:
-	case SDL_APP_DIDENTERFOREGROUND:
-		//info.GetReturnValue().Set(WrapCommonEvent::NewInstance(event.common));
-		break;
-	case SDL_WINDOWEVENT:
-		//info.GetReturnValue().Set(WrapWindowEvent::NewInstance(event.window));
-		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.window.windowID));
-		evt->Set(NANX_SYMBOL("event"), Nan::New(event.window.event));
-		evt->Set(NANX_SYMBOL("data1"), Nan::New(event.window.data1));
-		evt->Set(NANX_SYMBOL("data2"), Nan::New(event.window.data2));
-		break;
-	case SDL_SYSWMEVENT:
-		// TODO
-		break;
-	case SDL_KEYDOWN:
-	case SDL_KEYUP:
-		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.key.windowID));
-		evt->Set(NANX_SYMBOL("state"), Nan::New(event.key.state));
-		evt->Set(NANX_SYMBOL("repeat"), Nan::New(event.key.repeat));
-		evt->Set(NANX_SYMBOL("scancode"), Nan::New(event.key.keysym.scancode));
-		evt->Set(NANX_SYMBOL("sym"), Nan::New(event.key.keysym.sym));
-		evt->Set(NANX_SYMBOL("mod"), Nan::New(event.key.keysym.mod));
-		break;
-	case SDL_TEXTEDITING:
-	case SDL_TEXTINPUT:
-		// TODO
-		break;
-	case SDL_MOUSEMOTION:
-		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.motion.windowID));
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.motion.which));
-		evt->Set(NANX_SYMBOL("state"), Nan::New(event.motion.state));
-		evt->Set(NANX_SYMBOL("x"), Nan::New(event.motion.x));
-		evt->Set(NANX_SYMBOL("y"), Nan::New(event.motion.y));
-		evt->Set(NANX_SYMBOL("xrel"), Nan::New(event.motion.xrel));
-		evt->Set(NANX_SYMBOL("yrel"), Nan::New(event.motion.yrel));
-		{
-			int w = 0, h = 0;
-			SDL_GetWindowSize(SDL_GetWindowFromID(event.motion.windowID), &w, &h);
-			evt->Set(NANX_SYMBOL("nx"), Nan::New((2.0f * float(event.motion.x) / w) - 1.0f));
-			evt->Set(NANX_SYMBOL("ny"), Nan::New(1.0f - (2.0f * float(event.motion.y) / h)));
-		}
-		break;
-	case SDL_MOUSEBUTTONDOWN:
-	case SDL_MOUSEBUTTONUP:
-		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.button.windowID));
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.button.which));
-		evt->Set(NANX_SYMBOL("button"), Nan::New(event.button.button));
-		evt->Set(NANX_SYMBOL("state"), Nan::New(event.button.state));
-		evt->Set(NANX_SYMBOL("x"), Nan::New(event.button.x));
-		evt->Set(NANX_SYMBOL("y"), Nan::New(event.button.y));
-		{
-			int w = 0, h = 0;
-			SDL_GetWindowSize(SDL_GetWindowFromID(event.button.windowID), &w, &h);
-			evt->Set(NANX_SYMBOL("nx"), Nan::New((2.0f * float(event.button.x) / w) - 1.0f));
-			evt->Set(NANX_SYMBOL("ny"), Nan::New(1.0f - (2.0f * float(event.button.y) / h)));
-		}
-		break;
-	case SDL_MOUSEWHEEL:
-		evt->Set(NANX_SYMBOL("windowID"), Nan::New(event.wheel.windowID));
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.wheel.which));
-		evt->Set(NANX_SYMBOL("x"), Nan::New(event.wheel.x));
-		evt->Set(NANX_SYMBOL("y"), Nan::New(event.wheel.y));
-		break;
-	case SDL_JOYAXISMOTION:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jaxis.which));
-		evt->Set(NANX_SYMBOL("axis"), Nan::New(event.jaxis.axis));
-		evt->Set(NANX_SYMBOL("value"), Nan::New(event.jaxis.value));
-		break;
-	case SDL_JOYBALLMOTION:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jball.which));
-		evt->Set(NANX_SYMBOL("ball"), Nan::New(event.jball.ball));
-		evt->Set(NANX_SYMBOL("xrel"), Nan::New(event.jball.xrel));
-		evt->Set(NANX_SYMBOL("yrel"), Nan::New(event.jball.yrel));
-		break;
-	case SDL_JOYHATMOTION:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jhat.which));
-		evt->Set(NANX_SYMBOL("hat"), Nan::New(event.jhat.hat));
-		evt->Set(NANX_SYMBOL("value"), Nan::New(event.jhat.value));
-		break;
-	case SDL_JOYBUTTONDOWN:
-	case SDL_JOYBUTTONUP:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jbutton.which));
-		evt->Set(NANX_SYMBOL("button"), Nan::New(event.jbutton.button));
-		evt->Set(NANX_SYMBOL("state"), Nan::New(event.jbutton.state));
-		break;
-	case SDL_JOYDEVICEADDED:
-	case SDL_JOYDEVICEREMOVED:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.jdevice.which));
-		break;
-	case SDL_CONTROLLERAXISMOTION:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.caxis.which));
-		evt->Set(NANX_SYMBOL("axis"), Nan::New(event.caxis.axis));
-		evt->Set(NANX_SYMBOL("value"), Nan::New(event.caxis.value));
-		break;
-	case SDL_CONTROLLERBUTTONDOWN:
-	case SDL_CONTROLLERBUTTONUP:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.cbutton.which));
-		evt->Set(NANX_SYMBOL("button"), Nan::New(event.cbutton.button));
-		evt->Set(NANX_SYMBOL("state"), Nan::New(event.cbutton.state));
-		break;
-	case SDL_CONTROLLERDEVICEADDED:
-	case SDL_CONTROLLERDEVICEREMOVED:
-	case SDL_CONTROLLERDEVICEREMAPPED:
-		evt->Set(NANX_SYMBOL("which"), Nan::New(event.cdevice.which));
-		break;
-	case SDL_FINGERDOWN:
-	case SDL_FINGERUP:
-	case SDL_FINGERMOTION:
-		//evt->Set(NANX_SYMBOL("touchId"), Nan::New((int32_t) event.tfinger.touchId)); // TODO: 64 bit integer
-		//evt->Set(NANX_SYMBOL("fingerId"), Nan::New((int32_t) event.tfinger.fingerId)); // TODO: 64 bit integer
+		switch (format)
 		{
-			char buffer[64];
-			SDL_snprintf(buffer, sizeof(buffer), "%" SDL_PRIs64, event.tfinger.touchId);
-			evt->Set(NANX_SYMBOL("touchId"), NANX_STRING(buffer));
-			SDL_snprintf(buffer, sizeof(buffer), "%" SDL_PRIs64, event.tfinger.fingerId);
-			evt->Set(NANX_SYMBOL("fingerId"), NANX_STRING(buffer));
+		case SDL_PIXELFORMAT_YV12:
+		case SDL_PIXELFORMAT_IYUV:
+		#if SDL_VERSION_ATLEAST(2, 0, 4)
+		case SDL_PIXELFORMAT_NV12:
+		case SDL_PIXELFORMAT_NV21:
+		#endif
+			// Y plane then two half size chroma planes, or one interleaved one
+			return static_cast<size_t>(pitch) * h + 2 * static_cast<size_t>((pitch + 1) / 2) * ((h + 1) / 2);
+		default:
+			return static_cast<size_t>(pitch) * h; // packed YUY2, UYVY, YVYU
 		}
-		evt->Set(NANX_SYMBOL("x"), Nan::New(event.tfinger.x));
-		evt->Set(NANX_SYMBOL("y"), Nan::New(event.tfinger.y));
-		evt->Set(NANX_SYMBOL("dx"), Nan::New(event.tfinger.dx));
-		evt->Set(NANX_SYMBOL("dy"), Nan::New(event.tfinger.dy));
-		evt->Set(NANX_SYMBOL("pressure"), Nan::New(event.tfinger.pressure));
-		evt->Set(NANX_SYMBOL("nx"), Nan::New((2.0f * float(event.tfinger.x)) - 1.0f));
-		evt->Set(NANX_SYMBOL("ny"), Nan::New(1.0f - (2.0f * float(event.tfinger.y))));
-		break;
-	case SDL_DOLLARGESTURE:
-	case SDL_DOLLARRECORD:
-	case SDL_MULTIGESTURE:
-	case SDL_CLIPBOARDUPDATE:
-	case SDL_DROPFILE:
-	#if SDL_VERSION_ATLEAST(2,0,5)
-	case SDL_DROPTEXT:
-	case SDL_DROPBEGIN:
-	case SDL_DROPCOMPLETE:
-	#endif
-	#if SDL_VERSION_ATLEAST(2,0,4)
-	case SDL_AUDIODEVICEADDED:
-	case SDL_AUDIODEVICEREMOVED:
-	case SDL_RENDER_TARGETS_RESET:
-	case SDL_RENDER_DEVICE_RESET:
-	#endif
-	case SDL_USEREVENT:
-		// TODO
-		break;
-	default:
-		break;
 	}
+	return static_cast<size_t>(pitch) * (h - 1) + static_cast<size_t>(w) * SDL_BYTESPERPIXEL(format);
+}
 
-	info.GetReturnValue().Set(evt);
+// extern DECLSPEC int SDLCALL SDL_UpdateTexture(SDL_Texture * texture, const SDL_Rect * rect, const void *pixels, int pitch);
+NANX_EXPORT(SDL_UpdateTexture)
+{
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[2]->IsTypedArray()) { return Nan::ThrowError("pixels is a typed array"); }
+	#endif
+	size_t byte_length = 0;
+	void* pixels = _TypedArrayData(info[2], &byte_length);
+	int pitch = NANX_int(info[3]);
+	::Uint32 format = 0;
+	int w = 0;
+	int h = 0;
+	SDL_QueryTexture(texture, &format, NULL, &w, &h);
+	if (rect) { w = rect->w; h = rect->h; }
+	if (!_SDL_EXT_TexturePitchValid(format, w, h, pitch)) { return Nan::ThrowError("pitch smaller than a row"); }
+	if (byte_length < _SDL_EXT_TextureDataSize(format, w, h, pitch)) { return Nan::ThrowError("pixel data too small"); }
+	int err = SDL_UpdateTexture(texture, rect, pixels, pitch);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// SDL_gamecontroller.h
-// SDL_gesture.h
-// SDL_haptic.h
+// rows must not overlap or run backwards, checked before _PlaneSize
+static bool _PlanePitchValid(int pitch, int row_size, int rows)
+{
+	return (rows <= 0) || (row_size <= 0) || (pitch >= row_size);
+}
 
-// SDL_hints.h
+// bytes a plane must hold, the last row may stop at its data
+static size_t _PlaneSize(int pitch, int row_size, int rows)
+{
+	if ((rows <= 0) || (row_size <= 0)) { return 0; }
+	if (pitch < row_size) { return static_cast<size_t>(-1); } // never fits
+	return static_cast<size_t>(pitch) * (rows - 1) + row_size;
+}
 
-NANX_EXPORT(SDL_SetHintWithPriority)
+// extern DECLSPEC int SDLCALL SDL_UpdateYUVTexture(SDL_Texture * texture, const SDL_Rect * rect, const Uint8 *Yplane, int Ypitch, const Uint8 *Uplane, int Upitch, const Uint8 *Vplane, int Vpitch);
+// planes are uploaded straight from the typed arrays
+NANX_EXPORT(SDL_UpdateYUVTexture)
 {
-	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
-	v8::Local<v8::String> value = v8::Local<v8::String>::Cast(info[1]);
-	SDL_HintPriority priority = NANX_SDL_HintPriority(info[2]);
-	SDL_bool ret = SDL_SetHintWithPriority(*v8::String::Utf8Value(name), *v8::String::Utf8Value(value), priority);
-	info.GetReturnValue().Set(Nan::New(ret != SDL_FALSE));
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[2]->IsTypedArray() || !info[4]->IsTypedArray() || !info[6]->IsTypedArray()) { return Nan::ThrowError("planes are typed arrays"); }
+	#endif
+	size_t y_length = 0, u_length = 0, v_length = 0;
+	const ::Uint8* y_plane = static_cast<const ::Uint8*>(_TypedArrayData(info[2], &y_length));
+	int y_pitch = NANX_int(info[3]);
+	const ::Uint8* u_plane = static_cast<const ::Uint8*>(_TypedArrayData(info[4], &u_length));
+	int u_pitch = NANX_int(info[5]);
+	const ::Uint8* v_plane = static_cast<const ::Uint8*>(_TypedArrayData(info[6], &v_length));
+	int v_pitch = NANX_int(info[7]);
+	int w = 0, h = 0;
+	SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+	if (rect) { w = rect->w; h = rect->h; }
+	if (!_PlanePitchValid(y_pitch, w, h) || !_PlanePitchValid(u_pitch, (w + 1) / 2, (h + 1) / 2) || !_PlanePitchValid(v_pitch, (w + 1) / 2, (h + 1) / 2))
+	{
+		return Nan::ThrowError("plane pitch smaller than a row");
+	}
+	if ((y_length < _PlaneSize(y_pitch, w, h)) ||
+		(u_length < _PlaneSize(u_pitch, (w + 1) / 2, (h + 1) / 2)) ||
+		(v_length < _PlaneSize(v_pitch, (w + 1) / 2, (h + 1) / 2)))
+	{
+		return Nan::ThrowError("plane data too small");
+	}
+	int err = SDL_UpdateYUVTexture(texture, rect, y_plane, y_pitch, u_plane, u_pitch, v_plane, v_pitch);
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// extern DECLSPEC int SDLCALL SDL_UpdateNVTexture(SDL_Texture * texture, const SDL_Rect * rect, const Uint8 *Yplane, int Ypitch, const Uint8 *UVplane, int UVpitch);
+NANX_EXPORT(SDL_UpdateNVTexture)
+{
+	#if SDL_VERSION_ATLEAST(2, 0, 16)
+	SDL_Texture* texture = WrapTexture::Peek(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[2]->IsTypedArray() || !info[4]->IsTypedArray()) { return Nan::ThrowError("planes are typed arrays"); }
+	#endif
+	size_t y_length = 0, uv_length = 0;
+	const ::Uint8* y_plane = static_cast<const ::Uint8*>(_TypedArrayData(info[2], &y_length));
+	int y_pitch = NANX_int(info[3]);
+	const ::Uint8* uv_plane = static_cast<const ::Uint8*>(_TypedArrayData(info[4], &uv_length));
+	int uv_pitch = NANX_int(info[5]);
+	int w = 0, h = 0;
+	SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+	if (rect) { w = rect->w; h = rect->h; }
+	if (!_PlanePitchValid(y_pitch, w, h) || !_PlanePitchValid(uv_pitch, 2 * ((w + 1) / 2), (h + 1) / 2))
+	{
+		return Nan::ThrowError("plane pitch smaller than a row");
+	}
+	if ((y_length < _PlaneSize(y_pitch, w, h)) || (uv_length < _PlaneSize(uv_pitch, 2 * ((w + 1) / 2), (h + 1) / 2)))
+	{
+		return Nan::ThrowError("plane data too small");
+	}
+	int err = SDL_UpdateNVTexture(texture, rect, y_plane, y_pitch, uv_plane, uv_pitch);
+	info.GetReturnValue().Set(Nan::New(err));
+	#else
+	return Nan::ThrowError("SDL_UpdateNVTexture needs SDL 2.0.16 or later");
+	#endif
 }
 
-NANX_EXPORT(SDL_SetHint)
+// yuv to rgba conversion for frames shown without a yuv capable texture
+// fixed point with 6 fraction bits, the sse2 path gives the same bytes as the scalar one
+
+static const int SDL_EXT_YUV_BT601 = 0; // limited range
+static const int SDL_EXT_YUV_BT709 = 1; // limited range
+static const int SDL_EXT_YUV_JPEG = 2; // full range bt601
+
+struct _YUVMatrix { int y_offset, y_mul, rv, gu, gv, bu; };
+
+static const _YUVMatrix _yuv_matrices[] =
 {
-	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
-	v8::Local<v8::String> value = v8::Local<v8::String>::Cast(info[1]);
-	SDL_bool ret = SDL_SetHint(*v8::String::Utf8Value(name), *v8::String::Utf8Value(value));
-	info.GetReturnValue().Set(Nan::New(ret != SDL_FALSE));
-}
+	{ 16, 74, 102, 25, 52, 129 },
+	{ 16, 74, 115, 14, 34, 135 },
+	{ 0, 64, 90, 22, 46, 113 }
+};
 
-NANX_EXPORT(SDL_GetHint)
+struct _YUVFrame
 {
-	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
-	const char* value = SDL_GetHint(*v8::String::Utf8Value(name));
-	info.GetReturnValue().Set(NANX_STRING(value));
-}
+	const _YUVMatrix* matrix;
+	int w, h;
+	const ::Uint8* y; int y_pitch;
+	const ::Uint8* u; int u_pitch; // interleaved uv when v is null
+	const ::Uint8* v; int v_pitch;
+	::Uint8* dst; int dst_pitch;
+	bool bgra;
+};
 
-#if SDL_VERSION_ATLEAST(2, 0, 5)
-NANX_EXPORT(SDL_GetHintBoolean)
+static inline ::Uint8 _YUVClamp(int value)
 {
-	v8::Local<v8::String> name = v8::Local<v8::String>::Cast(info[0]);
-	SDL_bool default_value = (info[1]->IsBoolean())?(NANX_SDL_bool(info[1])):(SDL_FALSE);
-	SDL_bool value = SDL_GetHintBoolean(*v8::String::Utf8Value(name), default_value);
-	info.GetReturnValue().Set(Nan::New(value));
+	value = (value + 32) >> 6;
+	return static_cast< ::Uint8 >((value < 0)?(0):((value > 255)?(255):(value)));
 }
-#endif
-
-// TODO: typedef void (*SDL_HintCallback)(void *userdata, const char *name, const char *oldValue, const char *newValue);
-// TODO: extern DECLSPEC void SDLCALL SDL_AddHintCallback(const char *name, SDL_HintCallback callback, void *userdata);
-// TODO: extern DECLSPEC void SDLCALL SDL_DelHintCallback(const char *name, SDL_HintCallback callback, void *userdata);
 
-NANX_EXPORT(SDL_ClearHints)
+static void _YUVRowScalar(const _YUVFrame& frame, const ::Uint8* y, const ::Uint8* u, const ::Uint8* v, int uv_step, ::Uint8* dst, int x0)
 {
-	SDL_ClearHints();
+	const _YUVMatrix& m = *frame.matrix;
+	int r_index = (frame.bgra)?(2):(0), b_index = (frame.bgra)?(0):(2);
+	for (int x = x0; x < frame.w; ++x)
+	{
+		int yy = (y[x] - m.y_offset) * m.y_mul;
+		int uu = u[(x >> 1) * uv_step] - 128;
+		int vv = v[(x >> 1) * uv_step] - 128;
+		::Uint8* p = dst + x * 4;
+		p[r_index] = _YUVClamp(yy + m.rv * vv);
+		p[1] = _YUVClamp(yy - m.gu * uu - m.gv * vv);
+		p[b_index] = _YUVClamp(yy + m.bu * uu);
+		p[3] = 255;
+	}
 }
 
-// SDL_joystick.h
+#if _SIMD_SSE2
+// 8 pixels at a time, returns the first x left for the scalar tail
+static int _YUVRowSSE2(const _YUVFrame& frame, const ::Uint8* y, const ::Uint8* u, const ::Uint8* v, bool interleaved, ::Uint8* dst)
+{
+	const _YUVMatrix& m = *frame.matrix;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i y_offset = _mm_set1_epi16(static_cast<short>(m.y_offset));
+	const __m128i y_mul = _mm_set1_epi16(static_cast<short>(m.y_mul));
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i rv = _mm_set1_epi16(static_cast<short>(m.rv));
+	const __m128i gu = _mm_set1_epi16(static_cast<short>(m.gu));
+	const __m128i gv = _mm_set1_epi16(static_cast<short>(m.gv));
+	const __m128i bu = _mm_set1_epi16(static_cast<short>(m.bu));
+	const __m128i round = _mm_set1_epi16(32);
+	const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xff));
+	int x = 0;
+	for (; x + 8 <= frame.w; x += 8)
+	{
+		__m128i yy = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero);
+		__m128i uu, vv;
+		if (interleaved)
+		{
+			__m128i uv = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x)), zero); // u0 v0 u1 v1 ..
+			__m128i u32 = _mm_and_si128(uv, _mm_set1_epi32(0xffff));
+			__m128i v32 = _mm_srli_epi32(uv, 16);
+			uu = _mm_or_si128(u32, _mm_slli_epi32(u32, 16));
+			vv = _mm_or_si128(v32, _mm_slli_epi32(v32, 16));
+		}
+		else
+		{
+			int u4 = 0, v4 = 0;
+			SDL_memcpy(&u4, u + (x >> 1), 4);
+			SDL_memcpy(&v4, v + (x >> 1), 4);
+			uu = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u4), zero);
+			vv = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v4), zero);
+			uu = _mm_unpacklo_epi16(uu, uu);
+			vv = _mm_unpacklo_epi16(vv, vv);
+		}
+		yy = _mm_mullo_epi16(_mm_sub_epi16(yy, y_offset), y_mul);
+		uu = _mm_sub_epi16(uu, c128);
+		vv = _mm_sub_epi16(vv, c128);
+		// saturation only happens far outside 0..255, the clamp below gives the same bytes as the scalar path
+		__m128i r = _mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(vv, rv)), round);
+		__m128i g = _mm_adds_epi16(_mm_subs_epi16(_mm_subs_epi16(yy, _mm_mullo_epi16(uu, gu)), _mm_mullo_epi16(vv, gv)), round);
+		__m128i b = _mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(uu, bu)), round);
+		r = _mm_packus_epi16(_mm_srai_epi16(r, 6), zero);
+		g = _mm_packus_epi16(_mm_srai_epi16(g, 6), zero);
+		b = _mm_packus_epi16(_mm_srai_epi16(b, 6), zero);
+		if (frame.bgra) { __m128i t = r; r = b; b = t; }
+		__m128i rg = _mm_unpacklo_epi8(r, g);
+		__m128i ba = _mm_unpacklo_epi8(b, alpha);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+	}
+	return x;
+}
+#endif
 
-NANX_EXPORT(SDL_NumJoysticks)
+static void _YUVConvertRows(const _YUVFrame& frame, int y0, int y1)
 {
-	info.GetReturnValue().Set(Nan::New(SDL_NumJoysticks()));
+	bool interleaved = (frame.v == NULL);
+	for (int row = y0; row < y1; ++row)
+	{
+		const ::Uint8* y = frame.y + row * frame.y_pitch;
+		const ::Uint8* u = frame.u + (row >> 1) * frame.u_pitch;
+		const ::Uint8* v = (interleaved)?(u + 1):(frame.v + (row >> 1) * frame.v_pitch);
+		::Uint8* dst = frame.dst + row * frame.dst_pitch;
+		int x = 0;
+		#if _SIMD_SSE2
+		x = _YUVRowSSE2(frame, y, u, v, interleaved, dst);
+		#endif
+		_YUVRowScalar(frame, y, u, v, (interleaved)?(2):(1), dst, x);
+	}
 }
 
-NANX_EXPORT(SDL_JoystickNameForIndex)
+static void _YUVConvertJob(void* data, int index)
 {
-	int device_index = NANX_int(info[0]);
-	const char* name = SDL_JoystickNameForIndex(device_index);
-	info.GetReturnValue().Set(NANX_STRING(name));
+	const _YUVFrame& frame = *static_cast<const _YUVFrame*>(data);
+	int band_h = ((frame.h + 63) / 64) * 2; // even, so bands never split a chroma row pair
+	band_h = SDL_max(band_h, 32);
+	_YUVConvertRows(frame, SDL_min(index * band_h, frame.h), SDL_min((index + 1) * band_h, frame.h));
 }
 
-NANX_EXPORT(SDL_JoystickOpen)
+// converts I420 (u and v planes) or NV12 (v is null, u holds interleaved uv) into 32 bit pixels,
+// bytes r, g, b, a or with bgra b, g, r, a, for renderers without yuv textures
+// rows are split across cores
+NANX_EXPORT(SDL_EXT_ConvertYUV)
 {
-	int device_index = NANX_int(info[0]);
-	SDL_Joystick* joystick = SDL_JoystickOpen(device_index);
-	info.GetReturnValue().Set(WrapJoystick::Hold(joystick));
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[0]->IsTypedArray() || !info[4]->IsTypedArray() || !info[6]->IsTypedArray() || !(info[8]->IsNull() || info[8]->IsTypedArray()))
+	{
+		return Nan::ThrowError("planes are typed arrays");
+	}
+	#endif
+	size_t dst_length = 0, y_length = 0, u_length = 0, v_length = 0;
+	_YUVFrame frame;
+	frame.dst = static_cast< ::Uint8*>(_TypedArrayData(info[0], &dst_length));
+	frame.dst_pitch = NANX_int(info[1]);
+	frame.w = NANX_int(info[2]);
+	frame.h = NANX_int(info[3]);
+	frame.y = static_cast<const ::Uint8*>(_TypedArrayData(info[4], &y_length));
+	frame.y_pitch = NANX_int(info[5]);
+	frame.u = static_cast<const ::Uint8*>(_TypedArrayData(info[6], &u_length));
+	frame.u_pitch = NANX_int(info[7]);
+	frame.v = (info[8]->IsNull())?(NULL):(static_cast<const ::Uint8*>(_TypedArrayData(info[8], &v_length)));
+	frame.v_pitch = NANX_int(info[9]);
+	int matrix = (info[10]->IsNumber())?(NANX_int(info[10])):(SDL_EXT_YUV_BT601);
+	if ((matrix < 0) || (matrix >= static_cast<int>(countof(_yuv_matrices)))) { return Nan::ThrowError("unknown yuv matrix"); }
+	frame.matrix = &_yuv_matrices[matrix];
+	frame.bgra = info[11]->BooleanValue();
+	int chroma_w = (frame.w + 1) / 2, chroma_h = (frame.h + 1) / 2;
+	if ((frame.w <= 0) || (frame.h <= 0)) { return info.GetReturnValue().Set(Nan::New(0)); }
+	if (!_PlanePitchValid(frame.dst_pitch, frame.w * 4, frame.h) || !_PlanePitchValid(frame.y_pitch, frame.w, frame.h) ||
+		!_PlanePitchValid(frame.u_pitch, (frame.v)?(chroma_w):(2 * chroma_w), chroma_h) || (frame.v && !_PlanePitchValid(frame.v_pitch, chroma_w, chroma_h)))
+	{
+		return Nan::ThrowError("plane pitch smaller than a row");
+	}
+	if ((dst_length < _PlaneSize(frame.dst_pitch, frame.w * 4, frame.h)) ||
+		(y_length < _PlaneSize(frame.y_pitch, frame.w, frame.h)) ||
+		(u_length < _PlaneSize(frame.u_pitch, (frame.v)?(chroma_w):(2 * chroma_w), chroma_h)) ||
+		(frame.v && (v_length < _PlaneSize(frame.v_pitch, chroma_w, chroma_h))))
+	{
+		return Nan::ThrowError("plane data too small");
+	}
+	int band_h = SDL_max(((frame.h + 63) / 64) * 2, 32);
+	int band_count = (frame.h + band_h - 1) / band_h;
+	if (band_count > 1) { ForkJoinPool::Instance().Run(_YUVConvertJob, &frame, band_count); }
+	else { _YUVConvertRows(frame, 0, frame.h); }
+	info.GetReturnValue().Set(Nan::New(0));
 }
 
-NANX_EXPORT(SDL_JoystickName)
+// extern DECLSPEC int SDLCALL SDL_LockTexture(SDL_Texture * texture, const SDL_Rect * rect, void **pixels, int *pitch);
+// lock.pixels is an ArrayBuffer over the texture memory, it is detached by SDL_UnlockTexture
+NANX_EXPORT(SDL_LockTexture)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	const char* name = SDL_JoystickName(joystick);
-	info.GetReturnValue().Set(NANX_STRING(name));
+	WrapTexture* wrap = WrapTexture::Unwrap(info[0]);
+	SDL_Texture* texture = (wrap)?(wrap->Peek()):(NULL); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	v8::Local<v8::Object> lock = v8::Local<v8::Object>::Cast(info[2]);
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	void* pixels = NULL;
+	int pitch = 0;
+	int err = SDL_LockTexture(texture, rect, &pixels, &pitch);
+	if (err == 0)
+	{
+		::Uint32 format = 0;
+		int w = 0;
+		int h = 0;
+		SDL_QueryTexture(texture, &format, NULL, &w, &h);
+		if (rect) { w = rect->w; h = rect->h; }
+		v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), pixels, _SDL_EXT_TextureDataSize(format, w, h, pitch));
+		wrap->ReleaseLocked();
+		wrap->SetLocked(buffer);
+		lock->Set(NANX_SYMBOL("pixels"), buffer);
+		lock->Set(NANX_SYMBOL("pitch"), Nan::New(pitch));
+	}
+	info.GetReturnValue().Set(Nan::New(err));
+	#else
+	return Nan::ThrowError("SDL_LockTexture needs node 4 or later");
+	#endif
 }
 
-// TODO: extern DECLSPEC SDL_JoystickGUID SDLCALL SDL_JoystickGetDeviceGUID(int device_index);
-// TODO: extern DECLSPEC SDL_JoystickGUID SDLCALL SDL_JoystickGetGUID(SDL_Joystick * joystick);
-// TODO: extern DECLSPEC void SDL_JoystickGetGUIDString(SDL_JoystickGUID guid, char *pszGUID, int cbGUID);
-// TODO: extern DECLSPEC SDL_JoystickGUID SDLCALL SDL_JoystickGetGUIDFromString(const char *pchGUID);
-
-NANX_EXPORT(SDL_JoystickGetAttached)
+// extern DECLSPEC void SDLCALL SDL_UnlockTexture(SDL_Texture * texture);
+NANX_EXPORT(SDL_UnlockTexture)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	SDL_bool attached = SDL_JoystickGetAttached(joystick);
-	info.GetReturnValue().Set(Nan::New(attached != SDL_FALSE));
+	WrapTexture* wrap = WrapTexture::Unwrap(info[0]);
+	SDL_Texture* texture = (wrap)?(wrap->Peek()):(NULL); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	wrap->ReleaseLocked();
+	SDL_UnlockTexture(texture);
 }
 
-NANX_EXPORT(SDL_JoystickInstanceID)
+// extern DECLSPEC SDL_bool SDLCALL SDL_RenderTargetSupported(SDL_Renderer *renderer);
+NANX_EXPORT(SDL_RenderTargetSupported)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	SDL_JoystickID id = SDL_JoystickInstanceID(joystick);
-	info.GetReturnValue().Set(Nan::New(id));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_bool supported = SDL_RenderTargetSupported(renderer);
+	info.GetReturnValue().Set(Nan::New(supported != SDL_FALSE));
 }
 
-NANX_EXPORT(SDL_JoystickNumAxes)
+// extern DECLSPEC int SDLCALL SDL_SetRenderTarget(SDL_Renderer *renderer, SDL_Texture *texture);
+NANX_EXPORT(SDL_SetRenderTarget)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int num = SDL_JoystickNumAxes(joystick);
-	info.GetReturnValue().Set(Nan::New(num));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Texture* texture = NULL;
+	if (!info[1]->IsNull()) { texture = WrapTexture::Peek(info[1]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); } }
+	int err = SDL_SetRenderTarget(renderer, texture);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_JoystickNumBalls)
+// extern DECLSPEC SDL_Texture * SDLCALL SDL_GetRenderTarget(SDL_Renderer *renderer);
+// returns the script object of the target texture, or null for the default target
+NANX_EXPORT(SDL_GetRenderTarget)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int num = SDL_JoystickNumBalls(joystick);
-	info.GetReturnValue().Set(Nan::New(num));
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[0]);
+	SDL_Renderer* renderer = (wrap)?(wrap->Peek()):(NULL); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	WrapTexture* target = wrap->FindTexture(SDL_GetRenderTarget(renderer));
+	if (target) { info.GetReturnValue().Set(target->handle()); }
+	else { info.GetReturnValue().SetNull(); }
 }
 
-NANX_EXPORT(SDL_JoystickNumHats)
+// extern DECLSPEC int SDLCALL SDL_RenderSetLogicalSize(SDL_Renderer * renderer, int w, int h);
+NANX_EXPORT(SDL_RenderSetLogicalSize)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int num = SDL_JoystickNumHats(joystick);
-	info.GetReturnValue().Set(Nan::New(num));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	int w = NANX_int(info[1]);
+	int h = NANX_int(info[2]);
+	int err = SDL_RenderSetLogicalSize(renderer, w, h);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_JoystickNumButtons)
+// TODO: extern DECLSPEC void SDLCALL SDL_RenderGetLogicalSize(SDL_Renderer * renderer, int *w, int *h);
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+// TODO: extern DECLSPEC int SDLCALL SDL_RenderSetIntegerScale(SDL_Renderer * renderer, SDL_bool enable);
+// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_RenderGetIntegerScale(SDL_Renderer * renderer);
+#endif
+
+// extern DECLSPEC int SDLCALL SDL_RenderSetViewport(SDL_Renderer * renderer, const SDL_Rect * rect);
+NANX_EXPORT(SDL_RenderSetViewport)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int num = SDL_JoystickNumButtons(joystick);
-	info.GetReturnValue().Set(Nan::New(num));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	int err = SDL_RenderSetViewport(renderer, rect);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_JoystickUpdate)
+// extern DECLSPEC void SDLCALL SDL_RenderGetViewport(SDL_Renderer * renderer, SDL_Rect * rect);
+NANX_EXPORT(SDL_RenderGetViewport)
 {
-	SDL_JoystickUpdate();
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	SDL_RenderGetViewport(renderer, rect);
 }
 
-NANX_EXPORT(SDL_JoystickEventState)
+// extern DECLSPEC int SDLCALL SDL_RenderSetClipRect(SDL_Renderer * renderer, const SDL_Rect * rect);
+NANX_EXPORT(SDL_RenderSetClipRect)
 {
-	int state = NANX_int(info[0]);
-	int err = SDL_JoystickEventState(state);
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	int err = SDL_RenderSetClipRect(renderer, rect);
 	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_JoystickGetAxis)
+// extern DECLSPEC void SDLCALL SDL_RenderGetClipRect(SDL_Renderer * renderer, SDL_Rect * rect);
+NANX_EXPORT(SDL_RenderGetClipRect)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int index = NANX_int(info[1]);
-	Sint16 value = SDL_JoystickGetAxis(joystick, index);
-	info.GetReturnValue().Set(Nan::New(value));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	SDL_RenderGetClipRect(renderer, rect);
 }
 
-NANX_EXPORT(SDL_JoystickGetBall)
+// extern DECLSPEC int SDLCALL SDL_RenderSetScale(SDL_Renderer * renderer, float scaleX, float scaleY);
+NANX_EXPORT(SDL_RenderSetScale)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int index = NANX_int(info[1]);
-	int dx = 0; // TODO
-	int dy = 0; // TODO
-	int value = SDL_JoystickGetBall(joystick, index, &dx, &dy);
-	info.GetReturnValue().Set(Nan::New(value));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	float scaleX = NANX_float(info[1]);
+	float scaleY = NANX_float(info[2]);
+	int err = SDL_RenderSetScale(renderer, scaleX, scaleY);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_JoystickGetHat)
+// TODO: extern DECLSPEC void SDLCALL SDL_RenderGetScale(SDL_Renderer * renderer, float *scaleX, float *scaleY);
+
+// extern DECLSPEC int SDL_SetRenderDrawColor(SDL_Renderer * renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+NANX_EXPORT(SDL_SetRenderDrawColor)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int index = NANX_int(info[1]);
-	Uint8 value = SDL_JoystickGetHat(joystick, index);
-	info.GetReturnValue().Set(Nan::New(value));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	::Uint8 r = NANX_Uint8(info[1]);
+	::Uint8 g = NANX_Uint8(info[2]);
+	::Uint8 b = NANX_Uint8(info[3]);
+	::Uint8 a = NANX_Uint8(info[4]);
+	int err = SDL_SetRenderDrawColor(renderer, r, g, b, a);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_JoystickGetButton)
+// TODO: extern DECLSPEC int SDL_GetRenderDrawColor(SDL_Renderer * renderer, Uint8 * r, Uint8 * g, Uint8 * b, Uint8 * a);
+
+// extern DECLSPEC int SDLCALL SDL_SetRenderDrawBlendMode(SDL_Renderer * renderer, SDL_BlendMode blendMode);
+NANX_EXPORT(SDL_SetRenderDrawBlendMode)
 {
-	SDL_Joystick* joystick = WrapJoystick::Peek(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	int index = NANX_int(info[1]);
-	Uint8 value = SDL_JoystickGetButton(joystick, index);
-	info.GetReturnValue().Set(Nan::New(value));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_BlendMode mode = NANX_SDL_BlendMode(info[1]);
+	int err = SDL_SetRenderDrawBlendMode(renderer, mode);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_JoystickClose)
+// TODO: extern DECLSPEC int SDLCALL SDL_GetRenderDrawBlendMode(SDL_Renderer * renderer, SDL_BlendMode *blendMode);
+
+// extern DECLSPEC int SDLCALL SDL_RenderClear(SDL_Renderer * renderer);
+NANX_EXPORT(SDL_RenderClear)
 {
-	SDL_Joystick* joystick = WrapJoystick::Drop(info[0]); if (!joystick) { return Nan::ThrowError("null SDL_Joystick object"); }
-	SDL_JoystickClose(joystick);
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	int err = SDL_RenderClear(renderer);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// SDL_keyboard.h
-// SDL_keycode.h
-// SDL_loadso.h
-// SDL_log.h
-// SDL_main.h
-// SDL_messagebox.h
-// SDL_mouse.h
-// SDL_mutex.h
-// SDL_name.h
-// SDL_opengl.h
-// SDL_opengles.h
-// SDL_opengles2.h
-// SDL_pixels.h
+// extern DECLSPEC int SDLCALL SDL_RenderDrawPoint(SDL_Renderer * renderer, int x, int y);
+NANX_EXPORT(SDL_RenderDrawPoint)
+{
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	int x = NANX_int(info[1]);
+	int y = NANX_int(info[2]);
+	int err = SDL_RenderDrawPoint(renderer, x, y);
+	info.GetReturnValue().Set(Nan::New(err));
+}
 
-NANX_EXPORT(SDL_PIXELFLAG)
+// extern DECLSPEC int SDLCALL SDL_RenderDrawPoints(SDL_Renderer * renderer, const SDL_Point * points, int count);
+// points is an Int32Array of x, y pairs, read in place
+NANX_EXPORT(SDL_RenderDrawPoints)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_PIXELFLAG(format)));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsInt32Array()) { return Nan::ThrowError("points is an Int32Array"); }
+	#endif
+	size_t byte_length = 0;
+	const SDL_Point* points = static_cast<const SDL_Point*>(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(int32_t);
+	#endif
+	int count = NANX_int(info[2]);
+	if ((count < 0) || ((static_cast<size_t>(count) * sizeof(SDL_Point)) > byte_length)) { return Nan::ThrowError("points array too small"); }
+	int err = SDL_RenderDrawPoints(renderer, points, count);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_PIXELTYPE)
+// extern DECLSPEC int SDLCALL SDL_RenderDrawLine(SDL_Renderer * renderer, int x1, int y1, int x2, int y2);
+NANX_EXPORT(SDL_RenderDrawLine)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_PIXELTYPE(format)));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	int x1 = NANX_int(info[1]);
+	int y1 = NANX_int(info[2]);
+	int x2 = NANX_int(info[3]);
+	int y2 = NANX_int(info[4]);
+	int err = SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_PIXELORDER)
+// extern DECLSPEC int SDLCALL SDL_RenderDrawLines(SDL_Renderer * renderer, const SDL_Point * points, int count);
+// points is an Int32Array of x, y pairs, read in place
+NANX_EXPORT(SDL_RenderDrawLines)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_PIXELORDER(format)));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsInt32Array()) { return Nan::ThrowError("points is an Int32Array"); }
+	#endif
+	size_t byte_length = 0;
+	const SDL_Point* points = static_cast<const SDL_Point*>(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(int32_t);
+	#endif
+	int count = NANX_int(info[2]);
+	if ((count < 0) || ((static_cast<size_t>(count) * sizeof(SDL_Point)) > byte_length)) { return Nan::ThrowError("points array too small"); }
+	int err = SDL_RenderDrawLines(renderer, points, count);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_PIXELLAYOUT)
+// extern DECLSPEC int SDLCALL SDL_RenderDrawRect(SDL_Renderer * renderer, const SDL_Rect * rect);
+NANX_EXPORT(SDL_RenderDrawRect)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_PIXELLAYOUT(format)));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	int err = SDL_RenderDrawRect(renderer, rect);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_BITSPERPIXEL)
+// extern DECLSPEC int SDLCALL SDL_RenderDrawRects(SDL_Renderer * renderer, const SDL_Rect * rects, int count);
+// rects is an Int32Array of x, y, w, h quads, read in place
+NANX_EXPORT(SDL_RenderDrawRects)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_BITSPERPIXEL(format)));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsInt32Array()) { return Nan::ThrowError("rects is an Int32Array"); }
+	#endif
+	size_t byte_length = 0;
+	const SDL_Rect* rects = static_cast<const SDL_Rect*>(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(int32_t);
+	#endif
+	int count = NANX_int(info[2]);
+	if ((count < 0) || ((static_cast<size_t>(count) * sizeof(SDL_Rect)) > byte_length)) { return Nan::ThrowError("rects array too small"); }
+	int err = SDL_RenderDrawRects(renderer, rects, count);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_BYTESPERPIXEL)
+// extern DECLSPEC int SDLCALL SDL_RenderFillRect(SDL_Renderer * renderer, const SDL_Rect * rect);
+NANX_EXPORT(SDL_RenderFillRect)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_BYTESPERPIXEL(format)));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	int err = SDL_RenderFillRect(renderer, rect);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_ISPIXELFORMAT_INDEXED)
+// extern DECLSPEC int SDLCALL SDL_RenderFillRects(SDL_Renderer * renderer, const SDL_Rect * rects, int count);
+// rects is an Int32Array of x, y, w, h quads, read in place
+NANX_EXPORT(SDL_RenderFillRects)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_ISPIXELFORMAT_INDEXED(format) != SDL_FALSE));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsInt32Array()) { return Nan::ThrowError("rects is an Int32Array"); }
+	#endif
+	size_t byte_length = 0;
+	const SDL_Rect* rects = static_cast<const SDL_Rect*>(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(int32_t);
+	#endif
+	int count = NANX_int(info[2]);
+	if ((count < 0) || ((static_cast<size_t>(count) * sizeof(SDL_Rect)) > byte_length)) { return Nan::ThrowError("rects array too small"); }
+	int err = SDL_RenderFillRects(renderer, rects, count);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_ISPIXELFORMAT_ALPHA)
+// extern DECLSPEC int SDLCALL SDL_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture, const SDL_Rect * srcrect, const SDL_Rect * dstrect);
+NANX_EXPORT(SDL_RenderCopy)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_ISPIXELFORMAT_ALPHA(format) != SDL_FALSE));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Texture* texture = WrapTexture::Peek(info[1]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_Rect* srcrect = (info[2]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[2]))->GetRect()));
+	SDL_Rect* dstrect = (info[3]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[3]))->GetRect()));
+	int err = SDL_RenderCopy(renderer, texture, srcrect, dstrect);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_ISPIXELFORMAT_FOURCC)
+// extern DECLSPEC int SDLCALL SDL_RenderCopyEx(SDL_Renderer * renderer, SDL_Texture * texture, const SDL_Rect * srcrect, const SDL_Rect * dstrect, const double angle, const SDL_Point *center, const SDL_RendererFlip flip);
+NANX_EXPORT(SDL_RenderCopyEx)
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	info.GetReturnValue().Set(Nan::New(SDL_ISPIXELFORMAT_FOURCC(format) != SDL_FALSE));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Texture* texture = WrapTexture::Peek(info[1]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_Rect* srcrect = (info[2]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[2]))->GetRect()));
+	SDL_Rect* dstrect = (info[3]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[3]))->GetRect()));
+	double angle = NANX_double(info[4]);
+	SDL_Point* center = (info[5]->IsNull())?(NULL):(&(WrapPoint::Unwrap(v8::Local<v8::Object>::Cast(info[5]))->GetPoint()));
+	SDL_RendererFlip flip = static_cast<SDL_RendererFlip>(NANX_int(info[6]));
+	int err = SDL_RenderCopyEx(renderer, texture, srcrect, dstrect, angle, center, flip);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-NANX_EXPORT(SDL_GetPixelFormatName)
-{
-	::Uint32 format = NANX_Uint32(info[0]);
-	const char* name = SDL_GetPixelFormatName(format);
-	info.GetReturnValue().Set(NANX_STRING(name));
-}
+// sprite batch, one native call for many SDL_RenderCopyEx
+// records are SDL_EXT_BATCH_STRIDE floats:
+//   texture index, blend mode (< 0 keeps the texture's), src x, y, w, h (w <= 0 for the whole texture),
+//   dst x, y, w, h, angle, center x, y (NaN for the dst center), flip, color mod r, g, b, alpha mod
+// texture mods are restored after the batch
 
-NANX_EXPORT(SDL_PixelFormatEnumToMasks)
+enum
 {
-	::Uint32 format = NANX_Uint32(info[0]);
-	int bpp = 0;
-	::Uint32 Rmask = 0;
-	::Uint32 Gmask = 0;
-	::Uint32 Bmask = 0;
-	::Uint32 Amask = 0;
-	SDL_bool success = SDL_PixelFormatEnumToMasks(format, &bpp, &Rmask, &Gmask, &Bmask, &Amask);
-	if (info[1]->IsObject())
-	{
-		v8::Local<v8::Object> masks = v8::Local<v8::Object>::Cast(info[1]);
-		masks->Set(NANX_SYMBOL("bpp"), Nan::New(bpp));
-		masks->Set(NANX_SYMBOL("Rmask"), Nan::New(Rmask));
-		masks->Set(NANX_SYMBOL("Gmask"), Nan::New(Gmask));
-		masks->Set(NANX_SYMBOL("Bmask"), Nan::New(Bmask));
-		masks->Set(NANX_SYMBOL("Amask"), Nan::New(Amask));
-	}
-	info.GetReturnValue().Set(Nan::New(success != SDL_FALSE));
-}
+	SDL_EXT_BATCH_STRIDE = 18,
+	SDL_EXT_BATCH_SORT = 0x1 // stable sort by texture and state, changes overlap order
+};
 
-NANX_EXPORT(SDL_MasksToPixelFormatEnum)
+struct _BatchKey
 {
-	int bpp = NANX_int(info[0]);
-	::Uint32 Rmask = NANX_Uint32(info[1]);
-	::Uint32 Gmask = NANX_Uint32(info[2]);
-	::Uint32 Bmask = NANX_Uint32(info[3]);
-	::Uint32 Amask = NANX_Uint32(info[4]);
-	::Uint32 format = SDL_MasksToPixelFormatEnum(bpp, Rmask, Gmask, Bmask, Amask);
-	info.GetReturnValue().Set(Nan::New(format));
-}
+	::Uint64 key;
+	::Uint32 index;
+};
 
-// extern DECLSPEC SDL_PixelFormat * SDLCALL SDL_AllocFormat(Uint32 pixel_format);
-NANX_EXPORT(SDL_AllocFormat)
+static int _BatchKeyCompare(const void* a, const void* b)
 {
-	::Uint32 pixel_format = NANX_Uint32(info[0]);
-	SDL_PixelFormat* format = SDL_AllocFormat(pixel_format);
-	info.GetReturnValue().Set(WrapPixelFormat::Hold(format));
+	const _BatchKey* ka = static_cast<const _BatchKey*>(a);
+	const _BatchKey* kb = static_cast<const _BatchKey*>(b);
+	if (ka->key != kb->key) { return (ka->key < kb->key)?(-1):(1); }
+	return (ka->index < kb->index)?(-1):((ka->index > kb->index)?(1):(0)); // keep it stable
 }
 
-// extern DECLSPEC void SDLCALL SDL_FreeFormat(SDL_PixelFormat *format);
-NANX_EXPORT(SDL_FreeFormat)
+struct _BatchTextureState
 {
-	SDL_PixelFormat* format = WrapPixelFormat::Drop(info[0]); if (!format) { return Nan::ThrowError("null SDL_PixelFormat object"); }
-	SDL_FreeFormat(format); format = NULL;
-}
+	SDL_Texture* texture;
+	_BatchTextureState* owner; // the first index holding the same texture keeps its state
+	bool saved;
+	::Uint8 r, g, b, a;
+	SDL_BlendMode blend;
+	::Uint8 cur_r, cur_g, cur_b, cur_a;
+	SDL_BlendMode cur_blend;
+};
 
-// TODO: extern DECLSPEC SDL_Palette *SDLCALL SDL_AllocPalette(int ncolors);
-// TODO: extern DECLSPEC int SDLCALL SDL_SetPixelFormatPalette(SDL_PixelFormat * format, SDL_Palette *palette);
-// TODO: extern DECLSPEC int SDLCALL SDL_SetPaletteColors(SDL_Palette * palette, const SDL_Color * colors, int firstcolor, int ncolors);
-// TODO: extern DECLSPEC void SDLCALL SDL_FreePalette(SDL_Palette * palette);
+// record fields to integers, NaN and out of range values are clamped, a plain cast of them is undefined
+static inline int _BatchInt(float value) { return (value == value)?(static_cast<int>(SDL_max(-2147483520.0f, SDL_min(value, 2147483520.0f)))):(0); }
+static inline ::Uint8 _BatchByte(float value) { return (value == value)?(static_cast< ::Uint8 >(SDL_max(0.0f, SDL_min(value, 255.0f)))):(0); }
 
-// extern DECLSPEC Uint32 SDLCALL SDL_MapRGB(const SDL_PixelFormat * format, Uint8 r, Uint8 g, Uint8 b);
-NANX_EXPORT(SDL_MapRGB)
+NANX_EXPORT(SDL_EXT_RenderCopyBatch)
 {
-	SDL_PixelFormat* format = WrapPixelFormat::Peek(info[0]); if (!format) { return Nan::ThrowError("null SDL_PixelFormat object"); }
-	::Uint8 r = NANX_Uint8(info[1]);
-	::Uint8 g = NANX_Uint8(info[2]);
-	::Uint8 b = NANX_Uint8(info[3]);
-	::Uint32 pixel = SDL_MapRGB(format, r, g, b);
-	info.GetReturnValue().Set(Nan::New(pixel));
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[2]->IsFloat32Array()) { return Nan::ThrowError("records are a Float32Array"); }
+	#endif
+	size_t byte_length = 0;
+	const float* records = static_cast<const float*>(_TypedArrayData(info[2], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(float);
+	#endif
+	int count = NANX_int(info[3]);
+	int flags = NANX_int(info[4]);
+	if ((count < 0) || (static_cast<size_t>(count) * SDL_EXT_BATCH_STRIDE * sizeof(float) > byte_length)) { return Nan::ThrowError("record array too small"); }
+
+	// one texture, or an array indexed by the records
+	int texture_count = 1;
+	v8::Local<v8::Array> texture_array;
+	if (info[1]->IsArray()) { texture_array = v8::Local<v8::Array>::Cast(info[1]); texture_count = texture_array->Length(); }
+	_BatchTextureState* states = static_cast<_BatchTextureState*>(SDL_calloc(SDL_max(texture_count, 1), sizeof(_BatchTextureState)));
+	_BatchKey* keys = static_cast<_BatchKey*>((flags & SDL_EXT_BATCH_SORT)?(SDL_malloc(SDL_max(count, 1) * sizeof(_BatchKey))):(NULL));
+	if (!states || ((flags & SDL_EXT_BATCH_SORT) && !keys)) { SDL_free(states); SDL_free(keys); return Nan::ThrowError("out of memory"); }
+	for (int i = 0; i < texture_count; ++i)
+	{
+		states[i].texture = (texture_array.IsEmpty())?(WrapTexture::Peek(info[1])):(WrapTexture::Peek(texture_array->Get(i)));
+		states[i].owner = &states[i];
+	}
+	if (texture_count > 1)
+	{
+		// an array may list a texture more than once, its indices share one saved and current state
+		_BatchKey* owners = static_cast<_BatchKey*>(SDL_malloc(texture_count * sizeof(_BatchKey)));
+		if (!owners) { SDL_free(states); SDL_free(keys); return Nan::ThrowError("out of memory"); }
+		for (int i = 0; i < texture_count; ++i)
+		{
+			owners[i].key = static_cast< ::Uint64 >(reinterpret_cast<uintptr_t>(states[i].texture));
+			owners[i].index = i;
+		}
+		qsort(owners, texture_count, sizeof(_BatchKey), _BatchKeyCompare);
+		for (int i = 1; i < texture_count; ++i)
+		{
+			if (owners[i].key == owners[i - 1].key) { states[owners[i].index].owner = states[owners[i - 1].index].owner; }
+		}
+		SDL_free(owners);
+	}
+
+	if (keys)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const float* record = records + i * SDL_EXT_BATCH_STRIDE;
+			::Uint64 texture = static_cast< ::Uint64 >(_BatchInt(record[0]) & 0xffff);
+			::Uint64 blend = static_cast< ::Uint64 >((_BatchInt(record[1]) + 1) & 0xff);
+			::Uint64 mod = (static_cast< ::Uint64 >(_BatchByte(record[14])) << 24) | (_BatchByte(record[15]) << 16) | (_BatchByte(record[16]) << 8) | _BatchByte(record[17]);
+			keys[i].key = (texture << 40) | (blend << 32) | mod;
+			keys[i].index = i;
+		}
+		qsort(keys, count, sizeof(_BatchKey), _BatchKeyCompare);
+	}
+
+	int draws = 0, skipped = 0, errors = 0;
+	int texture_changes = 0, color_mod_changes = 0, alpha_mod_changes = 0, blend_mode_changes = 0;
+	SDL_Texture* last_texture = NULL;
+	for (int n = 0; n < count; ++n)
+	{
+		const float* record = records + ((keys)?(keys[n].index):(n)) * SDL_EXT_BATCH_STRIDE;
+		int texture_index = _BatchInt(record[0]);
+		_BatchTextureState* state = ((texture_index >= 0) && (texture_index < texture_count))?(states[texture_index].owner):(NULL);
+		if (!state || !state->texture) { ++skipped; continue; }
+		if (!state->saved)
+		{
+			SDL_GetTextureColorMod(state->texture, &state->r, &state->g, &state->b);
+			SDL_GetTextureAlphaMod(state->texture, &state->a);
+			SDL_GetTextureBlendMode(state->texture, &state->blend);
+			state->cur_r = state->r; state->cur_g = state->g; state->cur_b = state->b; state->cur_a = state->a; state->cur_blend = state->blend;
+			state->saved = true;
+		}
+		if (state->texture != last_texture) { ++texture_changes; last_texture = state->texture; }
+		::Uint8 r = _BatchByte(record[14]), g = _BatchByte(record[15]), b = _BatchByte(record[16]), a = _BatchByte(record[17]);
+		if ((r != state->cur_r) || (g != state->cur_g) || (b != state->cur_b))
+		{
+			SDL_SetTextureColorMod(state->texture, r, g, b); ++color_mod_changes;
+			state->cur_r = r; state->cur_g = g; state->cur_b = b;
+		}
+		if (a != state->cur_a) { SDL_SetTextureAlphaMod(state->texture, a); ++alpha_mod_changes; state->cur_a = a; }
+		if (record[1] >= 0)
+		{
+			SDL_BlendMode blend = static_cast<SDL_BlendMode>(_BatchInt(record[1]));
+			if (blend != state->cur_blend) { SDL_SetTextureBlendMode(state->texture, blend); ++blend_mode_changes; state->cur_blend = blend; }
+		}
+		SDL_Rect src = { _BatchInt(record[2]), _BatchInt(record[3]), _BatchInt(record[4]), _BatchInt(record[5]) };
+		const SDL_Rect* srcrect = ((src.w > 0) && (src.h > 0))?(&src):(NULL);
+		double angle = record[10];
+		SDL_RendererFlip flip = static_cast<SDL_RendererFlip>(_BatchInt(record[13]) & (SDL_FLIP_HORIZONTAL | SDL_FLIP_VERTICAL));
+		bool has_center = (record[11] == record[11]) && (record[12] == record[12]); // not NaN
+		bool simple = (angle == 0) && (flip == SDL_FLIP_NONE); // plain copy, no rotation setup
+		int err = 0;
+		#if SDL_VERSION_ATLEAST(2, 0, 10)
+		SDL_FRect dst = { record[6], record[7], record[8], record[9] };
+		SDL_FPoint center = { record[11], record[12] };
+		if (simple) { err = SDL_RenderCopyF(renderer, state->texture, srcrect, &dst); }
+		else { err = SDL_RenderCopyExF(renderer, state->texture, srcrect, &dst, angle, (has_center)?(&center):(NULL), flip); }
+		#else
+		SDL_Rect dst = { _BatchInt(record[6]), _BatchInt(record[7]), _BatchInt(record[8]), _BatchInt(record[9]) };
+		SDL_Point center = { _BatchInt(record[11]), _BatchInt(record[12]) };
+		if (simple) { err = SDL_RenderCopy(renderer, state->texture, srcrect, &dst); }
+		else { err = SDL_RenderCopyEx(renderer, state->texture, srcrect, &dst, angle, (has_center)?(&center):(NULL), flip); }
+		#endif
+		if (err < 0) { ++errors; } else { ++draws; }
+	}
+
+	for (int i = 0; i < texture_count; ++i)
+	{
+		_BatchTextureState* state = &states[i];
+		if (!state->saved) { continue; }
+		if ((state->cur_r != state->r) || (state->cur_g != state->g) || (state->cur_b != state->b)) { SDL_SetTextureColorMod(state->texture, state->r, state->g, state->b); }
+		if (state->cur_a != state->a) { SDL_SetTextureAlphaMod(state->texture, state->a); }
+		if (state->cur_blend != state->blend) { SDL_SetTextureBlendMode(state->texture, state->blend); }
+	}
+	SDL_free(states);
+	SDL_free(keys);
+
+	v8::Local<v8::Object> stats = Nan::New<v8::Object>();
+	stats->Set(NANX_SYMBOL("draws"), Nan::New(draws));
+	stats->Set(NANX_SYMBOL("skipped"), Nan::New(skipped));
+	stats->Set(NANX_SYMBOL("errors"), Nan::New(errors));
+	stats->Set(NANX_SYMBOL("textureChanges"), Nan::New(texture_changes));
+	stats->Set(NANX_SYMBOL("colorModChanges"), Nan::New(color_mod_changes));
+	stats->Set(NANX_SYMBOL("alphaModChanges"), Nan::New(alpha_mod_changes));
+	stats->Set(NANX_SYMBOL("blendModeChanges"), Nan::New(blend_mode_changes));
+	info.GetReturnValue().Set(stats);
+}
+
+// render command buffer
+// script writes commands as Int32 words into cb.buffer, then submits them in one call,
+// the same words can be submitted again on later frames
+// each command is an opcode word followed by its arguments:
+//   CLEAR
+//   SET_COLOR r, g, b, a                   SET_BLEND mode
+//   SET_VIEWPORT x, y, w, h                SET_CLIP x, y, w, h (w <= 0 resets either)
+//   POINT x, y                             LINE x1, y1, x2, y2
+//   RECT x, y, w, h                        FILL_RECT x, y, w, h
+//   POINTS count, count * (x, y)           LINES count, count * (x, y)
+//   RECTS count, count * (x, y, w, h)      FILL_RECTS count, count * (x, y, w, h)
+//   COPY slot, src x, y, w, h, dst x, y, w, h (w <= 0 for the whole texture or target)
+//   COPY_EX slot, src x, y, w, h, dst x, y, w, h, angle (float32 bits), flip, has center, center x, y
+//   TEXTURE_COLOR slot, r, g, b            TEXTURE_ALPHA slot, a       TEXTURE_BLEND slot, mode
+
+static const int SDL_EXT_RCMD_CLEAR = 0;
+static const int SDL_EXT_RCMD_SET_COLOR = 1;
+static const int SDL_EXT_RCMD_SET_BLEND = 2;
+static const int SDL_EXT_RCMD_SET_VIEWPORT = 3;
+static const int SDL_EXT_RCMD_SET_CLIP = 4;
+static const int SDL_EXT_RCMD_POINT = 5;
+static const int SDL_EXT_RCMD_LINE = 6;
+static const int SDL_EXT_RCMD_RECT = 7;
+static const int SDL_EXT_RCMD_FILL_RECT = 8;
+static const int SDL_EXT_RCMD_POINTS = 9;
+static const int SDL_EXT_RCMD_LINES = 10;
+static const int SDL_EXT_RCMD_RECTS = 11;
+static const int SDL_EXT_RCMD_FILL_RECTS = 12;
+static const int SDL_EXT_RCMD_COPY = 13;
+static const int SDL_EXT_RCMD_COPY_EX = 14;
+static const int SDL_EXT_RCMD_TEXTURE_COLOR = 15;
+static const int SDL_EXT_RCMD_TEXTURE_ALPHA = 16;
+static const int SDL_EXT_RCMD_TEXTURE_BLEND = 17;
+
+// words used by the command at cmd, or -1 if it is malformed or runs past the end
+static int _RCmdSize(const ::Sint32* cmd, int remaining)
+{
+	static const int fixed[] = { 1, 5, 2, 5, 5, 3, 5, 5, 5, 0, 0, 0, 0, 10, 15, 5, 3, 3 };
+	if (remaining < 1) { return -1; }
+	int op = cmd[0];
+	if ((op < 0) || (op >= static_cast<int>(countof(fixed)))) { return -1; }
+	int size = fixed[op];
+	if (size == 0)
+	{
+		// counted list
+		if (remaining < 2) { return -1; }
+		int count = cmd[1];
+		int stride = ((op == SDL_EXT_RCMD_POINTS) || (op == SDL_EXT_RCMD_LINES))?(2):(4);
+		if ((count < 0) || (count > ((remaining - 2) / stride))) { return -1; }
+		size = 2 + count * stride;
+	}
+	return (size <= remaining)?(size):(-1);
 }
 
-// extern DECLSPEC Uint32 SDLCALL SDL_MapRGBA(const SDL_PixelFormat * format, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
-NANX_EXPORT(SDL_MapRGBA)
+static inline const SDL_Rect* _RCmdRect(const ::Sint32* words)
 {
-	SDL_PixelFormat* format = WrapPixelFormat::Peek(info[0]); if (!format) { return Nan::ThrowError("null SDL_PixelFormat object"); }
-	::Uint8 r = NANX_Uint8(info[1]);
-	::Uint8 g = NANX_Uint8(info[2]);
-	::Uint8 b = NANX_Uint8(info[3]);
-	::Uint8 a = NANX_Uint8(info[4]);
-	::Uint32 pixel = SDL_MapRGBA(format, r, g, b, a);
-	info.GetReturnValue().Set(Nan::New(pixel));
+	return (words[2] > 0)?(reinterpret_cast<const SDL_Rect*>(words)):(NULL);
 }
 
-// TODO: extern DECLSPEC void SDLCALL SDL_GetRGB(Uint32 pixel, const SDL_PixelFormat * format, Uint8 * r, Uint8 * g, Uint8 * b);
-// TODO: extern DECLSPEC void SDLCALL SDL_GetRGBA(Uint32 pixel, const SDL_PixelFormat * format, Uint8 * r, Uint8 * g, Uint8 * b, Uint8 * a);
-// TODO: extern DECLSPEC void SDLCALL SDL_CalculateGammaRamp(float gamma, Uint16 * ramp);
-
-// SDL_platform.h
-
-// extern DECLSPEC const char * SDLCALL SDL_GetPlatform (void);
-NANX_EXPORT(SDL_GetPlatform)
+// replays length words, returns 0 or the last SDL error, -1 with an error set for a malformed buffer
+// frame places a renderer that draws a slice of a larger target: viewports are offset by it, a reset viewport becomes it
+static int _RCmdReplay(SDL_Renderer* renderer, const ::Sint32* words, int length, SDL_Texture* const* textures, int texture_count, const SDL_Rect* frame = NULL)
 {
-	info.GetReturnValue().Set(NANX_STRING(SDL_GetPlatform()));
+	int err = 0;
+	for (int pos = 0; pos < length; )
+	{
+		const ::Sint32* cmd = words + pos;
+		int size = _RCmdSize(cmd, length - pos);
+		if (size < 0) { return SDL_SetError("bad render command at word %d", pos); }
+		pos += size;
+		const ::Sint32* arg = cmd + 1;
+		SDL_Texture* texture = NULL;
+		if ((cmd[0] >= SDL_EXT_RCMD_COPY) && (cmd[0] <= SDL_EXT_RCMD_TEXTURE_BLEND))
+		{
+			texture = ((arg[0] >= 0) && (arg[0] < texture_count))?(textures[arg[0]]):(NULL);
+			if (!texture) { err = SDL_SetError("empty texture slot at word %d", static_cast<int>(cmd - words)); continue; }
+		}
+		int ret = 0;
+		switch (cmd[0])
+		{
+		case SDL_EXT_RCMD_CLEAR: ret = SDL_RenderClear(renderer); break;
+		case SDL_EXT_RCMD_SET_COLOR: ret = SDL_SetRenderDrawColor(renderer, arg[0], arg[1], arg[2], arg[3]); break;
+		case SDL_EXT_RCMD_SET_BLEND: ret = SDL_SetRenderDrawBlendMode(renderer, static_cast<SDL_BlendMode>(arg[0])); break;
+		case SDL_EXT_RCMD_SET_VIEWPORT:
+			if (frame)
+			{
+				SDL_Rect viewport = *frame;
+				if (arg[2] > 0) { viewport.x += arg[0]; viewport.y += arg[1]; viewport.w = arg[2]; viewport.h = arg[3]; }
+				ret = SDL_RenderSetViewport(renderer, &viewport);
+			}
+			else
+			{
+				ret = SDL_RenderSetViewport(renderer, _RCmdRect(arg));
+			}
+			break;
+		case SDL_EXT_RCMD_SET_CLIP: ret = SDL_RenderSetClipRect(renderer, _RCmdRect(arg)); break;
+		case SDL_EXT_RCMD_POINT: ret = SDL_RenderDrawPoint(renderer, arg[0], arg[1]); break;
+		case SDL_EXT_RCMD_LINE: ret = SDL_RenderDrawLine(renderer, arg[0], arg[1], arg[2], arg[3]); break;
+		case SDL_EXT_RCMD_RECT: ret = SDL_RenderDrawRect(renderer, reinterpret_cast<const SDL_Rect*>(arg)); break;
+		case SDL_EXT_RCMD_FILL_RECT: ret = SDL_RenderFillRect(renderer, reinterpret_cast<const SDL_Rect*>(arg)); break;
+		case SDL_EXT_RCMD_POINTS: ret = SDL_RenderDrawPoints(renderer, reinterpret_cast<const SDL_Point*>(arg + 1), arg[0]); break;
+		case SDL_EXT_RCMD_LINES: ret = SDL_RenderDrawLines(renderer, reinterpret_cast<const SDL_Point*>(arg + 1), arg[0]); break;
+		case SDL_EXT_RCMD_RECTS: ret = SDL_RenderDrawRects(renderer, reinterpret_cast<const SDL_Rect*>(arg + 1), arg[0]); break;
+		case SDL_EXT_RCMD_FILL_RECTS: ret = SDL_RenderFillRects(renderer, reinterpret_cast<const SDL_Rect*>(arg + 1), arg[0]); break;
+		case SDL_EXT_RCMD_COPY: ret = SDL_RenderCopy(renderer, texture, _RCmdRect(arg + 1), _RCmdRect(arg + 5)); break;
+		case SDL_EXT_RCMD_COPY_EX:
+		{
+			float angle = 0; SDL_memcpy(&angle, arg + 9, sizeof(angle));
+			SDL_Point center = { arg[12], arg[13] };
+			ret = SDL_RenderCopyEx(renderer, texture, _RCmdRect(arg + 1), _RCmdRect(arg + 5), angle, (arg[11])?(&center):(NULL), static_cast<SDL_RendererFlip>(arg[10]));
+			break;
+		}
+		case SDL_EXT_RCMD_TEXTURE_COLOR: ret = SDL_SetTextureColorMod(texture, arg[1], arg[2], arg[3]); break;
+		case SDL_EXT_RCMD_TEXTURE_ALPHA: ret = SDL_SetTextureAlphaMod(texture, arg[1]); break;
+		case SDL_EXT_RCMD_TEXTURE_BLEND: ret = SDL_SetTextureBlendMode(texture, static_cast<SDL_BlendMode>(arg[1])); break;
+		}
+		if (ret < 0) { err = ret; }
+	}
+	return err;
 }
 
-// SDL_power.h
+class RenderCommandBuffer
+{
+	public: int m_capacity; // words
+	public: int m_texture_count;
+	public: Nan::Persistent<v8::Object> m_buffer; // ArrayBuffer shared with script
+	public: Nan::Persistent<v8::Value>* m_textures;
+	public: RenderCommandBuffer(int capacity, int texture_count) :
+		m_capacity(capacity), m_texture_count(texture_count), m_textures(new Nan::Persistent<v8::Value>[texture_count])
+	{
+	}
+	public: ~RenderCommandBuffer()
+	{
+		for (int i = 0; i < m_texture_count; ++i) { m_textures[i].Reset(); }
+		delete[] m_textures; m_textures = NULL;
+		m_buffer.Reset();
+	}
+};
 
-// extern DECLSPEC SDL_PowerState SDLCALL SDL_GetPowerInfo(int *secs, int *pct);
-NANX_EXPORT(SDL_GetPowerInfo)
+class WrapRenderCommandBuffer : public Nan::ObjectWrap
 {
-	int secs = 0;
-	int pct = 0;
-	SDL_PowerState power_state = SDL_GetPowerInfo(&secs, &pct);
-	if (info[1]->IsObject())
+private:
+	RenderCommandBuffer* m_command_buffer;
+public:
+	WrapRenderCommandBuffer(RenderCommandBuffer* command_buffer) : m_command_buffer(command_buffer) {}
+	~WrapRenderCommandBuffer() { Free(m_command_buffer); m_command_buffer = NULL; }
+public:
+	RenderCommandBuffer* Peek() { return m_command_buffer; }
+	RenderCommandBuffer* Drop() { RenderCommandBuffer* command_buffer = m_command_buffer; m_command_buffer = NULL; return command_buffer; }
+public:
+	static WrapRenderCommandBuffer* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
+	static WrapRenderCommandBuffer* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapRenderCommandBuffer>(object); }
+	static RenderCommandBuffer* Peek(v8::Local<v8::Value> value) { WrapRenderCommandBuffer* wrap = Unwrap(value); return (wrap)?(wrap->Peek()):(NULL); }
+public:
+	static v8::Local<v8::Value> Hold(RenderCommandBuffer* command_buffer) { return NewInstance(command_buffer); }
+	static RenderCommandBuffer* Drop(v8::Local<v8::Value> value) { WrapRenderCommandBuffer* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
+	static void Free(RenderCommandBuffer* command_buffer)
 	{
-		// var info = { secs: -1, pct: -1 };
-		// var power_state = sdl.SDL_GetPowerInfo(info);
-		v8::Local<v8::Object> _info = v8::Local<v8::Object>::Cast(info[1]);
-		_info->Set(NANX_SYMBOL("secs"), Nan::New(secs));
-		_info->Set(NANX_SYMBOL("pct"), Nan::New(pct));
+		if (command_buffer) { delete command_buffer; command_buffer = NULL; }
 	}
-	else
+public:
+	static v8::Local<v8::Object> NewInstance(RenderCommandBuffer* command_buffer)
 	{
-		// var a_secs = [ -1 ];
-		// var a_pct = [ -1 ];
-		// var power_state = sdl.SDL_GetPowerInfo(a_secs, a_pct);
-		// var secs = a_secs[0];
-		// var pct = a_pcs[0];
-		if (info[1]->IsArray())
-		{
-			v8::Local<v8::Object> a = v8::Local<v8::Object>::Cast(info[1]);
-			a->Set(0, Nan::New(secs));
-		}
-		if (info[2]->IsArray())
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::ObjectTemplate> object_template = GetObjectTemplate();
+		v8::Local<v8::Object> instance = object_template->NewInstance();
+		WrapRenderCommandBuffer* wrap = new WrapRenderCommandBuffer(command_buffer);
+		wrap->Wrap(instance);
+		return scope.Escape(instance);
+	}
+private:
+	static v8::Local<v8::ObjectTemplate> GetObjectTemplate()
+	{
+		Nan::EscapableHandleScope scope;
+		static Nan::Persistent<v8::ObjectTemplate> g_object_template;
+		if (g_object_template.IsEmpty())
 		{
-			v8::Local<v8::Object> a = v8::Local<v8::Object>::Cast(info[2]);
-			a->Set(0, Nan::New(pct));
+			v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>();
+			g_object_template.Reset(object_template);
+			object_template->SetInternalFieldCount(1);
 		}
+		v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>(g_object_template);
+		return scope.Escape(object_template);
 	}
-	info.GetReturnValue().Set(Nan::New(power_state));
+};
+
+NANX_EXPORT(SDL_EXT_CreateRenderCommandBuffer)
+{
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	int capacity = SDL_max(0, NANX_int(info[0])); // words
+	int texture_count = SDL_min(SDL_max(0, NANX_int(info[1])), 256);
+	RenderCommandBuffer* command_buffer = new RenderCommandBuffer(capacity, texture_count);
+	v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), capacity * sizeof(::Sint32));
+	command_buffer->m_buffer.Reset(buffer);
+	v8::Local<v8::Object> instance = v8::Local<v8::Object>::Cast(WrapRenderCommandBuffer::Hold(command_buffer));
+	instance->Set(NANX_SYMBOL("buffer"), buffer);
+	info.GetReturnValue().Set(instance);
+	#else
+	return Nan::ThrowError("SDL_EXT_CreateRenderCommandBuffer needs node 4 or later");
+	#endif
 }
 
-// SDL_quit.h
+NANX_EXPORT(SDL_EXT_DestroyRenderCommandBuffer)
+{
+	RenderCommandBuffer* command_buffer = WrapRenderCommandBuffer::Drop(info[0]); if (!command_buffer) { return Nan::ThrowError("null RenderCommandBuffer object"); }
+	WrapRenderCommandBuffer::Free(command_buffer);
+}
 
-NANX_EXPORT(SDL_QuitRequested)
+NANX_EXPORT(SDL_EXT_RenderCommandBufferSetTexture)
 {
-	info.GetReturnValue().Set(Nan::New(SDL_QuitRequested() != SDL_FALSE));
+	RenderCommandBuffer* command_buffer = WrapRenderCommandBuffer::Peek(info[0]); if (!command_buffer) { return Nan::ThrowError("null RenderCommandBuffer object"); }
+	int slot = NANX_int(info[1]);
+	if ((slot < 0) || (slot >= command_buffer->m_texture_count)) { return Nan::ThrowError("texture slot out of range"); }
+	if (info[2]->IsNull() || info[2]->IsUndefined()) { command_buffer->m_textures[slot].Reset(); }
+	else { command_buffer->m_textures[slot].Reset(info[2]); }
 }
 
-// SDL_rect.h
+// the words to replay and the textures bound to the slots, textures has room for 256, the cap at creation
+static const ::Sint32* _RenderCommandBufferWords(RenderCommandBuffer* command_buffer, int length, SDL_Texture** textures)
+{
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	v8::Local<v8::ArrayBuffer> buffer = v8::Local<v8::ArrayBuffer>::Cast(Nan::New<v8::Object>(command_buffer->m_buffer));
+	if (buffer->ByteLength() < (length * sizeof(::Sint32))) { SDL_SetError("command buffer detached"); return NULL; }
+	for (int i = 0; i < command_buffer->m_texture_count; ++i)
+	{
+		textures[i] = (command_buffer->m_textures[i].IsEmpty())?(NULL):(WrapTexture::Peek(Nan::New<v8::Value>(command_buffer->m_textures[i])));
+	}
+	return static_cast<const ::Sint32*>(buffer->GetContents().Data());
+	#else
+	SDL_Unsupported();
+	return NULL;
+	#endif
+}
 
-// SDL_FORCE_INLINE SDL_bool SDL_RectEmpty(const SDL_Rect *r)
-NANX_EXPORT(SDL_RectEmpty)
+// replays the first length words of the buffer with its texture slots
+static int _RenderCommandBufferSubmit(RenderCommandBuffer* command_buffer, SDL_Renderer* renderer, int length)
 {
-	WrapRect* r = WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[0]));
-	info.GetReturnValue().Set(Nan::New(SDL_RectEmpty(&r->GetRect()) != SDL_FALSE));
+	SDL_Texture* textures[256];
+	const ::Sint32* words = _RenderCommandBufferWords(command_buffer, length, textures);
+	if (!words) { return -1; }
+	return _RCmdReplay(renderer, words, length, textures, command_buffer->m_texture_count);
 }
 
-// SDL_FORCE_INLINE SDL_bool SDL_RectEquals(const SDL_Rect *a, const SDL_Rect *b)
-NANX_EXPORT(SDL_RectEquals)
+NANX_EXPORT(SDL_EXT_RenderCommandBufferSubmit)
 {
-	WrapRect* a = WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[0]));
-	WrapRect* b = WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]));
-	info.GetReturnValue().Set(Nan::New(SDL_RectEquals(&a->GetRect(), &b->GetRect()) != SDL_FALSE));
+	RenderCommandBuffer* command_buffer = WrapRenderCommandBuffer::Peek(info[0]); if (!command_buffer) { return Nan::ThrowError("null RenderCommandBuffer object"); }
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[1]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	int length = NANX_int(info[2]);
+	if ((length < 0) || (length > command_buffer->m_capacity)) { return Nan::ThrowError("command length out of range"); }
+	int err = _RenderCommandBufferSubmit(command_buffer, renderer, length);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_HasIntersection(const SDL_Rect * A, const SDL_Rect * B);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_IntersectRect(const SDL_Rect * A, const SDL_Rect * B, SDL_Rect * result);
-// TODO: extern DECLSPEC void SDLCALL SDL_UnionRect(const SDL_Rect * A, const SDL_Rect * B, SDL_Rect * result);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_EnclosePoints(const SDL_Point * points, int count, const SDL_Rect * clip, SDL_Rect * result);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_IntersectRectAndLine(const SDL_Rect *rect, int *X1, int *Y1, int *X2, int *Y2);
+// tiled software replay
+// the target surface is split into horizontal bands, each drawn by its own software renderer
+// over a view of the band's rows, and the bands replay the command stream in parallel
+// clears, points and filled rects touch each pixel independently so the result matches serial
+// replay exactly, lines, outlines and texture commands are clipped differently per band and
+// run serially on the caller's renderer between the parallel runs
+// bench/tiled.js checks the result against SDL_EXT_RenderCommandBufferSubmit pixel for pixel
+
+struct RenderBand
+{
+	SDL_Surface* surface; // view of the band rows
+	SDL_Renderer* renderer;
+	SDL_Rect frame; // whole surface in band coordinates
+	const ::Sint32* words;
+	int length;
+	int err;
+};
+
+// band renderers for the last few targets, views over the same pixels with the same layout are reused
+// they only view the pixels, so an entry that outlives its surface is never drawn through unless
+// a new surface has the very same pixels and layout, when the views are valid again
+class RenderBandCache
+{
+	private: static const int MAX_TARGETS = 4;
+	private: struct Target
+	{
+		void* pixels;
+		int w, h, pitch;
+		::Uint32 format;
+		int band_count;
+		unsigned int used;
+		RenderBand bands[ForkJoinPool::MAX_WIDTH];
+	};
+	private: static Target s_targets[MAX_TARGETS];
+	private: static unsigned int s_clock;
+	public: static RenderBand* Acquire(SDL_Surface* surface, int band_count)
+	{
+		Target* target = &s_targets[0];
+		for (int i = 0; i < MAX_TARGETS; ++i)
+		{
+			Target& t = s_targets[i];
+			if ((t.band_count == band_count) && (t.pixels == surface->pixels) && (t.w == surface->w) && (t.h == surface->h) &&
+				(t.pitch == surface->pitch) && (t.format == surface->format->format))
+			{
+				t.used = ++s_clock;
+				return t.bands;
+			}
+			if (t.used < target->used) { target = &t; } // least recently used
+		}
+		Release(*target);
+		int band_h = (surface->h + band_count - 1) / band_count;
+		SDL_PixelFormat* format = surface->format;
+		for (int i = 0; i < band_count; ++i)
+		{
+			RenderBand& band = target->bands[i];
+			int y0 = i * band_h;
+			int h = SDL_min(band_h, surface->h - y0);
+			band.surface = SDL_CreateRGBSurfaceFrom(static_cast<char*>(surface->pixels) + y0 * surface->pitch, surface->w, h, format->BitsPerPixel, surface->pitch, format->Rmask, format->Gmask, format->Bmask, format->Amask);
+			band.renderer = (band.surface)?(SDL_CreateSoftwareRenderer(band.surface)):(NULL);
+			SDL_Rect frame = { 0, -y0, surface->w, surface->h };
+			band.frame = frame;
+			target->band_count = i + 1;
+			if (!band.renderer) { Release(*target); return NULL; }
+		}
+		target->pixels = surface->pixels; target->w = surface->w; target->h = surface->h;
+		target->pitch = surface->pitch; target->format = format->format;
+		target->used = ++s_clock;
+		return target->bands;
+	}
+	public: static void Trim()
+	{
+		for (int i = 0; i < MAX_TARGETS; ++i) { Release(s_targets[i]); }
+	}
+	private: static void Release(Target& target)
+	{
+		for (int i = 0; i < target.band_count; ++i)
+		{
+			if (target.bands[i].renderer) { SDL_DestroyRenderer(target.bands[i].renderer); }
+			if (target.bands[i].surface) { SDL_FreeSurface(target.bands[i].surface); }
+		}
+		SDL_zero(target);
+	}
+};
 
-// SDL_render.h
+RenderBandCache::Target RenderBandCache::s_targets[RenderBandCache::MAX_TARGETS];
+unsigned int RenderBandCache::s_clock = 0;
 
-// TODO: extern DECLSPEC int SDLCALL SDL_GetNumRenderDrivers(void);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetRenderDriverInfo(int index, SDL_RendererInfo * info);
-// TODO: extern DECLSPEC int SDLCALL SDL_CreateWindowAndRenderer(int width, int height, Uint32 window_flags, SDL_Window **window, SDL_Renderer **renderer);
+// the band renderers and surfaces are SDL objects, free them before SDL goes
+static void _RenderBandCacheTrim()
+{
+	RenderBandCache::Trim();
+}
 
-// extern DECLSPEC SDL_Renderer * SDLCALL SDL_CreateRenderer(SDL_Window * window,
-NANX_EXPORT(SDL_CreateRenderer)
+static void _RenderBandJob(void* data, int index)
 {
-	SDL_Window* window = WrapWindow::Peek(info[0]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
-	int index = NANX_int(info[1]);
-	::Uint32 flags = NANX_Uint32(info[2]);
-	SDL_Renderer* renderer = SDL_CreateRenderer(window, index, flags);
-	info.GetReturnValue().Set(WrapRenderer::Hold(renderer));
+	RenderBand* band = static_cast<RenderBand*>(data) + index;
+	band->err = _RCmdReplay(band->renderer, band->words, band->length, NULL, 0, &band->frame);
+	#if SDL_VERSION_ATLEAST(2, 0, 10)
+	if (SDL_RenderFlush(band->renderer) < 0) { band->err = -1; }
+	#endif
 }
 
-// extern DECLSPEC SDL_Renderer * SDLCALL SDL_CreateSoftwareRenderer(SDL_Surface * surface);
-NANX_EXPORT(SDL_CreateSoftwareRenderer)
+static bool _RCmdIsState(int op)
 {
-	SDL_Surface* surface = WrapSurface::Peek(info[0]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
-	SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(surface);
-	info.GetReturnValue().Set(WrapRenderer::Hold(renderer));
+	return (op == SDL_EXT_RCMD_SET_COLOR) || (op == SDL_EXT_RCMD_SET_BLEND) || (op == SDL_EXT_RCMD_SET_VIEWPORT) || (op == SDL_EXT_RCMD_SET_CLIP);
 }
 
-// TODO: extern DECLSPEC SDL_Renderer * SDLCALL SDL_GetRenderer(SDL_Window * window);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetRendererInfo(SDL_Renderer * renderer, SDL_RendererInfo * info);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetRendererOutputSize(SDL_Renderer * renderer, int *w, int *h);
-// TODO: extern DECLSPEC SDL_Texture * SDLCALL SDL_CreateTexture(SDL_Renderer * renderer, Uint32 format, int access, int w, int h);
-// TODO: extern DECLSPEC SDL_Texture * SDLCALL SDL_CreateTextureFromSurface(SDL_Renderer * renderer, SDL_Surface * surface);
-// TODO: extern DECLSPEC int SDLCALL SDL_QueryTexture(SDL_Texture * texture, Uint32 * format, int *access, int *w, int *h);
-// TODO: extern DECLSPEC int SDLCALL SDL_SetTextureColorMod(SDL_Texture * texture, Uint8 r, Uint8 g, Uint8 b);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetTextureColorMod(SDL_Texture * texture, Uint8 * r, Uint8 * g, Uint8 * b);
-// TODO: extern DECLSPEC int SDLCALL SDL_SetTextureAlphaMod(SDL_Texture * texture, Uint8 alpha);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetTextureAlphaMod(SDL_Texture * texture, Uint8 * alpha);
-// TODO: extern DECLSPEC int SDLCALL SDL_SetTextureBlendMode(SDL_Texture * texture, SDL_BlendMode blendMode);
-// TODO: extern DECLSPEC int SDLCALL SDL_GetTextureBlendMode(SDL_Texture * texture, SDL_BlendMode *blendMode);
-// TODO: extern DECLSPEC int SDLCALL SDL_UpdateTexture(SDL_Texture * texture, const SDL_Rect * rect, const void *pixels, int pitch);
-// TODO: extern DECLSPEC int SDLCALL SDL_UpdateYUVTexture(SDL_Texture * texture, const SDL_Rect * rect, const Uint8 *Yplane, int Ypitch, const Uint8 *Uplane, int Upitch, const Uint8 *Vplane, int Vpitch);
-// TODO: extern DECLSPEC int SDLCALL SDL_LockTexture(SDL_Texture * texture, const SDL_Rect * rect, void **pixels, int *pitch);
-// TODO: extern DECLSPEC void SDLCALL SDL_UnlockTexture(SDL_Texture * texture);
+static bool _RCmdIsBandLocal(int op)
+{
+	return (op == SDL_EXT_RCMD_CLEAR) || (op == SDL_EXT_RCMD_POINT) || (op == SDL_EXT_RCMD_POINTS) || (op == SDL_EXT_RCMD_FILL_RECT) || (op == SDL_EXT_RCMD_FILL_RECTS);
+}
 
-// extern DECLSPEC SDL_bool SDLCALL SDL_RenderTargetSupported(SDL_Renderer *renderer);
-NANX_EXPORT(SDL_RenderTargetSupported)
+// renderer must be a software renderer drawing into surface, returns 0 or the last error
+static int _RenderCommandBufferSubmitTiled(RenderCommandBuffer* command_buffer, SDL_Renderer* renderer, SDL_Surface* surface, int length, int band_count)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	SDL_bool supported = SDL_RenderTargetSupported(renderer);
-	info.GetReturnValue().Set(Nan::New(supported != SDL_FALSE));
+	float scale_x = 1, scale_y = 1; SDL_RenderGetScale(renderer, &scale_x, &scale_y);
+	int logical_w = 0, logical_h = 0; SDL_RenderGetLogicalSize(renderer, &logical_w, &logical_h);
+	band_count = SDL_min(band_count, surface->h / 16); // keep bands tall enough to be worth a thread
+	if ((band_count < 2) || SDL_GetRenderTarget(renderer) || (scale_x != 1) || (scale_y != 1) || (logical_w != 0) ||
+		SDL_MUSTLOCK(surface) || SDL_ISPIXELFORMAT_INDEXED(surface->format->format))
+	{
+		return _RenderCommandBufferSubmit(command_buffer, renderer, length); // nothing to split
+	}
+	SDL_Texture* textures[256];
+	int texture_count = command_buffer->m_texture_count;
+	const ::Sint32* words = _RenderCommandBufferWords(command_buffer, length, textures);
+	if (!words) { return -1; }
+	#if SDL_VERSION_ATLEAST(2, 0, 10)
+	SDL_RenderFlush(renderer); // earlier draws land first
+	#endif
+
+	// band renderers start from the caller's state
+	::Uint8 r = 0, g = 0, b = 0, a = 0; SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+	SDL_BlendMode blend = SDL_BLENDMODE_NONE; SDL_GetRenderDrawBlendMode(renderer, &blend);
+	SDL_Rect viewport; SDL_RenderGetViewport(renderer, &viewport);
+	SDL_Rect clip; SDL_RenderGetClipRect(renderer, &clip);
+	#if SDL_VERSION_ATLEAST(2, 0, 4)
+	bool clip_enabled = (SDL_RenderIsClipEnabled(renderer) == SDL_TRUE); // an empty clip rect still clips everything
+	#else
+	bool clip_enabled = (clip.w > 0);
+	#endif
+	band_count = SDL_min(band_count, static_cast<int>(ForkJoinPool::MAX_WIDTH));
+	RenderBand* bands = RenderBandCache::Acquire(surface, band_count);
+	if (!bands) { return -1; }
+	int err = 0;
+	for (int i = 0; i < band_count; ++i)
+	{
+		RenderBand& band = bands[i];
+		SDL_Rect band_viewport = { viewport.x, viewport.y + band.frame.y, viewport.w, viewport.h };
+		SDL_SetRenderDrawColor(band.renderer, r, g, b, a);
+		SDL_SetRenderDrawBlendMode(band.renderer, blend);
+		SDL_RenderSetViewport(band.renderer, &band_viewport);
+		SDL_RenderSetClipRect(band.renderer, (clip_enabled)?(&clip):(NULL));
+	}
+
+	// state goes to every renderer, band local draws to the bands, everything else to the caller's renderer alone
+	int run_start = 0;
+	bool run_draws = false;
+	for (int pos = 0; (err == 0) && (pos <= length); )
+	{
+		const ::Sint32* cmd = words + pos;
+		int size = (pos < length)?(_RCmdSize(cmd, length - pos)):(0);
+		if (size < 0) { err = SDL_SetError("bad render command at word %d", pos); break; }
+		bool barrier = (pos == length) || (!_RCmdIsState(cmd[0]) && !_RCmdIsBandLocal(cmd[0]));
+		if (barrier && run_draws)
+		{
+			for (int i = 0; i < band_count; ++i) { bands[i].words = words + run_start; bands[i].length = pos - run_start; bands[i].err = 0; }
+			ForkJoinPool::Instance().Run(_RenderBandJob, bands, band_count);
+			for (int i = 0; i < band_count; ++i) { if (bands[i].err < 0) { err = bands[i].err; } }
+		}
+		else if (barrier && (pos > run_start))
+		{
+			// state only, cheap enough to apply here
+			for (int i = 0; i < band_count; ++i) { _RCmdReplay(bands[i].renderer, words + run_start, pos - run_start, NULL, 0, &bands[i].frame); }
+		}
+		if (barrier) { run_start = pos + size; run_draws = false; }
+		if (pos == length) { break; }
+		if (barrier || _RCmdIsState(cmd[0]))
+		{
+			int ret = _RCmdReplay(renderer, cmd, size, textures, texture_count);
+			if (ret < 0) { err = ret; }
+			#if SDL_VERSION_ATLEAST(2, 0, 10)
+			if (barrier) { SDL_RenderFlush(renderer); } // lands before the next parallel run
+			#endif
+		}
+		else
+		{
+			run_draws = true;
+		}
+		pos += size;
+	}
+	return err;
+}
+
+// replays like SDL_EXT_RenderCommandBufferSubmit with the fill work split across cores
+// renderer must come from SDL_CreateSoftwareRenderer(surface), bands defaults to one per core
+NANX_EXPORT(SDL_EXT_RenderCommandBufferSubmitTiled)
+{
+	RenderCommandBuffer* command_buffer = WrapRenderCommandBuffer::Peek(info[0]); if (!command_buffer) { return Nan::ThrowError("null RenderCommandBuffer object"); }
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[1]);
+	SDL_Renderer* renderer = (wrap)?(wrap->Peek()):(NULL); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Surface* surface = WrapSurface::Peek(info[2]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
+	const SDL_RendererInfo* renderer_info = wrap->GetInfo();
+	if (!renderer_info || !(renderer_info->flags & SDL_RENDERER_SOFTWARE)) { return Nan::ThrowError("tiled submit needs a software renderer"); }
+	int output_w = 0, output_h = 0; SDL_GetRendererOutputSize(renderer, &output_w, &output_h);
+	if (!SDL_GetRenderTarget(renderer) && ((output_w != surface->w) || (output_h != surface->h))) { return Nan::ThrowError("surface is not the renderer's target"); }
+	int length = NANX_int(info[3]);
+	if ((length < 0) || (length > command_buffer->m_capacity)) { return Nan::ThrowError("command length out of range"); }
+	int band_count = (info[4]->IsNumber())?(NANX_int(info[4])):(ForkJoinPool::Instance().GetWidth());
+	int err = _RenderCommandBufferSubmitTiled(command_buffer, renderer, surface, length, band_count);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// TODO: extern DECLSPEC int SDLCALL SDL_SetRenderTarget(SDL_Renderer *renderer, SDL_Texture *texture);
-// TODO: extern DECLSPEC SDL_Texture * SDLCALL SDL_GetRenderTarget(SDL_Renderer *renderer);
+// render layers
+// a layer is a target texture drawn once and composited with one copy per frame,
+// it is redrawn only when marked dirty or after the renderer lost its target contents
 
-// extern DECLSPEC int SDLCALL SDL_RenderSetLogicalSize(SDL_Renderer * renderer, int w, int h);
-NANX_EXPORT(SDL_RenderSetLogicalSize)
+NANX_EXPORT(SDL_EXT_CreateRenderLayer)
 {
 	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
 	int w = NANX_int(info[1]);
 	int h = NANX_int(info[2]);
-	int err = SDL_RenderSetLogicalSize(renderer, w, h);
-	info.GetReturnValue().Set(Nan::New(err));
+	SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+	if (!texture) { return info.GetReturnValue().SetNull(); }
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	info.GetReturnValue().Set(WrapTexture::Hold(texture, info[0]));
 }
 
-// TODO: extern DECLSPEC void SDLCALL SDL_RenderGetLogicalSize(SDL_Renderer * renderer, int *w, int *h);
-#if SDL_VERSION_ATLEAST(2, 0, 5)
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderSetIntegerScale(SDL_Renderer * renderer, SDL_bool enable);
-// TODO: extern DECLSPEC SDL_bool SDLCALL SDL_RenderGetIntegerScale(SDL_Renderer * renderer);
-#endif
-
-// extern DECLSPEC int SDLCALL SDL_RenderSetViewport(SDL_Renderer * renderer, const SDL_Rect * rect);
-NANX_EXPORT(SDL_RenderSetViewport)
+NANX_EXPORT(SDL_EXT_RenderLayerIsDirty)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
-	int err = SDL_RenderSetViewport(renderer, rect);
-	info.GetReturnValue().Set(Nan::New(err));
+	WrapTexture* layer = WrapTexture::Unwrap(info[0]); if (!layer || !layer->Peek()) { return Nan::ThrowError("null SDL_Texture object"); }
+	info.GetReturnValue().Set(Nan::New(layer->IsDirty()));
 }
 
-// extern DECLSPEC void SDLCALL SDL_RenderGetViewport(SDL_Renderer * renderer, SDL_Rect * rect);
-NANX_EXPORT(SDL_RenderGetViewport)
+NANX_EXPORT(SDL_EXT_RenderLayerInvalidate)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
-	SDL_RenderGetViewport(renderer, rect);
+	WrapTexture* layer = WrapTexture::Unwrap(info[0]); if (!layer || !layer->Peek()) { return Nan::ThrowError("null SDL_Texture object"); }
+	layer->SetDirty();
 }
 
-// extern DECLSPEC int SDLCALL SDL_RenderSetClipRect(SDL_Renderer * renderer, const SDL_Rect * rect);
-NANX_EXPORT(SDL_RenderSetClipRect)
+NANX_EXPORT(SDL_EXT_RenderInvalidateLayers)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
-	int err = SDL_RenderSetClipRect(renderer, rect);
-	info.GetReturnValue().Set(Nan::New(err));
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[0]); if (!wrap || !wrap->Peek()) { return Nan::ThrowError("null SDL_Renderer object"); }
+	wrap->InvalidateLayers();
 }
 
-// extern DECLSPEC void SDLCALL SDL_RenderGetClipRect(SDL_Renderer * renderer, SDL_Rect * rect);
-NANX_EXPORT(SDL_RenderGetClipRect)
+// targets the layer and clears it to transparent, drawing goes into the layer until SDL_EXT_RenderLayerEnd
+// layers nest up to WrapRenderer::MAX_LAYER_DEPTH deep, each end restores the target its begin replaced
+static int _RenderLayerBegin(WrapRenderer* wrap, WrapTexture* layer)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
-	SDL_RenderGetClipRect(renderer, rect);
+	SDL_Renderer* renderer = wrap->Peek();
+	if (wrap->GetLayerDepth() >= WrapRenderer::MAX_LAYER_DEPTH) { return SDL_SetError("layers nested too deep"); }
+	SDL_Texture* restore = SDL_GetRenderTarget(renderer);
+	int err = SDL_SetRenderTarget(renderer, layer->Peek());
+	if (err < 0) { return err; }
+	wrap->PushLayer(layer->Peek(), restore);
+	::Uint8 r = 0, g = 0, b = 0, a = 0;
+	SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	err = SDL_RenderClear(renderer);
+	SDL_SetRenderDrawColor(renderer, r, g, b, a);
+	return err;
 }
 
-// extern DECLSPEC int SDLCALL SDL_RenderSetScale(SDL_Renderer * renderer, float scaleX, float scaleY);
-NANX_EXPORT(SDL_RenderSetScale)
+// restores the previous target and marks the layer clean
+static int _RenderLayerEnd(WrapRenderer* wrap)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	float scaleX = NANX_float(info[1]);
-	float scaleY = NANX_float(info[2]);
-	int err = SDL_RenderSetScale(renderer, scaleX, scaleY);
-	info.GetReturnValue().Set(Nan::New(err));
+	SDL_Renderer* renderer = wrap->Peek();
+	SDL_Texture* layer_texture = NULL;
+	SDL_Texture* restore_texture = NULL;
+	if (!wrap->PopLayer(&layer_texture, &restore_texture)) { return SDL_SetError("no layer begun"); }
+	WrapTexture* layer = wrap->FindTexture(layer_texture); // either may have been destroyed meanwhile
+	if (layer) { layer->SetClean(); }
+	WrapTexture* restore = wrap->FindTexture(restore_texture);
+	return SDL_SetRenderTarget(renderer, (restore)?(restore->Peek()):(NULL));
 }
 
-// TODO: extern DECLSPEC void SDLCALL SDL_RenderGetScale(SDL_Renderer * renderer, float *scaleX, float *scaleY);
-
-// extern DECLSPEC int SDL_SetRenderDrawColor(SDL_Renderer * renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
-NANX_EXPORT(SDL_SetRenderDrawColor)
+NANX_EXPORT(SDL_EXT_RenderLayerBegin)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	::Uint8 r = NANX_Uint8(info[1]);
-	::Uint8 g = NANX_Uint8(info[2]);
-	::Uint8 b = NANX_Uint8(info[3]);
-	::Uint8 a = NANX_Uint8(info[4]);
-	int err = SDL_SetRenderDrawColor(renderer, r, g, b, a);
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[0]); if (!wrap || !wrap->Peek()) { return Nan::ThrowError("null SDL_Renderer object"); }
+	WrapTexture* layer = WrapTexture::Unwrap(info[1]); if (!layer || !layer->Peek()) { return Nan::ThrowError("null SDL_Texture object"); }
+	if (wrap->GetLayerDepth() >= WrapRenderer::MAX_LAYER_DEPTH) { return Nan::ThrowError("layers nested too deep"); }
+	int err = _RenderLayerBegin(wrap, layer);
 	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// TODO: extern DECLSPEC int SDL_GetRenderDrawColor(SDL_Renderer * renderer, Uint8 * r, Uint8 * g, Uint8 * b, Uint8 * a);
-
-// extern DECLSPEC int SDLCALL SDL_SetRenderDrawBlendMode(SDL_Renderer * renderer, SDL_BlendMode blendMode);
-NANX_EXPORT(SDL_SetRenderDrawBlendMode)
+NANX_EXPORT(SDL_EXT_RenderLayerEnd)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	SDL_BlendMode mode = NANX_SDL_BlendMode(info[1]);
-	int err = SDL_SetRenderDrawBlendMode(renderer, mode);
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[0]); if (!wrap || !wrap->Peek()) { return Nan::ThrowError("null SDL_Renderer object"); }
+	if (wrap->GetLayerDepth() <= 0) { return Nan::ThrowError("SDL_EXT_RenderLayerEnd without SDL_EXT_RenderLayerBegin"); }
+	int err = _RenderLayerEnd(wrap);
 	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// TODO: extern DECLSPEC int SDLCALL SDL_GetRenderDrawBlendMode(SDL_Renderer * renderer, SDL_BlendMode *blendMode);
-
-// extern DECLSPEC int SDLCALL SDL_RenderClear(SDL_Renderer * renderer);
-NANX_EXPORT(SDL_RenderClear)
+// redraws the layer from a command buffer only when it is dirty
+// returns 1 when redrawn, 0 when the cached content is still valid, or an error
+NANX_EXPORT(SDL_EXT_RenderLayerUpdate)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	int err = SDL_RenderClear(renderer);
-	info.GetReturnValue().Set(Nan::New(err));
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[0]); if (!wrap || !wrap->Peek()) { return Nan::ThrowError("null SDL_Renderer object"); }
+	WrapTexture* layer = WrapTexture::Unwrap(info[1]); if (!layer || !layer->Peek()) { return Nan::ThrowError("null SDL_Texture object"); }
+	RenderCommandBuffer* command_buffer = WrapRenderCommandBuffer::Peek(info[2]); if (!command_buffer) { return Nan::ThrowError("null RenderCommandBuffer object"); }
+	int length = NANX_int(info[3]);
+	if ((length < 0) || (length > command_buffer->m_capacity)) { return Nan::ThrowError("command length out of range"); }
+	// a reset still queued has already lost the layer, it is only counted once the event is converted
+	#if SDL_VERSION_ATLEAST(2,0,4)
+	bool reset_pending = (SDL_HasEvents(SDL_RENDER_TARGETS_RESET, SDL_RENDER_DEVICE_RESET) == SDL_TRUE);
+	#else
+	bool reset_pending = false;
+	#endif
+	if (!layer->IsDirty() && !reset_pending) { return info.GetReturnValue().Set(Nan::New(0)); }
+	int err = _RenderLayerBegin(wrap, layer);
+	if (err < 0) { return info.GetReturnValue().Set(Nan::New(err)); }
+	err = _RenderCommandBufferSubmit(command_buffer, wrap->Peek(), length);
+	if (err < 0) { _RenderLayerEnd(wrap); layer->SetDirty(); return info.GetReturnValue().Set(Nan::New(err)); }
+	err = _RenderLayerEnd(wrap);
+	info.GetReturnValue().Set(Nan::New((err < 0)?(err):(1)));
+}
+
+// extern DECLSPEC int SDLCALL SDL_RenderReadPixels(SDL_Renderer * renderer, const SDL_Rect * rect, Uint32 format, void *pixels, int pitch);
+// the area read is rect, or the whole viewport when rect is null
+// the viewport in output pixels, which is what SDL_RenderReadPixels reads for a NULL rect
+// SDL_RenderGetViewport reports logical units once a render scale or logical size applies
+// SDL rounds its own copy, so pass this as the read rect and SDL clips to whichever is smaller
+static void _RenderOutputViewport(SDL_Renderer* renderer, SDL_Rect* viewport)
+{
+	SDL_Rect logical; SDL_RenderGetViewport(renderer, &logical);
+	float scale_x = 1.0f, scale_y = 1.0f; SDL_RenderGetScale(renderer, &scale_x, &scale_y);
+	viewport->x = static_cast<int>(SDL_floor(logical.x * scale_x));
+	viewport->y = static_cast<int>(SDL_floor(logical.y * scale_y));
+	viewport->w = static_cast<int>(SDL_ceil(logical.w * scale_x));
+	viewport->h = static_cast<int>(SDL_ceil(logical.h * scale_y));
+}
+
+// the renderer's own pixel format, reading back in it leaves any conversion to the caller
+static ::Uint32 _RenderNativeFormat(WrapRenderer* wrap)
+{
+	const SDL_RendererInfo* renderer_info = wrap->GetInfo();
+	if (renderer_info && (renderer_info->num_texture_formats > 0) &&
+		!SDL_ISPIXELFORMAT_FOURCC(renderer_info->texture_formats[0]) && !SDL_ISPIXELFORMAT_INDEXED(renderer_info->texture_formats[0]))
+	{
+		return renderer_info->texture_formats[0];
+	}
+	return SDL_PIXELFORMAT_ARGB8888;
 }
 
-// extern DECLSPEC int SDLCALL SDL_RenderDrawPoint(SDL_Renderer * renderer, int x, int y);
-NANX_EXPORT(SDL_RenderDrawPoint)
+// the area written in output pixels, rect is already in output pixels and clipped to the viewport by SDL
+static void _RenderReadPixelsArea(SDL_Renderer* renderer, const SDL_Rect* rect, int* w, int* h)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	int x = NANX_int(info[1]);
-	int y = NANX_int(info[2]);
-	int err = SDL_RenderDrawPoint(renderer, x, y);
-	info.GetReturnValue().Set(Nan::New(err));
+	if (rect) { *w = rect->w; *h = rect->h; return; }
+	SDL_Rect viewport; _RenderOutputViewport(renderer, &viewport);
+	*w = viewport.w; *h = viewport.h;
 }
 
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderDrawPoints(SDL_Renderer * renderer, const SDL_Point * points, int count);
-
-// extern DECLSPEC int SDLCALL SDL_RenderDrawLine(SDL_Renderer * renderer, int x1, int y1, int x2, int y2);
-NANX_EXPORT(SDL_RenderDrawLine)
+NANX_EXPORT(SDL_RenderReadPixels)
 {
 	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	int x1 = NANX_int(info[1]);
-	int y1 = NANX_int(info[2]);
-	int x2 = NANX_int(info[3]);
-	int y2 = NANX_int(info[4]);
-	int err = SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
+	::Uint32 format = NANX_Uint32(info[2]);
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[3]->IsTypedArray()) { return Nan::ThrowError("pixels is a typed array"); }
+	#endif
+	size_t byte_length = 0;
+	void* pixels = _TypedArrayData(info[3], &byte_length);
+	int pitch = NANX_int(info[4]);
+	int w = 0, h = 0; _RenderReadPixelsArea(renderer, rect, &w, &h);
+	if (!_SDL_EXT_TexturePitchValid(format, w, h, pitch)) { return Nan::ThrowError("pitch smaller than a row"); }
+	if (byte_length < _SDL_EXT_TextureDataSize(format, w, h, pitch)) { return Nan::ThrowError("pixel data too small"); }
+	int err = SDL_RenderReadPixels(renderer, rect, format, pixels, pitch);
 	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderDrawLines(SDL_Renderer * renderer, const SDL_Point * points, int count);
+// staging buffers for async read backs, all the same size while the frame size is stable
+// main thread only, buffers are taken before the task is queued and returned after it completes
+class ReadPixelsPool
+{
+	private: static const int MAX_FREE = 4;
+	private: static void* s_free[MAX_FREE];
+	private: static int s_free_count;
+	private: static size_t s_size;
+	public: static void* Acquire(size_t size)
+	{
+		if (size != s_size) { Trim(); s_size = size; } // frame size changed
+		if (s_free_count > 0) { return s_free[--s_free_count]; }
+		return SDL_malloc(size);
+	}
+	public: static void Recycle(void* pixels, size_t size)
+	{
+		if ((size == s_size) && (s_free_count < MAX_FREE)) { s_free[s_free_count++] = pixels; }
+		else { SDL_free(pixels); }
+	}
+	public: static void Trim()
+	{
+		while (s_free_count > 0) { SDL_free(s_free[--s_free_count]); }
+	}
+};
 
-// extern DECLSPEC int SDLCALL SDL_RenderDrawRect(SDL_Renderer * renderer, const SDL_Rect * rect);
-NANX_EXPORT(SDL_RenderDrawRect)
+void* ReadPixelsPool::s_free[ReadPixelsPool::MAX_FREE];
+int ReadPixelsPool::s_free_count = 0;
+size_t ReadPixelsPool::s_size = 0;
+
+// converts a staged read back on a worker, then copies it into the caller's typed array on the loop thread
+// the array is only touched once the task completes, a detached or shrunk array fails the task
+class TaskRenderReadPixels : public Nanx::SimpleTask
+{
+	public: void* m_staging;
+	public: size_t m_staging_size;
+	public: ::Uint32 m_staging_format;
+	public: int m_staging_pitch;
+	public: int m_w;
+	public: int m_h;
+	public: Nan::Persistent<v8::Object> m_hold_pixels;
+	public: void* m_converted;
+	public: size_t m_converted_size;
+	public: ::Uint32 m_format;
+	public: int m_pitch;
+	public: int m_err;
+	public: TaskRenderReadPixels(void* staging, size_t staging_size, ::Uint32 staging_format, int staging_pitch, int w, int h, v8::Local<v8::Object> hold_pixels, size_t converted_size, ::Uint32 format, int pitch) :
+		m_staging(staging),
+		m_staging_size(staging_size),
+		m_staging_format(staging_format),
+		m_staging_pitch(staging_pitch),
+		m_w(w),
+		m_h(h),
+		m_converted(NULL),
+		m_converted_size(converted_size),
+		m_format(format),
+		m_pitch(pitch),
+		m_err(0)
+	{
+		m_hold_pixels.Reset(hold_pixels);
+	}
+	public: ~TaskRenderReadPixels()
+	{
+		if (m_staging) { ReadPixelsPool::Recycle(m_staging, m_staging_size); m_staging = NULL; }
+		SDL_free(m_converted); m_converted = NULL;
+		m_hold_pixels.Reset();
+	}
+	public: void DoWork()
+	{
+		m_converted = SDL_malloc(m_converted_size);
+		m_err = (m_converted)?(SDL_ConvertPixels(m_w, m_h, m_staging_format, m_staging, m_staging_pitch, m_format, m_converted, m_pitch)):(SDL_OutOfMemory());
+		if (m_err < 0) { SetError(SDL_GetError()); }
+	}
+	public: v8::Local<v8::Value> DoAfterWork(int status)
+	{
+		if (m_err < 0) { return Nan::New(m_err); }
+		size_t byte_length = 0;
+		void* pixels = _TypedArrayData(Nan::New<v8::Object>(m_hold_pixels), &byte_length);
+		if (!pixels || (byte_length < m_converted_size))
+		{
+			m_err = -1; SetError("pixels detached or too small");
+			return Nan::New(m_err);
+		}
+		SDL_memcpy(pixels, m_converted, m_converted_size);
+		return Nan::New(m_err);
+	}
+};
+
+// reads back in the renderer's own format now and queues the conversion,
+// so it overlaps with drawing the next frame
+static int _RenderReadPixelsQueue(const Nan::FunctionCallbackInfo<v8::Value>& info, TaskRenderReadPixels** out_task)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	*out_task = NULL;
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[0]);
+	SDL_Renderer* renderer = (wrap)?(wrap->Peek()):(NULL); if (!renderer) { Nan::ThrowError("null SDL_Renderer object"); return -1; }
 	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
-	int err = SDL_RenderDrawRect(renderer, rect);
-	info.GetReturnValue().Set(Nan::New(err));
+	::Uint32 format = NANX_Uint32(info[2]);
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[3]->IsTypedArray()) { Nan::ThrowError("pixels is a typed array"); return -1; }
+	#endif
+	size_t byte_length = 0;
+	void* pixels = _TypedArrayData(info[3], &byte_length);
+	int pitch = NANX_int(info[4]);
+	SDL_Rect viewport; _RenderOutputViewport(renderer, &viewport);
+	SDL_Rect area = (rect)?(*rect):(viewport);
+	if (!_SDL_EXT_TexturePitchValid(format, area.w, area.h, pitch)) { Nan::ThrowError("pitch smaller than a row"); return -1; }
+	size_t converted_size = _SDL_EXT_TextureDataSize(format, area.w, area.h, pitch);
+	if (!pixels || (byte_length < converted_size)) { Nan::ThrowError("pixel data too small"); return -1; }
+	::Uint32 staging_format = _RenderNativeFormat(wrap);
+	int staging_pitch = area.w * SDL_BYTESPERPIXEL(staging_format);
+	size_t staging_size = static_cast<size_t>(staging_pitch) * area.h;
+	void* staging = (staging_size > 0)?(ReadPixelsPool::Acquire(staging_size)):(NULL);
+	if (!staging) { return (staging_size > 0)?(SDL_OutOfMemory()):(SDL_SetError("empty read back area")); }
+	SDL_Rect clipped;
+	if (!SDL_IntersectRect(&area, &viewport, &clipped) || !SDL_RectEquals(&clipped, &area)) { SDL_memset(staging, 0, staging_size); } // SDL leaves the part outside the viewport unwritten
+	int err = SDL_RenderReadPixels(renderer, &area, staging_format, staging, staging_pitch);
+	if (err < 0) { ReadPixelsPool::Recycle(staging, staging_size); return err; }
+	*out_task = new TaskRenderReadPixels(staging, staging_size, staging_format, staging_pitch, area.w, area.h, v8::Local<v8::Object>::Cast(info[3]), converted_size, format, pitch);
+	return 0;
+}
+
+// returns the task id, or an error when the read back itself failed
+NANX_EXPORT(SDL_EXT_RenderReadPixelsAsync)
+{
+	TaskRenderReadPixels* task = NULL;
+	int err = _RenderReadPixelsQueue(info, &task);
+	if (!task) { return info.GetReturnValue().Set(Nan::New(err)); }
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[6]);
+	int id = (info[5]->IsFunction())?
+		(Nanx::SimpleTask::Run(task, v8::Local<v8::Function>::Cast(info[5]), priority)):
+		(Nanx::SimpleTask::Run(task, priority));
+	info.GetReturnValue().Set(Nan::New(id));
 }
 
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderDrawRects(SDL_Renderer * renderer, const SDL_Rect * rects, int count);
-
-// extern DECLSPEC int SDLCALL SDL_RenderFillRect(SDL_Renderer * renderer, const SDL_Rect * rect);
-NANX_EXPORT(SDL_RenderFillRect)
+NANX_EXPORT(SDL_EXT_RenderReadPixelsPromise)
 {
-	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
-	SDL_Rect* rect = (info[1]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[1]))->GetRect()));
-	int err = SDL_RenderFillRect(renderer, rect);
-	info.GetReturnValue().Set(Nan::New(err));
+	TaskRenderReadPixels* task = NULL;
+	Nan::TryCatch try_catch;
+	_RenderReadPixelsQueue(info, &task);
+	if (try_catch.HasCaught()) { try_catch.ReThrow(); return; } // bad arguments still throw
+	if (!task)
+	{
+		// a failed read back rejects, the caller always gets a promise
+		v8::Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+		resolver->Reject(Nan::GetCurrentContext(), Nan::Error(SDL_GetError())).FromJust();
+		return info.GetReturnValue().Set(resolver->GetPromise());
+	}
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[5]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(task, priority));
 }
 
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderFillRects(SDL_Renderer * renderer, const SDL_Rect * rects, int count);
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture, const SDL_Rect * srcrect, const SDL_Rect * dstrect);
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderCopyEx(SDL_Renderer * renderer, SDL_Texture * texture, const SDL_Rect * srcrect, const SDL_Rect * dstrect, const double angle, const SDL_Point *center, const SDL_RendererFlip flip);
-// TODO: extern DECLSPEC int SDLCALL SDL_RenderReadPixels(SDL_Renderer * renderer, const SDL_Rect * rect, Uint32 format, void *pixels, int pitch);
+// frees idle staging buffers, e.g. after a capture run
+NANX_EXPORT(SDL_EXT_RenderReadPixelsTrim)
+{
+	ReadPixelsPool::Trim();
+}
 
 // extern DECLSPEC void SDLCALL SDL_RenderPresent(SDL_Renderer * renderer);
 NANX_EXPORT(SDL_RenderPresent)
 {
-	SDL_Renderer* renderer = WrapRenderer::Drop(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	SDL_Renderer* renderer = WrapRenderer::Peek(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
 	SDL_RenderPresent(renderer);
 }
 
-// TODO: extern DECLSPEC void SDLCALL SDL_DestroyTexture(SDL_Texture * texture);
+// extern DECLSPEC void SDLCALL SDL_DestroyTexture(SDL_Texture * texture);
+NANX_EXPORT(SDL_DestroyTexture)
+{
+	SDL_Texture* texture = WrapTexture::Drop(info[0]); if (!texture) { return Nan::ThrowError("null SDL_Texture object"); }
+	SDL_DestroyTexture(texture);
+}
 
 // extern DECLSPEC void SDLCALL SDL_DestroyRenderer(SDL_Renderer * renderer);
 NANX_EXPORT(SDL_DestroyRenderer)
 {
-	SDL_Renderer* renderer = WrapRenderer::Drop(info[0]); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[0]);
+	SDL_Renderer* renderer = (wrap)?(wrap->Drop()):(NULL); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	wrap->InvalidateTextures();
 	SDL_DestroyRenderer(renderer);
 }
 
@@ -1226,58 +5862,157 @@ NANX_EXPORT(SDL_CreateRGBSurface)
 // TODO: extern DECLSPEC SDL_Surface *SDLCALL SDL_CreateRGBSurfaceWithFormat(Uint32 flags, int width, int height, int depth, Uint32 format);
 #endif
 
-NANX_EXPORT(SDL_CreateRGBSurfaceFrom)
+NANX_EXPORT(SDL_CreateRGBSurfaceFrom)
+{
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	v8::Local<v8::TypedArray> _pixels = v8::Local<v8::TypedArray>::Cast(info[0]);
+	void* pixels = static_cast<char*>(_pixels->Buffer()->GetContents().Data()) + _pixels->ByteOffset();
+	//size_t byte_length = _pixels->ByteLength();
+	#else
+	v8::Local<v8::Object> _pixels = v8::Local<v8::Object>::Cast(info[0]);
+	void* pixels = (void*) _pixels->GetIndexedPropertiesExternalArrayData();
+	//int byte_length = _pixels->GetIndexedPropertiesExternalArrayDataLength();
+	#endif
+	int width = NANX_int(info[1]);
+	int height = NANX_int(info[2]);
+	int depth = NANX_int(info[3]);
+	int pitch = NANX_int(info[4]);
+	::Uint32 Rmask = NANX_Uint32(info[5]);
+	::Uint32 Gmask = NANX_Uint32(info[6]);
+	::Uint32 Bmask = NANX_Uint32(info[7]);
+	::Uint32 Amask = NANX_Uint32(info[8]);
+	SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(pixels, width, height, depth, pitch, Rmask, Gmask, Bmask, Amask);
+	info.GetReturnValue().Set(WrapSurface::Hold(surface));
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+// TODO: extern DECLSPEC SDL_Surface *SDLCALL SDL_CreateRGBSurfaceWithFormatFrom(void *pixels, int width, int height, int depth, int pitch, Uint32 format);
+#endif
+
+NANX_EXPORT(SDL_FreeSurface)
+{
+	SDL_Surface* surface = WrapSurface::Drop(info[0]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
+	SDL_FreeSurface(surface);
+}
+
+// TODO: extern DECLSPEC int SDLCALL SDL_SetSurfacePalette(SDL_Surface * surface, SDL_Palette * palette);
+// TODO: extern DECLSPEC int SDLCALL SDL_LockSurface(SDL_Surface * surface);
+// TODO: extern DECLSPEC void SDLCALL SDL_UnlockSurface(SDL_Surface * surface);
+
+NANX_EXPORT(SDL_LoadBMP)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[1]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	int id = Nanx::SimpleTask::Run(new TaskLoadBMP(file), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_LoadBMPPromise)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[1]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskLoadBMP(file), priority));
+}
+
+NANX_EXPORT(SDL_SaveBMP)
+{
+	v8::Local<v8::Value> surface = info[0];
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[1]);
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[2]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[3]);
+	int id = Nanx::SimpleTask::Run(new TaskSaveBMP(surface, file), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_SaveBMPPromise)
+{
+	v8::Local<v8::Value> surface = info[0];
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[1]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskSaveBMP(surface, file), priority));
+}
+
+NANX_EXPORT(SDL_EXT_LoadBMPInto_RW)
+{
+	int freesrc = NANX_int(info[1]);
+	SDL_RWops* src = (freesrc)?(WrapRWops::Drop(info[0])):(WrapRWops::Peek(info[0])); if (!src) { return Nan::ThrowError("null SDL_RWops object"); }
+	SDL_Surface* surface = WrapSurface::Peek(info[2]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
+	SDL_Rect* rect = (info[3]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[3]))->GetRect()));
+	int err = _SDL_EXT_LoadBMPInto_RW(src, freesrc, surface, rect);
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// the surface must not be used until the task completes
+NANX_EXPORT(SDL_EXT_LoadBMPInto)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	v8::Local<v8::Value> surface = info[1];
+	SDL_Rect* rect = (info[2]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[2]))->GetRect()));
+	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[3]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[4]);
+	int id = Nanx::SimpleTask::Run(new TaskLoadBMPInto(file, surface, rect), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_LoadBMPIntoPromise)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	v8::Local<v8::Value> surface = info[1];
+	SDL_Rect* rect = (info[2]->IsNull())?(NULL):(&(WrapRect::Unwrap(v8::Local<v8::Object>::Cast(info[2]))->GetRect()));
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[3]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskLoadBMPInto(file, surface, rect), priority));
+}
+
+NANX_EXPORT(SDL_EXT_LoadQOI_RW)
 {
-	#if NODE_VERSION_AT_LEAST(4, 0, 0)
-	v8::Local<v8::TypedArray> _pixels = v8::Local<v8::TypedArray>::Cast(info[0]);
-	void* pixels = static_cast<char*>(_pixels->Buffer()->GetContents().Data()) + _pixels->ByteOffset();
-	//size_t byte_length = _pixels->ByteLength();
-	#else
-	v8::Local<v8::Object> _pixels = v8::Local<v8::Object>::Cast(info[0]);
-	void* pixels = (void*) _pixels->GetIndexedPropertiesExternalArrayData();
-	//int byte_length = _pixels->GetIndexedPropertiesExternalArrayDataLength();
-	#endif
-	int width = NANX_int(info[1]);
-	int height = NANX_int(info[2]);
-	int depth = NANX_int(info[3]);
-	int pitch = NANX_int(info[4]);
-	::Uint32 Rmask = NANX_Uint32(info[5]);
-	::Uint32 Gmask = NANX_Uint32(info[6]);
-	::Uint32 Bmask = NANX_Uint32(info[7]);
-	::Uint32 Amask = NANX_Uint32(info[8]);
-	SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(pixels, width, height, depth, pitch, Rmask, Gmask, Bmask, Amask);
+	int freesrc = NANX_int(info[1]);
+	SDL_RWops* src = (freesrc)?(WrapRWops::Drop(info[0])):(WrapRWops::Peek(info[0])); if (!src) { return Nan::ThrowError("null SDL_RWops object"); }
+	SDL_Surface* surface = _SDL_EXT_LoadQOI_RW(src, freesrc);
 	info.GetReturnValue().Set(WrapSurface::Hold(surface));
 }
 
-#if SDL_VERSION_ATLEAST(2, 0, 5)
-// TODO: extern DECLSPEC SDL_Surface *SDLCALL SDL_CreateRGBSurfaceWithFormatFrom(void *pixels, int width, int height, int depth, int pitch, Uint32 format);
-#endif
-
-NANX_EXPORT(SDL_FreeSurface)
+NANX_EXPORT(SDL_EXT_SaveQOI_RW)
 {
-	SDL_Surface* surface = WrapSurface::Drop(info[0]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
-	SDL_FreeSurface(surface);
+	SDL_Surface* surface = WrapSurface::Peek(info[0]); if (!surface) { return Nan::ThrowError("null SDL_Surface object"); }
+	int freedst = NANX_int(info[2]);
+	SDL_RWops* dst = (freedst)?(WrapRWops::Drop(info[1])):(WrapRWops::Peek(info[1])); if (!dst) { return Nan::ThrowError("null SDL_RWops object"); }
+	int err = _SDL_EXT_SaveQOI_RW(surface, dst, freedst);
+	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// TODO: extern DECLSPEC int SDLCALL SDL_SetSurfacePalette(SDL_Surface * surface, SDL_Palette * palette);
-// TODO: extern DECLSPEC int SDLCALL SDL_LockSurface(SDL_Surface * surface);
-// TODO: extern DECLSPEC void SDLCALL SDL_UnlockSurface(SDL_Surface * surface);
-
-NANX_EXPORT(SDL_LoadBMP)
+NANX_EXPORT(SDL_EXT_LoadQOI)
 {
 	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
 	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[1]);
-	int err = Nanx::SimpleTask::Run(new TaskLoadBMP(file, callback));
-	info.GetReturnValue().Set(Nan::New(err));
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	int id = Nanx::SimpleTask::Run(new TaskLoadQOI(file), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
 }
 
-NANX_EXPORT(SDL_SaveBMP)
+NANX_EXPORT(SDL_EXT_LoadQOIPromise)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[0]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[1]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskLoadQOI(file), priority));
+}
+
+NANX_EXPORT(SDL_EXT_SaveQOI)
 {
 	v8::Local<v8::Value> surface = info[0];
 	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[1]);
 	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[2]);
-	int err = Nanx::SimpleTask::Run(new TaskSaveBMP(surface, file, callback));
-	info.GetReturnValue().Set(Nan::New(err));
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[3]);
+	int id = Nanx::SimpleTask::Run(new TaskSaveQOI(surface, file), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_SaveQOIPromise)
+{
+	v8::Local<v8::Value> surface = info[0];
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[1]);
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new TaskSaveQOI(surface, file), priority));
 }
 
 // TODO: extern DECLSPEC int SDLCALL SDL_SetSurfaceRLE(SDL_Surface * surface, int flag);
@@ -1744,9 +6479,246 @@ NANX_EXPORT(SDL_SetWindowFullscreen)
 	info.GetReturnValue().Set(Nan::New(err));
 }
 
-// TODO: extern DECLSPEC SDL_Surface * SDLCALL SDL_GetWindowSurface(SDL_Window * window);
-// TODO: extern DECLSPEC int SDLCALL SDL_UpdateWindowSurface(SDL_Window * window);
-// TODO: extern DECLSPEC int SDLCALL SDL_UpdateWindowSurfaceRects(SDL_Window * window, const SDL_Rect * rects, int numrects);
+// SDL_GetWindowSurface frees the old surface after a resize, a wrapper still borrowing it goes null
+static SDL_Surface* _GetWindowSurface(SDL_Window* window)
+{
+	SDL_Surface* surface = SDL_GetWindowSurface(window);
+	if (surface != WrapSurface::BorrowedWindowSurface(window)) { WrapSurface::InvalidateWindowSurface(window); }
+	return surface;
+}
+
+// extern DECLSPEC SDL_Surface * SDLCALL SDL_GetWindowSurface(SDL_Window * window);
+// the surface belongs to the window and the wrapper only borrows it, re-fetch it each frame
+// the wrapper goes null on the next call, on SDL_WINDOWEVENT_SIZE_CHANGED and when the window is destroyed
+NANX_EXPORT(SDL_GetWindowSurface)
+{
+	SDL_Window* window = WrapWindow::Peek(info[0]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
+	SDL_Surface* surface = _GetWindowSurface(window);
+	if (!surface) { return info.GetReturnValue().SetNull(); }
+	info.GetReturnValue().Set(WrapSurface::HoldWindowSurface(window, surface));
+}
+
+// extern DECLSPEC int SDLCALL SDL_UpdateWindowSurface(SDL_Window * window);
+NANX_EXPORT(SDL_UpdateWindowSurface)
+{
+	SDL_Window* window = WrapWindow::Peek(info[0]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
+	int err = SDL_UpdateWindowSurface(window);
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// extern DECLSPEC int SDLCALL SDL_UpdateWindowSurfaceRects(SDL_Window * window, const SDL_Rect * rects, int numrects);
+NANX_EXPORT(SDL_UpdateWindowSurfaceRects)
+{
+	SDL_Window* window = WrapWindow::Peek(info[0]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
+	#if NODE_VERSION_AT_LEAST(4, 0, 0)
+	if (!info[1]->IsInt32Array()) { return Nan::ThrowError("rects is an Int32Array"); }
+	#endif
+	size_t byte_length = 0;
+	const SDL_Rect* rects = static_cast<const SDL_Rect*>(_TypedArrayData(info[1], &byte_length));
+	#if !NODE_VERSION_AT_LEAST(4, 0, 0)
+	byte_length *= sizeof(int32_t);
+	#endif
+	int count = NANX_int(info[2]);
+	if ((count < 0) || ((static_cast<size_t>(count) * sizeof(SDL_Rect)) > byte_length)) { return Nan::ThrowError("rects array too small"); }
+	int err = SDL_UpdateWindowSurfaceRects(window, rects, count);
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+// accumulates the regions of a window surface changed during a frame
+// a new rect is merged with an existing one when the union wastes at most threshold of its area,
+// overlapping or touching rects that fill their union are always merged
+class DirtyRects
+{
+	public: static const int MAX_RECTS = 64;
+	public: float m_threshold; // 0..1, fraction of the union allowed to be clean pixels
+	public: SDL_Rect m_rects[MAX_RECTS];
+	public: int m_count;
+	public: double m_frames;
+	public: double m_last_rects;
+	public: double m_last_pixels;
+	public: double m_total_pixels;
+	public: double m_full_pixels; // what full presents would have pushed
+	public: DirtyRects(float threshold) :
+		m_threshold(threshold), m_count(0),
+		m_frames(0), m_last_rects(0), m_last_pixels(0), m_total_pixels(0), m_full_pixels(0)
+	{
+	}
+	private: static ::Sint64 Area(const SDL_Rect& rect) { return static_cast< ::Sint64 >(rect.w) * rect.h; }
+	private: static SDL_Rect Union(const SDL_Rect& a, const SDL_Rect& b)
+	{
+		int x0 = SDL_min(a.x, b.x), y0 = SDL_min(a.y, b.y);
+		int x1 = SDL_max(a.x + a.w, b.x + b.w), y1 = SDL_max(a.y + a.h, b.y + b.h);
+		SDL_Rect rect = { x0, y0, x1 - x0, y1 - y0 };
+		return rect;
+	}
+	// pixels of the union not covered by either rect
+	private: static ::Sint64 Waste(const SDL_Rect& a, const SDL_Rect& b, const SDL_Rect& u)
+	{
+		::Sint64 overlap = 0;
+		int ix = SDL_max(a.x, b.x), iy = SDL_max(a.y, b.y);
+		int iw = SDL_min(a.x + a.w, b.x + b.w) - ix, ih = SDL_min(a.y + a.h, b.y + b.h) - iy;
+		if ((iw > 0) && (ih > 0)) { overlap = static_cast< ::Sint64 >(iw) * ih; }
+		return Area(u) - (Area(a) + Area(b) - overlap);
+	}
+	private: bool Mergeable(const SDL_Rect& a, const SDL_Rect& b, SDL_Rect* u)
+	{
+		*u = Union(a, b);
+		return Waste(a, b, *u) <= static_cast< ::Sint64 >(m_threshold * Area(*u));
+	}
+	public: void Add(SDL_Rect rect)
+	{
+		if ((rect.w <= 0) || (rect.h <= 0)) { return; }
+		// merging can make the union mergeable with others, keep going until it settles
+		for (int i = 0; i < m_count; )
+		{
+			SDL_Rect u;
+			if (Mergeable(m_rects[i], rect, &u)) { rect = u; m_rects[i] = m_rects[--m_count]; i = 0; }
+			else { ++i; }
+		}
+		if (m_count == MAX_RECTS)
+		{
+			// full, grow whichever rect grows least
+			int best = 0; ::Sint64 best_growth = 0;
+			for (int i = 0; i < m_count; ++i)
+			{
+				::Sint64 growth = Area(Union(m_rects[i], rect)) - Area(m_rects[i]);
+				if ((i == 0) || (growth < best_growth)) { best = i; best_growth = growth; }
+			}
+			rect = Union(m_rects[best], rect);
+			m_rects[best] = m_rects[--m_count];
+			Add(rect);
+			return;
+		}
+		m_rects[m_count++] = rect;
+	}
+	// clips to the surface and records what one present pushes
+	public: int Finish(int w, int h)
+	{
+		SDL_Rect bounds = { 0, 0, w, h };
+		int count = 0;
+		::Sint64 pixels = 0;
+		for (int i = 0; i < m_count; ++i)
+		{
+			SDL_Rect clipped;
+			if (SDL_IntersectRect(&m_rects[i], &bounds, &clipped)) { m_rects[count++] = clipped; pixels += Area(clipped); }
+		}
+		m_count = count;
+		m_frames += 1;
+		m_last_rects = count;
+		m_last_pixels = static_cast<double>(pixels);
+		m_total_pixels += m_last_pixels;
+		m_full_pixels += static_cast<double>(Area(bounds));
+		return count;
+	}
+	public: void Clear() { m_count = 0; }
+};
+
+class WrapDirtyRects : public Nan::ObjectWrap
+{
+private:
+	DirtyRects* m_dirty;
+public:
+	WrapDirtyRects(DirtyRects* dirty) : m_dirty(dirty) {}
+	~WrapDirtyRects() { Free(m_dirty); m_dirty = NULL; }
+public:
+	DirtyRects* Peek() { return m_dirty; }
+	DirtyRects* Drop() { DirtyRects* dirty = m_dirty; m_dirty = NULL; return dirty; }
+public:
+	static WrapDirtyRects* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
+	static WrapDirtyRects* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapDirtyRects>(object); }
+	static DirtyRects* Peek(v8::Local<v8::Value> value) { WrapDirtyRects* wrap = Unwrap(value); return (wrap)?(wrap->Peek()):(NULL); }
+public:
+	static v8::Local<v8::Value> Hold(DirtyRects* dirty) { return NewInstance(dirty); }
+	static DirtyRects* Drop(v8::Local<v8::Value> value) { WrapDirtyRects* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
+	static void Free(DirtyRects* dirty)
+	{
+		if (dirty) { delete dirty; dirty = NULL; }
+	}
+public:
+	static v8::Local<v8::Object> NewInstance(DirtyRects* dirty)
+	{
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::ObjectTemplate> object_template = GetObjectTemplate();
+		v8::Local<v8::Object> instance = object_template->NewInstance();
+		WrapDirtyRects* wrap = new WrapDirtyRects(dirty);
+		wrap->Wrap(instance);
+		return scope.Escape(instance);
+	}
+private:
+	static v8::Local<v8::ObjectTemplate> GetObjectTemplate()
+	{
+		Nan::EscapableHandleScope scope;
+		static Nan::Persistent<v8::ObjectTemplate> g_object_template;
+		if (g_object_template.IsEmpty())
+		{
+			v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>();
+			g_object_template.Reset(object_template);
+			object_template->SetInternalFieldCount(1);
+		}
+		v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>(g_object_template);
+		return scope.Escape(object_template);
+	}
+};
+
+NANX_EXPORT(SDL_EXT_CreateDirtyRects)
+{
+	float threshold = (info[0]->IsNumber())?(NANX_float(info[0])):(0.25f);
+	info.GetReturnValue().Set(WrapDirtyRects::Hold(new DirtyRects(SDL_max(0.0f, SDL_min(threshold, 1.0f)))));
+}
+
+NANX_EXPORT(SDL_EXT_DestroyDirtyRects)
+{
+	DirtyRects* dirty = WrapDirtyRects::Drop(info[0]); if (!dirty) { return Nan::ThrowError("null DirtyRects object"); }
+	WrapDirtyRects::Free(dirty);
+}
+
+NANX_EXPORT(SDL_EXT_DirtyRectsSetThreshold)
+{
+	DirtyRects* dirty = WrapDirtyRects::Peek(info[0]); if (!dirty) { return Nan::ThrowError("null DirtyRects object"); }
+	dirty->m_threshold = SDL_max(0.0f, SDL_min(NANX_float(info[1]), 1.0f));
+}
+
+NANX_EXPORT(SDL_EXT_DirtyRectsAdd)
+{
+	DirtyRects* dirty = WrapDirtyRects::Peek(info[0]); if (!dirty) { return Nan::ThrowError("null DirtyRects object"); }
+	SDL_Rect rect = { NANX_int(info[1]), NANX_int(info[2]), NANX_int(info[3]), NANX_int(info[4]) };
+	dirty->Add(rect);
+}
+
+NANX_EXPORT(SDL_EXT_DirtyRectsClear)
+{
+	DirtyRects* dirty = WrapDirtyRects::Peek(info[0]); if (!dirty) { return Nan::ThrowError("null DirtyRects object"); }
+	dirty->Clear();
+}
+
+// pushes only the accumulated rects to the window and starts a new frame, nothing is pushed when nothing changed
+NANX_EXPORT(SDL_EXT_UpdateWindowSurfaceDirty)
+{
+	SDL_Window* window = WrapWindow::Peek(info[0]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
+	DirtyRects* dirty = WrapDirtyRects::Peek(info[1]); if (!dirty) { return Nan::ThrowError("null DirtyRects object"); }
+	SDL_Surface* surface = _GetWindowSurface(window);
+	int err = -1;
+	if (surface)
+	{
+		int count = dirty->Finish(surface->w, surface->h);
+		err = (count > 0)?(SDL_UpdateWindowSurfaceRects(window, dirty->m_rects, count)):(0);
+	}
+	dirty->Clear();
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+NANX_EXPORT(SDL_EXT_DirtyRectsStats)
+{
+	DirtyRects* dirty = WrapDirtyRects::Peek(info[0]); if (!dirty) { return Nan::ThrowError("null DirtyRects object"); }
+	v8::Local<v8::Object> stats = Nan::New<v8::Object>();
+	stats->Set(NANX_SYMBOL("pending"), Nan::New(dirty->m_count));
+	stats->Set(NANX_SYMBOL("frames"), Nan::New(dirty->m_frames));
+	stats->Set(NANX_SYMBOL("rects"), Nan::New(dirty->m_last_rects)); // last present
+	stats->Set(NANX_SYMBOL("pixels"), Nan::New(dirty->m_last_pixels)); // last present
+	stats->Set(NANX_SYMBOL("total_pixels"), Nan::New(dirty->m_total_pixels));
+	stats->Set(NANX_SYMBOL("full_pixels"), Nan::New(dirty->m_full_pixels));
+	info.GetReturnValue().Set(stats);
+}
 
 // extern DECLSPEC void SDLCALL SDL_SetWindowGrab(SDL_Window * window, SDL_bool grabbed);
 NANX_EXPORT(SDL_SetWindowGrab)
@@ -1787,7 +6759,7 @@ NANX_EXPORT(SDL_GetWindowBrightness)
 NANX_EXPORT(SDL_DestroyWindow)
 {
 	SDL_Window* window = WrapWindow::Drop(info[0]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
-	SDL_DestroyWindow(window);
+	WrapWindow::Free(window);
 }
 
 // extern DECLSPEC SDL_bool SDLCALL SDL_IsScreenSaverEnabled(void);
@@ -1994,20 +6966,18 @@ class SurfaceToImageDataTask : public Nanx::SimpleTask
 {
 public:
 	Nan::Persistent<v8::Value> m_hold_surface;
-	Nan::Persistent<v8::Function> m_callback;
 	Nan::Persistent<v8::Object> m_image_data;
 	SDL_Surface* m_surface;
 	int m_length;
 	void* m_pixels;
 public:
-	SurfaceToImageDataTask(v8::Local<v8::Value> surface, v8::Local<v8::Function> callback) :
+	SurfaceToImageDataTask(v8::Local<v8::Value> surface) :
 		m_surface(WrapSurface::Peek(surface)),
 		m_length(0),
 		m_pixels(NULL)
 	{
 
 		m_hold_surface.Reset(surface);
-		m_callback.Reset(callback);
 		m_image_data.Reset(Nan::New<v8::Object>());
 
 		static const ::Uint32 format = SDL_PIXELFORMAT_ABGR8888; // ImageData pixel format
@@ -2037,7 +7007,6 @@ public:
 	~SurfaceToImageDataTask()
 	{
 		m_hold_surface.Reset();
-		m_callback.Reset();
 		m_image_data.Reset();
 		m_surface = NULL;
 		m_length = 0;
@@ -2049,12 +7018,14 @@ public:
 		{
 			SurfaceToImageData(m_surface, m_pixels, m_length);
 		}
+		else
+		{
+			SetError("null SDL_Surface object");
+		}
 	}
-	void DoAfterWork(int status)
+	v8::Local<v8::Value> DoAfterWork(int status)
 	{
-		Nan::HandleScope scope;
-		v8::Local<v8::Value> argv[] = { Nan::New<v8::Object>(m_image_data) };
-		Nan::MakeCallback(Nan::GetCurrentContext()->Global(), Nan::New<v8::Function>(m_callback), countof(argv), argv);
+		return Nan::New<v8::Object>(m_image_data);
 	}
 };
 
@@ -2062,8 +7033,16 @@ NANX_EXPORT(SDL_EXT_SurfaceToImageDataAsync)
 {
 	v8::Local<v8::Value> surface = info[0];
 	v8::Local<v8::Function> callback = v8::Local<v8::Function>::Cast(info[1]);
-	int err = Nanx::SimpleTask::Run(new SurfaceToImageDataTask(surface, callback));
-	info.GetReturnValue().Set(Nan::New(err));
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[2]);
+	int id = Nanx::SimpleTask::Run(new SurfaceToImageDataTask(surface), callback, priority);
+	info.GetReturnValue().Set(Nan::New(id));
+}
+
+NANX_EXPORT(SDL_EXT_SurfaceToImageDataPromise)
+{
+	v8::Local<v8::Value> surface = info[0];
+	Nanx::TaskPriority priority = NANX_TaskPriority(info[1]);
+	info.GetReturnValue().Set(Nanx::SimpleTask::RunPromise(new SurfaceToImageDataTask(surface), priority));
 }
 
 NANX_EXPORT(SDL_EXT_SurfaceToImageData)
@@ -2123,12 +7102,371 @@ NANX_EXPORT(SDL_EXT_ImageDataToSurface)
 	info.GetReturnValue().Set(WrapSurface::Hold(surface));
 }
 
+// screenshot pipeline
+// capture copies the frame into a recycled buffer on the main thread in the renderer's own format,
+// pixel conversion, encoding and the file write run on the task pool at background priority
+
+enum
+{
+	SDL_EXT_SCREENSHOT_BMP = 0,
+	SDL_EXT_SCREENSHOT_QOI = 1
+};
+
+enum
+{
+	SDL_EXT_SCREENSHOT_DROP = 0, // skip the capture when the queue is full
+	SDL_EXT_SCREENSHOT_BLOCK = 1 // wait for a worker to finish an encode
+};
+
+struct ScreenshotBuffer
+{
+	ScreenshotBuffer* next;
+	void* pixels;
+	size_t size;
+	int w, h, pitch;
+	::Uint32 format;
+};
+
+class ScreenshotPipeline
+{
+	public: int m_encoding;
+	public: int m_max_in_flight;
+	public: int m_policy;
+	public: int m_refs; // script object + in flight tasks, main thread only
+	public: int m_in_flight; // captured but not completed, main thread only
+	public: int m_working; // captured but not yet encoded, guarded by m_mutex
+	public: uv_mutex_t m_mutex;
+	public: uv_cond_t m_cond;
+	public: ScreenshotBuffer* m_free;
+	public: int m_free_count;
+	public: double m_captured;
+	public: double m_dropped;
+	public: double m_written;
+	public: double m_failed;
+	public: double m_blocked_ms;
+	public: ScreenshotPipeline(int encoding, int max_in_flight, int policy) :
+		m_encoding(encoding), m_max_in_flight(SDL_max(1, max_in_flight)), m_policy(policy),
+		m_refs(1), m_in_flight(0), m_working(0), m_free(NULL), m_free_count(0),
+		m_captured(0), m_dropped(0), m_written(0), m_failed(0), m_blocked_ms(0)
+	{
+		uv_mutex_init(&m_mutex);
+		uv_cond_init(&m_cond);
+	}
+	private: ~ScreenshotPipeline()
+	{
+		while (m_free) { ScreenshotBuffer* next = m_free->next; SDL_free(m_free->pixels); SDL_free(m_free); m_free = next; }
+		uv_cond_destroy(&m_cond);
+		uv_mutex_destroy(&m_mutex);
+	}
+	public: void Retain() { ++m_refs; }
+	public: void Release() { if (--m_refs == 0) { delete this; } }
+	// false when the capture should be dropped
+	public: bool Reserve()
+	{
+		uv_mutex_lock(&m_mutex);
+		if ((m_working >= m_max_in_flight) && (m_policy == SDL_EXT_SCREENSHOT_BLOCK))
+		{
+			::Uint64 start = SDL_GetPerformanceCounter();
+			while (m_working >= m_max_in_flight) { uv_cond_wait(&m_cond, &m_mutex); }
+			m_blocked_ms += 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		}
+		bool reserved = (m_working < m_max_in_flight);
+		if (reserved) { ++m_working; }
+		uv_mutex_unlock(&m_mutex);
+		if (reserved) { ++m_in_flight; Retain(); } else { ++m_dropped; }
+		return reserved;
+	}
+	// called once per reserved capture, from a worker when the encode is done
+	public: void WorkDone()
+	{
+		uv_mutex_lock(&m_mutex);
+		--m_working;
+		uv_cond_signal(&m_cond);
+		uv_mutex_unlock(&m_mutex);
+	}
+	// called on the main thread when a reserved capture completes
+	public: void Complete(bool written)
+	{
+		--m_in_flight;
+		if (written) { ++m_written; } else { ++m_failed; }
+		Release();
+	}
+	public: ScreenshotBuffer* Acquire(int w, int h, int pitch, ::Uint32 format)
+	{
+		size_t size = static_cast<size_t>(pitch) * h;
+		ScreenshotBuffer* buffer = m_free;
+		if (buffer) { m_free = buffer->next; --m_free_count; }
+		else { buffer = static_cast<ScreenshotBuffer*>(SDL_calloc(1, sizeof(ScreenshotBuffer))); }
+		if (!buffer) { SDL_OutOfMemory(); return NULL; }
+		if (buffer->size < size)
+		{
+			SDL_free(buffer->pixels);
+			buffer->pixels = SDL_malloc(size);
+			buffer->size = (buffer->pixels)?(size):(0);
+			if (!buffer->pixels) { SDL_free(buffer); SDL_OutOfMemory(); return NULL; }
+		}
+		buffer->next = NULL;
+		buffer->w = w; buffer->h = h; buffer->pitch = pitch; buffer->format = format;
+		return buffer;
+	}
+	public: void Recycle(ScreenshotBuffer* buffer)
+	{
+		if (!buffer) { return; }
+		if (m_free_count >= m_max_in_flight) { SDL_free(buffer->pixels); SDL_free(buffer); return; }
+		buffer->next = m_free; m_free = buffer; ++m_free_count;
+	}
+};
+
+class WrapScreenshotPipeline : public Nan::ObjectWrap
+{
+private:
+	ScreenshotPipeline* m_pipeline;
+public:
+	WrapScreenshotPipeline(ScreenshotPipeline* pipeline) : m_pipeline(pipeline) {}
+	~WrapScreenshotPipeline() { Free(m_pipeline); m_pipeline = NULL; }
+public:
+	ScreenshotPipeline* Peek() { return m_pipeline; }
+	ScreenshotPipeline* Drop() { ScreenshotPipeline* pipeline = m_pipeline; m_pipeline = NULL; return pipeline; }
+public:
+	static WrapScreenshotPipeline* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
+	static WrapScreenshotPipeline* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapScreenshotPipeline>(object); }
+	static ScreenshotPipeline* Peek(v8::Local<v8::Value> value) { WrapScreenshotPipeline* wrap = Unwrap(value); return (wrap)?(wrap->Peek()):(NULL); }
+public:
+	static v8::Local<v8::Value> Hold(ScreenshotPipeline* pipeline) { return NewInstance(pipeline); }
+	static ScreenshotPipeline* Drop(v8::Local<v8::Value> value) { WrapScreenshotPipeline* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
+	static void Free(ScreenshotPipeline* pipeline)
+	{
+		if (pipeline) { pipeline->Release(); pipeline = NULL; } // in flight tasks keep it alive
+	}
+public:
+	static v8::Local<v8::Object> NewInstance(ScreenshotPipeline* pipeline)
+	{
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::ObjectTemplate> object_template = GetObjectTemplate();
+		v8::Local<v8::Object> instance = object_template->NewInstance();
+		WrapScreenshotPipeline* wrap = new WrapScreenshotPipeline(pipeline);
+		wrap->Wrap(instance);
+		return scope.Escape(instance);
+	}
+private:
+	static v8::Local<v8::ObjectTemplate> GetObjectTemplate()
+	{
+		Nan::EscapableHandleScope scope;
+		static Nan::Persistent<v8::ObjectTemplate> g_object_template;
+		if (g_object_template.IsEmpty())
+		{
+			v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>();
+			g_object_template.Reset(object_template);
+			object_template->SetInternalFieldCount(1);
+		}
+		v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>(g_object_template);
+		return scope.Escape(object_template);
+	}
+};
+
+class TaskScreenshotEncode : public Nanx::SimpleTask
+{
+	public: ScreenshotPipeline* m_pipeline;
+	public: ScreenshotBuffer* m_buffer;
+	public: char* m_file;
+	public: bool m_worked;
+	public: int m_err;
+	public: TaskScreenshotEncode(ScreenshotPipeline* pipeline, ScreenshotBuffer* buffer, v8::Local<v8::String> file) :
+		m_pipeline(pipeline),
+		m_buffer(buffer),
+		m_file(strdup(*v8::String::Utf8Value(file))),
+		m_worked(false),
+		m_err(0)
+	{
+	}
+	public: ~TaskScreenshotEncode()
+	{
+		free(m_file); m_file = NULL; // strdup
+		if (m_pipeline)
+		{
+			// cancelled, or never queued
+			if (!m_worked) { m_pipeline->WorkDone(); }
+			m_pipeline->Recycle(m_buffer); m_buffer = NULL;
+			m_pipeline->Complete(false);
+			m_pipeline = NULL;
+		}
+	}
+	// a queued encode gives its slot back now, a capture blocked in Reserve may be waiting for it
+	public: void DoCancel()
+	{
+		m_worked = true;
+		m_pipeline->WorkDone();
+	}
+	// the buffer is still in the renderer's format, the encoders convert while they write
+	public: void DoWork()
+	{
+		int depth = 0; ::Uint32 Rmask = 0, Gmask = 0, Bmask = 0, Amask = 0;
+		SDL_PixelFormatEnumToMasks(m_buffer->format, &depth, &Rmask, &Gmask, &Bmask, &Amask);
+		SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(m_buffer->pixels, m_buffer->w, m_buffer->h, depth, m_buffer->pitch, Rmask, Gmask, Bmask, Amask);
+		SDL_RWops* dst = (surface)?(SDL_RWFromFile(m_file, "wb")):(NULL);
+		if (!dst) { m_err = -1; }
+		else if (m_pipeline->m_encoding == SDL_EXT_SCREENSHOT_QOI) { m_err = _SDL_EXT_SaveQOI_RW(surface, dst, 1); }
+		else { m_err = SDL_SaveBMP_RW(surface, dst, 1); }
+		if (m_err < 0) { SetError(SDL_GetError()); }
+		if (surface) { SDL_FreeSurface(surface); surface = NULL; } // pixels stay with the buffer
+		m_worked = true;
+		m_pipeline->WorkDone();
+	}
+	public: v8::Local<v8::Value> DoAfterWork(int status)
+	{
+		m_pipeline->Recycle(m_buffer); m_buffer = NULL;
+		m_pipeline->Complete(m_err == 0);
+		m_pipeline = NULL;
+		return Nan::New(m_err);
+	}
+};
+
+static int _ScreenshotQueue(ScreenshotPipeline* pipeline, ScreenshotBuffer* buffer, const Nan::FunctionCallbackInfo<v8::Value>& info)
+{
+	v8::Local<v8::String> file = v8::Local<v8::String>::Cast(info[2]);
+	TaskScreenshotEncode* task = new TaskScreenshotEncode(pipeline, buffer, file);
+	int id = (info[3]->IsFunction())?
+		(Nanx::SimpleTask::Run(task, v8::Local<v8::Function>::Cast(info[3]), Nanx::TASK_PRIORITY_BACKGROUND)):
+		(Nanx::SimpleTask::Run(task, Nanx::TASK_PRIORITY_BACKGROUND));
+	return id; // a task that failed to queue gave its slot and buffer back as it deleted itself
+}
+
+NANX_EXPORT(SDL_EXT_CreateScreenshotPipeline)
+{
+	int encoding = NANX_int(info[0]);
+	int max_in_flight = NANX_int(info[1]);
+	int policy = NANX_int(info[2]);
+	info.GetReturnValue().Set(WrapScreenshotPipeline::Hold(new ScreenshotPipeline(encoding, max_in_flight, policy)));
+}
+
+NANX_EXPORT(SDL_EXT_DestroyScreenshotPipeline)
+{
+	ScreenshotPipeline* pipeline = WrapScreenshotPipeline::Drop(info[0]); if (!pipeline) { return Nan::ThrowError("null ScreenshotPipeline object"); }
+	WrapScreenshotPipeline::Free(pipeline);
+}
+
+// returns the task id, 0 when dropped, or an error
+NANX_EXPORT(SDL_EXT_ScreenshotCaptureRenderer)
+{
+	ScreenshotPipeline* pipeline = WrapScreenshotPipeline::Peek(info[0]); if (!pipeline) { return Nan::ThrowError("null ScreenshotPipeline object"); }
+	WrapRenderer* wrap = WrapRenderer::Unwrap(info[1]);
+	SDL_Renderer* renderer = (wrap)?(wrap->Peek()):(NULL); if (!renderer) { return Nan::ThrowError("null SDL_Renderer object"); }
+	if (!pipeline->Reserve()) { return info.GetReturnValue().Set(Nan::New(0)); }
+	SDL_Rect viewport; _RenderOutputViewport(renderer, &viewport);
+	::Uint32 format = _RenderNativeFormat(wrap); // no conversion on this thread
+	ScreenshotBuffer* buffer = ((viewport.w > 0) && (viewport.h > 0))?(pipeline->Acquire(viewport.w, viewport.h, viewport.w * SDL_BYTESPERPIXEL(format), format)):(NULL);
+	int err = (buffer)?(SDL_RenderReadPixels(renderer, &viewport, format, buffer->pixels, buffer->pitch)):(-1);
+	if (err < 0)
+	{
+		pipeline->WorkDone();
+		pipeline->Recycle(buffer);
+		pipeline->Complete(false);
+		return info.GetReturnValue().Set(Nan::New(err));
+	}
+	++pipeline->m_captured;
+	info.GetReturnValue().Set(Nan::New(_ScreenshotQueue(pipeline, buffer, info)));
+}
+
+// for windows drawn through SDL_GetWindowSurface, not through a renderer, the two cannot share a window
+NANX_EXPORT(SDL_EXT_ScreenshotCaptureWindow)
+{
+	ScreenshotPipeline* pipeline = WrapScreenshotPipeline::Peek(info[0]); if (!pipeline) { return Nan::ThrowError("null ScreenshotPipeline object"); }
+	SDL_Window* window = WrapWindow::Peek(info[1]); if (!window) { return Nan::ThrowError("null SDL_Window object"); }
+	if (SDL_GetRenderer(window)) { return Nan::ThrowError("window has a renderer, use SDL_EXT_ScreenshotCaptureRenderer"); }
+	if (!pipeline->Reserve()) { return info.GetReturnValue().Set(Nan::New(0)); }
+	SDL_Surface* surface = _GetWindowSurface(window);
+	ScreenshotBuffer* buffer = NULL;
+	int err = -1;
+	if (surface && SDL_ISPIXELFORMAT_INDEXED(surface->format->format)) { SDL_SetError("indexed window surface"); }
+	else if (surface)
+	{
+		int row_size = surface->w * surface->format->BytesPerPixel;
+		buffer = pipeline->Acquire(surface->w, surface->h, row_size, surface->format->format);
+		if (buffer && (!SDL_MUSTLOCK(surface) || (SDL_LockSurface(surface) == 0)))
+		{
+			for (int y = 0; y < surface->h; ++y)
+			{
+				memcpy(static_cast<char*>(buffer->pixels) + y * row_size, static_cast<char*>(surface->pixels) + y * surface->pitch, row_size);
+			}
+			if (SDL_MUSTLOCK(surface)) { SDL_UnlockSurface(surface); }
+			err = 0;
+		}
+	}
+	if (err < 0)
+	{
+		pipeline->WorkDone();
+		pipeline->Recycle(buffer);
+		pipeline->Complete(false);
+		return info.GetReturnValue().Set(Nan::New(err));
+	}
+	++pipeline->m_captured;
+	info.GetReturnValue().Set(Nan::New(_ScreenshotQueue(pipeline, buffer, info)));
+}
+
+NANX_EXPORT(SDL_EXT_ScreenshotPipelineStats)
+{
+	ScreenshotPipeline* pipeline = WrapScreenshotPipeline::Peek(info[0]); if (!pipeline) { return Nan::ThrowError("null ScreenshotPipeline object"); }
+	v8::Local<v8::Object> stats = Nan::New<v8::Object>();
+	stats->Set(NANX_SYMBOL("captured"), Nan::New(pipeline->m_captured));
+	stats->Set(NANX_SYMBOL("dropped"), Nan::New(pipeline->m_dropped));
+	stats->Set(NANX_SYMBOL("written"), Nan::New(pipeline->m_written));
+	stats->Set(NANX_SYMBOL("failed"), Nan::New(pipeline->m_failed));
+	stats->Set(NANX_SYMBOL("blockedMs"), Nan::New(pipeline->m_blocked_ms));
+	stats->Set(NANX_SYMBOL("inFlight"), Nan::New(pipeline->m_in_flight));
+	stats->Set(NANX_SYMBOL("pooledBuffers"), Nan::New(pipeline->m_free_count));
+	info.GetReturnValue().Set(stats);
+}
+
+// task pool
+
+NANX_EXPORT(SDL_EXT_TaskCancel)
+{
+	int id = NANX_int(info[0]);
+	int err = Nanx::SimpleTask::Cancel(id);
+	info.GetReturnValue().Set(Nan::New(err));
+}
+
+NANX_EXPORT(SDL_EXT_TaskQueueStats)
+{
+	static const char* lane_names[Nanx::TASK_PRIORITY_COUNT] = { "interactive", "prefetch", "background" };
+	Nanx::TaskPool::Lane lanes[Nanx::TASK_PRIORITY_COUNT];
+	Nanx::TaskPool::Instance().GetLanes(lanes, Nanx::TASK_PRIORITY_COUNT);
+	v8::Local<v8::Object> stats = Nan::New<v8::Object>();
+	stats->Set(NANX_SYMBOL("threads"), Nan::New(Nanx::TaskPool::Instance().GetThreadCount()));
+	for (int index = 0; index < Nanx::TASK_PRIORITY_COUNT; ++index)
+	{
+		v8::Local<v8::Object> lane = Nan::New<v8::Object>();
+		lane->Set(NANX_SYMBOL("queued"), Nan::New(lanes[index].queued));
+		lane->Set(NANX_SYMBOL("peak"), Nan::New(lanes[index].peak));
+		lane->Set(NANX_SYMBOL("running"), Nan::New(lanes[index].running));
+		lane->Set(NANX_SYMBOL("completed"), Nan::New(lanes[index].completed));
+		lane->Set(NANX_SYMBOL("cancelled"), Nan::New(lanes[index].cancelled));
+		stats->Set(NANX_SYMBOL(lane_names[index]), lane);
+	}
+	info.GetReturnValue().Set(stats);
+}
+
+// workers and the input sampler must not outlive the environment
+static void _Teardown(void* arg)
+{
+	_InputSamplerStop(); // its thread calls into SDL, which may be gone once the process exits
+	Nanx::TaskPool::Instance().Stop();
+	ForkJoinPool::Instance().Stop();
+	_RenderBandCacheTrim();
+}
+
 NAN_MODULE_INIT(init)
 {
 	#if defined(SDL_MAIN_NEEDED) || defined(SDL_MAIN_AVAILABLE)
 	SDL_SetMainReady();
 	#endif
 
+	#if NODE_VERSION_AT_LEAST(10, 2, 0)
+	node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), _Teardown, NULL);
+	#else
+	node::AtExit(_Teardown, NULL);
+	#endif
+
 	WrapDisplayMode::Init(target);
 	WrapColor::Init(target);
 	WrapPoint::Init(target);
@@ -2184,6 +7522,75 @@ NAN_MODULE_INIT(init)
 	NANX_CONSTANT(target, SDL_AUDIO_ALLOW_ANY_CHANGE);
 
 	NANX_CONSTANT(target, SDL_MIX_MAXVOLUME);
+	NANX_EXPORT_APPLY(target, SDL_GetNumAudioDrivers);
+	NANX_EXPORT_APPLY(target, SDL_GetAudioDriver);
+	NANX_EXPORT_APPLY(target, SDL_AudioInit);
+	NANX_EXPORT_APPLY(target, SDL_AudioQuit);
+	NANX_EXPORT_APPLY(target, SDL_GetCurrentAudioDriver);
+
+	v8::Local<v8::Object> AudioStatus = Nan::New<v8::Object>();
+	target->Set(NANX_SYMBOL("SDL_AudioStatus"), AudioStatus);
+	NANX_CONSTANT(AudioStatus, SDL_AUDIO_STOPPED);
+	NANX_CONSTANT(AudioStatus, SDL_AUDIO_PLAYING);
+	NANX_CONSTANT(AudioStatus, SDL_AUDIO_PAUSED);
+
+	NANX_EXPORT_APPLY(target, SDL_GetNumAudioDevices);
+	NANX_EXPORT_APPLY(target, SDL_GetAudioDeviceName);
+	NANX_EXPORT_APPLY(target, SDL_GetAudioDeviceSpec);
+	NANX_EXPORT_APPLY(target, SDL_OpenAudioDevice);
+	NANX_EXPORT_APPLY(target, SDL_EXT_OpenOfflineAudioDevice);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceRender);
+	NANX_EXPORT_APPLY(target, SDL_CloseAudioDevice);
+	NANX_EXPORT_APPLY(target, SDL_PauseAudioDevice);
+	NANX_EXPORT_APPLY(target, SDL_GetAudioDeviceStatus);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDevicePush);
+	NANX_EXPORT_APPLY(target, SDL_QueueAudio);
+	NANX_EXPORT_APPLY(target, SDL_GetQueuedAudioSize);
+	NANX_EXPORT_APPLY(target, SDL_ClearQueuedAudio);
+	NANX_EXPORT_APPLY(target, SDL_DequeueAudio);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceFeed);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceStopFeed);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceCapture);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceStopCapture);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceRecycle);
+	NANX_CONSTANT(target, SDL_EXT_MIXER_GAIN);
+	NANX_CONSTANT(target, SDL_EXT_MIXER_PAN);
+	NANX_CONSTANT(target, SDL_EXT_MIXER_PITCH);
+	NANX_CONSTANT(target, SDL_EXT_MIXER_LOOP_START);
+	NANX_CONSTANT(target, SDL_EXT_MIXER_LOOP_END);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceCreateMixer);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceDestroyMixer);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioMixerLoadSample);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioMixerFreeSample);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioMixerPlay);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioMixerStop);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioMixerSetVoice);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioMixerSetGain);
+	NANX_EXPORT_APPLY(target, SDL_LoadWAV);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadWAVPromise);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadWAVAs);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadWAVAsPromise);
+	NANX_EXPORT_APPLY(target, SDL_NewAudioStream);
+	NANX_EXPORT_APPLY(target, SDL_AudioStreamPut);
+	NANX_EXPORT_APPLY(target, SDL_AudioStreamGet);
+	NANX_EXPORT_APPLY(target, SDL_AudioStreamAvailable);
+	NANX_EXPORT_APPLY(target, SDL_AudioStreamFlush);
+	NANX_EXPORT_APPLY(target, SDL_AudioStreamClear);
+	NANX_EXPORT_APPLY(target, SDL_FreeAudioStream);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceStats);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_CALLBACKS);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_PERIOD_US);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_JITTER_MEAN_US);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_JITTER_MAX_US);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_BUSY_MEAN_US);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_BUSY_MAX_US);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_UNDERRUNS);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_UNDERRUN_FRAMES);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_OVERRUNS);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_OVERRUN_FRAMES);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_FILL_HISTOGRAM);
+	NANX_CONSTANT(target, SDL_EXT_AUDIO_TELEMETRY_SIZE);
+	NANX_EXPORT_APPLY(target, SDL_EXT_AudioDeviceTelemetry);
 
 	// SDL_bits.h
 
@@ -2294,6 +7701,67 @@ NAN_MODULE_INIT(init)
 	NANX_CONSTANT(target, SDL_ENABLE);
 
 	// SDL_gamecontroller.h
+
+	v8::Local<v8::Object> GameControllerAxis = Nan::New<v8::Object>();
+	target->Set(NANX_SYMBOL("SDL_GameControllerAxis"), GameControllerAxis);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_INVALID);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_LEFTX);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_LEFTY);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_RIGHTX);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_RIGHTY);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_TRIGGERLEFT);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_TRIGGERRIGHT);
+	NANX_CONSTANT(GameControllerAxis, SDL_CONTROLLER_AXIS_MAX);
+
+	v8::Local<v8::Object> GameControllerButton = Nan::New<v8::Object>();
+	target->Set(NANX_SYMBOL("SDL_GameControllerButton"), GameControllerButton);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_INVALID);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_A);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_B);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_X);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_Y);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_BACK);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_GUIDE);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_START);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_LEFTSTICK);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_RIGHTSTICK);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_LEFTSHOULDER);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_RIGHTSHOULDER);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_DPAD_UP);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_DPAD_DOWN);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_DPAD_LEFT);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_DPAD_RIGHT);
+	#if SDL_VERSION_ATLEAST(2, 0, 14)
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_MISC1);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_PADDLE1);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_PADDLE2);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_PADDLE3);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_PADDLE4);
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_TOUCHPAD);
+	#endif
+	NANX_CONSTANT(GameControllerButton, SDL_CONTROLLER_BUTTON_MAX);
+
+	NANX_EXPORT_APPLY(target, SDL_GameControllerAddMapping);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerAddMappingsFromFile);
+	NANX_EXPORT_APPLY(target, SDL_EXT_GameControllerAddMappingsFromFilePromise);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerMapping);
+	NANX_EXPORT_APPLY(target, SDL_IsGameController);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerNameForIndex);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerOpen);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerName);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerGetAttached);
+	NANX_EXPORT_APPLY(target, SDL_EXT_GameControllerInstanceID);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerUpdate);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerGetAxis);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerGetButton);
+	NANX_EXPORT_APPLY(target, SDL_GameControllerClose);
+	NANX_CONSTANT(target, SDL_EXT_GAMECONTROLLER_SNAPSHOT_ATTACHED);
+	NANX_CONSTANT(target, SDL_EXT_GAMECONTROLLER_SNAPSHOT_INSTANCE_ID);
+	NANX_CONSTANT(target, SDL_EXT_GAMECONTROLLER_SNAPSHOT_AXES);
+	NANX_CONSTANT(target, SDL_EXT_GAMECONTROLLER_SNAPSHOT_BUTTONS);
+	NANX_CONSTANT(target, SDL_EXT_GAMECONTROLLER_SNAPSHOT_STRIDE);
+	NANX_EXPORT_APPLY(target, SDL_EXT_GameControllerSnapshot);
+
 	// SDL_gesture.h
 	// SDL_haptic.h
 
@@ -2425,6 +7893,23 @@ NAN_MODULE_INIT(init)
 	NANX_EXPORT_APPLY(target, SDL_JoystickGetHat);
 	NANX_EXPORT_APPLY(target, SDL_JoystickGetButton);
 	NANX_EXPORT_APPLY(target, SDL_JoystickClose);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_ATTACHED);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_INSTANCE_ID);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_NUM_AXES);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_NUM_BUTTONS);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_NUM_HATS);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_NUM_BALLS);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_AXES);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_BUTTONS);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_HATS);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_BALLS);
+	NANX_CONSTANT(target, SDL_EXT_JOYSTICK_SNAPSHOT_STRIDE);
+	NANX_EXPORT_APPLY(target, SDL_EXT_JoystickSnapshot);
+	NANX_EXPORT_APPLY(target, SDL_EXT_InputSamplerStart);
+	NANX_EXPORT_APPLY(target, SDL_EXT_InputSamplerStop);
+	NANX_EXPORT_APPLY(target, SDL_EXT_InputSamplerLatest);
+	NANX_EXPORT_APPLY(target, SDL_EXT_InputSamplerRead);
+	NANX_EXPORT_APPLY(target, SDL_EXT_InputSamplerStats);
 
 	// SDL_keyboard.h
 	// SDL_keycode.h
@@ -2886,30 +8371,36 @@ NAN_MODULE_INIT(init)
 	NANX_CONSTANT(RendererFlip, SDL_FLIP_HORIZONTAL);
 	NANX_CONSTANT(RendererFlip, SDL_FLIP_VERTICAL);
 
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetNumRenderDrivers);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetRenderDriverInfo);
+	NANX_EXPORT_APPLY(target, SDL_GetNumRenderDrivers);
+	NANX_EXPORT_APPLY(target, SDL_GetRenderDriverInfo);
+	NANX_EXPORT_APPLY(target, SDL_EXT_SelectRenderDriver);
 	// TODO: NANX_EXPORT_APPLY(target, SDL_CreateWindowAndRenderer);
 	NANX_EXPORT_APPLY(target, SDL_CreateRenderer);
 	NANX_EXPORT_APPLY(target, SDL_CreateSoftwareRenderer);
 	// TODO: NANX_EXPORT_APPLY(target, SDL_GetRenderer);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetRendererInfo);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetRendererOutputSize);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_CreateTexture);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_CreateTextureFromSurface);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_QueryTexture);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_SetTextureColorMod);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetTextureColorMod);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_SetTextureAlphaMod);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetTextureAlphaMod);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_SetTextureBlendMode);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetTextureBlendMode);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_UpdateTexture);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_UpdateYUVTexture);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_LockTexture);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_UnlockTexture);
+	NANX_EXPORT_APPLY(target, SDL_GetRendererInfo);
+	NANX_EXPORT_APPLY(target, SDL_GetRendererOutputSize);
+	NANX_EXPORT_APPLY(target, SDL_CreateTexture);
+	NANX_EXPORT_APPLY(target, SDL_CreateTextureFromSurface);
+	NANX_EXPORT_APPLY(target, SDL_QueryTexture);
+	NANX_EXPORT_APPLY(target, SDL_SetTextureColorMod);
+	NANX_EXPORT_APPLY(target, SDL_GetTextureColorMod);
+	NANX_EXPORT_APPLY(target, SDL_SetTextureAlphaMod);
+	NANX_EXPORT_APPLY(target, SDL_GetTextureAlphaMod);
+	NANX_EXPORT_APPLY(target, SDL_SetTextureBlendMode);
+	NANX_EXPORT_APPLY(target, SDL_GetTextureBlendMode);
+	NANX_EXPORT_APPLY(target, SDL_UpdateTexture);
+	NANX_EXPORT_APPLY(target, SDL_UpdateYUVTexture);
+	NANX_EXPORT_APPLY(target, SDL_UpdateNVTexture);
+	NANX_CONSTANT(target, SDL_EXT_YUV_BT601);
+	NANX_CONSTANT(target, SDL_EXT_YUV_BT709);
+	NANX_CONSTANT(target, SDL_EXT_YUV_JPEG);
+	NANX_EXPORT_APPLY(target, SDL_EXT_ConvertYUV);
+	NANX_EXPORT_APPLY(target, SDL_LockTexture);
+	NANX_EXPORT_APPLY(target, SDL_UnlockTexture);
 	NANX_EXPORT_APPLY(target, SDL_RenderTargetSupported);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_SetRenderTarget);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_GetRenderTarget);
+	NANX_EXPORT_APPLY(target, SDL_SetRenderTarget);
+	NANX_EXPORT_APPLY(target, SDL_GetRenderTarget);
 	NANX_EXPORT_APPLY(target, SDL_RenderSetLogicalSize);
 	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderGetLogicalSize);
 	#if SDL_VERSION_ATLEAST(2, 0, 5)
@@ -2928,18 +8419,54 @@ NAN_MODULE_INIT(init)
 	// TODO: NANX_EXPORT_APPLY(target, SDL_GetRenderDrawBlendMode);
 	NANX_EXPORT_APPLY(target, SDL_RenderClear);
 	NANX_EXPORT_APPLY(target, SDL_RenderDrawPoint);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderDrawPoints);
+	NANX_EXPORT_APPLY(target, SDL_RenderDrawPoints);
 	NANX_EXPORT_APPLY(target, SDL_RenderDrawLine);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderDrawLines);
+	NANX_EXPORT_APPLY(target, SDL_RenderDrawLines);
 	NANX_EXPORT_APPLY(target, SDL_RenderDrawRect);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderDrawRects);
+	NANX_EXPORT_APPLY(target, SDL_RenderDrawRects);
 	NANX_EXPORT_APPLY(target, SDL_RenderFillRect);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderFillRects);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderCopy);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderCopyEx);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_RenderReadPixels);
+	NANX_EXPORT_APPLY(target, SDL_RenderFillRects);
+	NANX_EXPORT_APPLY(target, SDL_RenderCopy);
+	NANX_EXPORT_APPLY(target, SDL_RenderCopyEx);
+	NANX_CONSTANT(target, SDL_EXT_BATCH_STRIDE);
+	NANX_CONSTANT(target, SDL_EXT_BATCH_SORT);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderCopyBatch);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_CLEAR);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_SET_COLOR);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_SET_BLEND);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_SET_VIEWPORT);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_SET_CLIP);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_POINT);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_LINE);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_RECT);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_FILL_RECT);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_POINTS);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_LINES);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_RECTS);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_FILL_RECTS);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_COPY);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_COPY_EX);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_TEXTURE_COLOR);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_TEXTURE_ALPHA);
+	NANX_CONSTANT(target, SDL_EXT_RCMD_TEXTURE_BLEND);
+	NANX_EXPORT_APPLY(target, SDL_EXT_CreateRenderCommandBuffer);
+	NANX_EXPORT_APPLY(target, SDL_EXT_DestroyRenderCommandBuffer);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderCommandBufferSetTexture);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderCommandBufferSubmit);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderCommandBufferSubmitTiled);
+	NANX_EXPORT_APPLY(target, SDL_EXT_CreateRenderLayer);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderLayerIsDirty);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderLayerInvalidate);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderInvalidateLayers);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderLayerBegin);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderLayerEnd);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderLayerUpdate);
+	NANX_EXPORT_APPLY(target, SDL_RenderReadPixels);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderReadPixelsAsync);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderReadPixelsPromise);
+	NANX_EXPORT_APPLY(target, SDL_EXT_RenderReadPixelsTrim);
 	NANX_EXPORT_APPLY(target, SDL_RenderPresent);
-	// TODO: NANX_EXPORT_APPLY(target, SDL_DestroyTexture);
+	NANX_EXPORT_APPLY(target, SDL_DestroyTexture);
 	NANX_EXPORT_APPLY(target, SDL_DestroyRenderer);
 	// TODO: NANX_EXPORT_APPLY(target, SDL_GL_BindTexture);
 	// TODO: NANX_EXPORT_APPLY(target, SDL_GL_UnbindTexture);
@@ -2984,7 +8511,18 @@ NAN_MODULE_INIT(init)
 	#endif
 	NANX_EXPORT_APPLY(target, SDL_FreeSurface);
 	NANX_EXPORT_APPLY(target, SDL_LoadBMP);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadBMPPromise);
 	NANX_EXPORT_APPLY(target, SDL_SaveBMP);
+	NANX_EXPORT_APPLY(target, SDL_EXT_SaveBMPPromise);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadBMPInto_RW);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadBMPInto);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadBMPIntoPromise);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadQOI_RW);
+	NANX_EXPORT_APPLY(target, SDL_EXT_SaveQOI_RW);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadQOI);
+	NANX_EXPORT_APPLY(target, SDL_EXT_LoadQOIPromise);
+	NANX_EXPORT_APPLY(target, SDL_EXT_SaveQOI);
+	NANX_EXPORT_APPLY(target, SDL_EXT_SaveQOIPromise);
 	NANX_EXPORT_APPLY(target, SDL_SetSurfaceBlendMode);
 	NANX_EXPORT_APPLY(target, SDL_ConvertSurfaceFormat);
 	NANX_EXPORT_APPLY(target, SDL_FillRect);
@@ -3180,6 +8718,16 @@ NAN_MODULE_INIT(init)
 	NANX_EXPORT_APPLY(target, SDL_MinimizeWindow);
 	NANX_EXPORT_APPLY(target, SDL_RestoreWindow);
 	NANX_EXPORT_APPLY(target, SDL_SetWindowFullscreen);
+	NANX_EXPORT_APPLY(target, SDL_GetWindowSurface);
+	NANX_EXPORT_APPLY(target, SDL_UpdateWindowSurface);
+	NANX_EXPORT_APPLY(target, SDL_UpdateWindowSurfaceRects);
+	NANX_EXPORT_APPLY(target, SDL_EXT_CreateDirtyRects);
+	NANX_EXPORT_APPLY(target, SDL_EXT_DestroyDirtyRects);
+	NANX_EXPORT_APPLY(target, SDL_EXT_DirtyRectsSetThreshold);
+	NANX_EXPORT_APPLY(target, SDL_EXT_DirtyRectsAdd);
+	NANX_EXPORT_APPLY(target, SDL_EXT_DirtyRectsClear);
+	NANX_EXPORT_APPLY(target, SDL_EXT_UpdateWindowSurfaceDirty);
+	NANX_EXPORT_APPLY(target, SDL_EXT_DirtyRectsStats);
 	NANX_EXPORT_APPLY(target, SDL_SetWindowGrab);
 	NANX_EXPORT_APPLY(target, SDL_GetWindowGrab);
 	NANX_EXPORT_APPLY(target, SDL_SetWindowBrightness);
@@ -3203,8 +8751,25 @@ NAN_MODULE_INIT(init)
 	NANX_EXPORT_APPLY(target, SDL_GL_DeleteContext);
 
 	NANX_EXPORT_APPLY(target, SDL_EXT_SurfaceToImageDataAsync);
+	NANX_EXPORT_APPLY(target, SDL_EXT_SurfaceToImageDataPromise);
 	NANX_EXPORT_APPLY(target, SDL_EXT_SurfaceToImageData);
 	NANX_EXPORT_APPLY(target, SDL_EXT_ImageDataToSurface);
+
+	NANX_CONSTANT(target, SDL_EXT_SCREENSHOT_BMP);
+	NANX_CONSTANT(target, SDL_EXT_SCREENSHOT_QOI);
+	NANX_CONSTANT(target, SDL_EXT_SCREENSHOT_DROP);
+	NANX_CONSTANT(target, SDL_EXT_SCREENSHOT_BLOCK);
+	NANX_EXPORT_APPLY(target, SDL_EXT_CreateScreenshotPipeline);
+	NANX_EXPORT_APPLY(target, SDL_EXT_DestroyScreenshotPipeline);
+	NANX_EXPORT_APPLY(target, SDL_EXT_ScreenshotCaptureRenderer);
+	NANX_EXPORT_APPLY(target, SDL_EXT_ScreenshotCaptureWindow);
+	NANX_EXPORT_APPLY(target, SDL_EXT_ScreenshotPipelineStats);
+
+	NANX_CONSTANT_VALUE(target, SDL_EXT_TASK_PRIORITY_INTERACTIVE, static_cast<int>(Nanx::TASK_PRIORITY_INTERACTIVE));
+	NANX_CONSTANT_VALUE(target, SDL_EXT_TASK_PRIORITY_PREFETCH, static_cast<int>(Nanx::TASK_PRIORITY_PREFETCH));
+	NANX_CONSTANT_VALUE(target, SDL_EXT_TASK_PRIORITY_BACKGROUND, static_cast<int>(Nanx::TASK_PRIORITY_BACKGROUND));
+	NANX_EXPORT_APPLY(target, SDL_EXT_TaskCancel);
+	NANX_EXPORT_APPLY(target, SDL_EXT_TaskQueueStats);
 }
 
 } // namespace node_sdl2
@@ -29,6 +29,8 @@
 
 #include <nan.h>
 
+#include <limits.h>
+
 #include <SDL.h>
 
 // nan extensions
@@ -105,33 +107,351 @@
 
 namespace Nanx {
 
+// task priority lanes, a lower lane always runs first
+
+enum TaskPriority
+{
+	TASK_PRIORITY_INTERACTIVE = 0, // user facing loads
+	TASK_PRIORITY_PREFETCH = 1,
+	TASK_PRIORITY_BACKGROUND = 2,
+	TASK_PRIORITY_COUNT = 3
+};
+
+#define NANX_TaskPriority(value)		(((value)->IsNumber())?(static_cast<Nanx::TaskPriority>((value)->Int32Value())):(Nanx::TASK_PRIORITY_INTERACTIVE))
+
+class SimpleTask;
+
+// a binding owned worker pool, keeps SDL work out of the libuv thread pool
+// worker 0 only takes interactive tasks, so a prefetch storm can not starve user facing loads
+
+class TaskPool
+{
+	public: enum { MAX_THREADS = 8 };
+	public: struct Lane
+	{
+		SimpleTask* head;
+		SimpleTask* tail;
+		unsigned int queued; // current depth
+		unsigned int peak; // high water depth
+		unsigned int running;
+		double completed;
+		double cancelled;
+	};
+	private: bool m_started;
+	private: bool m_stopping; // guarded by m_mutex
+	private: uv_mutex_t m_mutex;
+	private: uv_cond_t m_cond;
+	private: uv_async_t m_async;
+	private: uv_thread_t m_threads[MAX_THREADS];
+	private: SimpleTask* m_current[MAX_THREADS]; // task running on each worker
+	private: int m_thread_count;
+	private: Lane m_lanes[TASK_PRIORITY_COUNT];
+	private: SimpleTask* m_done_head;
+	private: SimpleTask* m_done_tail;
+	private: unsigned int m_pending; // tasks not yet completed, main thread only
+	private: int m_next_id;
+	private: TaskPool() : m_started(false), m_stopping(false), m_thread_count(0), m_done_head(NULL), m_done_tail(NULL), m_pending(0), m_next_id(1)
+	{
+		memset(m_current, 0, sizeof(m_current));
+		memset(m_lanes, 0, sizeof(m_lanes));
+	}
+	public: static TaskPool& Instance() { static TaskPool pool; return pool; }
+	public: int GetThreadCount() const { return m_thread_count; }
+	public: inline int Queue(SimpleTask* task, TaskPriority priority); // returns task id or error
+	public: inline int Cancel(int id); // 0, UV_EBUSY if running, UV_ENOENT if unknown or done
+	public: inline void GetLanes(Lane* lanes, int count);
+	public: inline void Stop(); // joins the workers at teardown, queued tasks are abandoned
+	private: inline int Start();
+	private: inline SimpleTask* Pop(int priority);
+	private: inline void PushDone(SimpleTask* task);
+	private: static inline void _Thread(void* arg);
+	#if UV_VERSION_MAJOR >= 1
+	private: static inline void _Done(uv_async_t* async);
+	#else
+	private: static inline void _Done(uv_async_t* async, int status);
+	#endif
+};
+
 // a simple asynchronous task
+// completes through either a callback, called as callback(result[, error]),
+// or a promise, resolved with result or rejected with an Error(error)
+// either way completion runs in the task's async scope, so node drains ticks and microtasks after it
 
 class SimpleTask
 {
-	private: uv_work_t m_work;
-	protected: SimpleTask() { m_work.data = this; }
-	protected: virtual ~SimpleTask() { m_work.data = NULL; }
+	friend class TaskPool;
+	private: SimpleTask* m_next; // lane or done list link
+	private: int m_id;
+	private: int m_priority;
+	private: int m_status;
+	private: Nan::Persistent<v8::Function> m_callback;
+	private: Nan::Persistent<v8::Promise::Resolver> m_resolver;
+	private: Nan::AsyncResource* m_async_resource;
+	private: char* m_error;
+	protected: SimpleTask() : m_next(NULL), m_id(0), m_priority(TASK_PRIORITY_INTERACTIVE), m_status(0), m_async_resource(NULL), m_error(NULL) {}
+	protected: virtual ~SimpleTask()
+	{
+		m_next = NULL;
+		m_callback.Reset();
+		m_resolver.Reset();
+		delete m_async_resource; m_async_resource = NULL;
+		free(m_error); m_error = NULL; // strdup
+	}
 	private: virtual void DoWork() = 0;
-	private: virtual void DoAfterWork(int status) = 0;
-	public: static int Run(SimpleTask* task)
+	private: virtual v8::Local<v8::Value> DoAfterWork(int status) = 0; // returns the result, only called once DoWork ran
+	private: virtual void DoCancel() {} // loop thread, as soon as a queued task is cancelled, for state other work waits on
+	protected: bool HasError() const { return m_error != NULL; }
+	protected: void SetError(const char* error)
+	{
+		// call from DoWork with SDL_GetError(), SDL keeps the error per thread
+		free(m_error); m_error = strdup((error && *error)?(error):("unknown error"));
+	}
+	// returns the task id for Cancel, or a negative error
+	public: static int Run(SimpleTask* task, v8::Local<v8::Function> callback, TaskPriority priority = TASK_PRIORITY_INTERACTIVE)
+	{
+		task->m_callback.Reset(callback);
+		return Queue(task, priority);
+	}
+	// no completion callback, for tasks that report through their own state
+	public: static int Run(SimpleTask* task, TaskPriority priority = TASK_PRIORITY_INTERACTIVE)
 	{
-		int err = uv_queue_work(uv_default_loop(), &task->m_work, _Work, (uv_after_work_cb) _AfterWork);
-		if (err != 0) { delete task; task = NULL; } // self destruct
-		return err;
+		return Queue(task, priority);
 	}
-	private: static void _Work(uv_work_t *work)
+	// returns a promise with the task id as its id property
+	public: static v8::Local<v8::Value> RunPromise(SimpleTask* task, TaskPriority priority = TASK_PRIORITY_INTERACTIVE)
 	{
-		SimpleTask* task = static_cast<SimpleTask*>(work->data);
-		if (task) { task->DoWork(); }
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+		v8::Local<v8::Promise> promise = resolver->GetPromise();
+		task->m_resolver.Reset(resolver);
+		int id = Queue(task, priority);
+		if (id < 0)
+		{
+			resolver->Reject(Nan::GetCurrentContext(), Nan::Error(uv_strerror(id))).FromJust();
+		}
+		else
+		{
+			promise->Set(NANX_SYMBOL("id"), Nan::New(id));
+		}
+		return scope.Escape(promise);
 	}
-	private: static void _AfterWork(uv_work_t *work, int status)
+	// a cancelled task completes with a null result and an "operation canceled" error,
+	// DoWork and DoAfterWork are never called so its destructor cleans up
+	public: static int Cancel(int id)
 	{
-		SimpleTask* task = static_cast<SimpleTask*>(work->data);
-		if (task) { task->DoAfterWork(status); delete task; task = NULL; work = NULL; } // self destruct
+		return TaskPool::Instance().Cancel(id);
+	}
+	private: static int Queue(SimpleTask* task, TaskPriority priority)
+	{
+		task->m_async_resource = new Nan::AsyncResource("node-sdl2:SimpleTask");
+		int id = TaskPool::Instance().Queue(task, priority);
+		if (id < 0) { delete task; task = NULL; } // self destruct
+		return id;
+	}
+	private: void Complete(int status)
+	{
+		Nan::HandleScope scope;
+		if ((status != 0) && !HasError()) { SetError(uv_strerror(status)); }
+		v8::Local<v8::Value> result = (status == UV_ECANCELED)?(v8::Local<v8::Value>(Nan::Null())):(DoAfterWork(status));
+		if (!m_resolver.IsEmpty())
+		{
+			// settled from inside the async scope, the reactions run when node drains the microtask queue
+			v8::Local<v8::Value> argv[] = { Nan::New<v8::Promise::Resolver>(m_resolver), (HasError())?(Nan::Error(m_error)):(result), Nan::New(HasError()) };
+			m_async_resource->runInAsyncScope(Nan::GetCurrentContext()->Global(), Nan::New<v8::Function>(_Settle), 3, argv);
+		}
+		else if (!m_callback.IsEmpty())
+		{
+			// the result comes first even on error, so callers checking err < 0 keep working
+			v8::Local<v8::Value> argv[] = { result, (HasError())?(v8::Local<v8::Value>(NANX_STRING(m_error))):(v8::Local<v8::Value>(Nan::Undefined())) };
+			int argc = (HasError())?(2):(1);
+			m_async_resource->runInAsyncScope(Nan::GetCurrentContext()->Global(), Nan::New<v8::Function>(m_callback), argc, argv);
+		}
+	}
+	// settle(resolver, value, rejected)
+	private: static NAN_METHOD(_Settle)
+	{
+		v8::Local<v8::Promise::Resolver> resolver = v8::Local<v8::Promise::Resolver>::Cast(info[0]);
+		if (info[2]->BooleanValue())
+		{
+			resolver->Reject(Nan::GetCurrentContext(), info[1]).FromJust();
+		}
+		else
+		{
+			resolver->Resolve(Nan::GetCurrentContext(), info[1]).FromJust();
+		}
 	}
 };
 
+int TaskPool::Start()
+{
+	int err = 0;
+	uv_mutex_init(&m_mutex);
+	uv_cond_init(&m_cond);
+	err = uv_async_init(uv_default_loop(), &m_async, _Done); if (err != 0) { return err; }
+	uv_unref(reinterpret_cast<uv_handle_t*>(&m_async)); // only hold the loop open while tasks are pending
+	int count = 1 + SDL_max(1, SDL_GetCPUCount() - 1); // interactive worker + shared workers
+	count = SDL_min(count, static_cast<int>(MAX_THREADS));
+	for (int index = 0; index < count; ++index)
+	{
+		err = uv_thread_create(&m_threads[m_thread_count], _Thread, reinterpret_cast<void*>(static_cast<intptr_t>(index)));
+		if (err != 0) { break; }
+		++m_thread_count;
+	}
+	if (m_thread_count == 0) { return err; }
+	m_started = true;
+	return 0;
+}
+
+void TaskPool::Stop()
+{
+	if (!m_started) { return; }
+	uv_mutex_lock(&m_mutex);
+	m_stopping = true;
+	uv_cond_broadcast(&m_cond);
+	uv_mutex_unlock(&m_mutex);
+	for (int index = 0; index < m_thread_count; ++index)
+	{
+		uv_thread_join(&m_threads[index]); // waits for a running DoWork
+	}
+	m_thread_count = 0;
+	m_started = false;
+	// script is going away, tasks left in the lanes or the done list are not completed
+	uv_close(reinterpret_cast<uv_handle_t*>(&m_async), NULL);
+}
+
+int TaskPool::Queue(SimpleTask* task, TaskPriority priority)
+{
+	if (m_stopping) { return UV_ECANCELED; }
+	if (!m_started) { int err = Start(); if (err != 0) { return err; } }
+	int lane_index = SDL_max(0, SDL_min(static_cast<int>(priority), TASK_PRIORITY_COUNT - 1));
+	task->m_id = m_next_id; m_next_id = (m_next_id == INT_MAX)?(1):(m_next_id + 1);
+	task->m_priority = lane_index;
+	task->m_next = NULL;
+	uv_mutex_lock(&m_mutex);
+	Lane& lane = m_lanes[lane_index];
+	if (lane.tail) { lane.tail->m_next = task; } else { lane.head = task; }
+	lane.tail = task;
+	++lane.queued; lane.peak = SDL_max(lane.peak, lane.queued);
+	uv_cond_broadcast(&m_cond); // worker 0 may not take this lane
+	uv_mutex_unlock(&m_mutex);
+	if (m_pending++ == 0) { uv_ref(reinterpret_cast<uv_handle_t*>(&m_async)); }
+	return task->m_id;
+}
+
+int TaskPool::Cancel(int id)
+{
+	if (!m_started || (id <= 0)) { return UV_ENOENT; }
+	int err = UV_ENOENT;
+	SimpleTask* cancelled = NULL;
+	uv_mutex_lock(&m_mutex);
+	for (int index = 0; index < m_thread_count; ++index)
+	{
+		if (m_current[index] && (m_current[index]->m_id == id)) { err = UV_EBUSY; break; }
+	}
+	for (int lane_index = 0; (err == UV_ENOENT) && (lane_index < TASK_PRIORITY_COUNT); ++lane_index)
+	{
+		Lane& lane = m_lanes[lane_index];
+		for (SimpleTask* prev = NULL, * task = lane.head; task; prev = task, task = task->m_next)
+		{
+			if (task->m_id != id) { continue; }
+			if (prev) { prev->m_next = task->m_next; } else { lane.head = task->m_next; }
+			if (lane.tail == task) { lane.tail = prev; }
+			--lane.queued; ++lane.cancelled;
+			task->m_status = UV_ECANCELED;
+			PushDone(task); // complete on the next loop turn, never from inside Cancel
+			cancelled = task;
+			err = 0;
+			break;
+		}
+	}
+	uv_mutex_unlock(&m_mutex);
+	if (cancelled) { cancelled->DoCancel(); } // completion also runs on this thread, so the task is still alive
+	if (err == 0) { uv_async_send(&m_async); }
+	return err;
+}
+
+void TaskPool::GetLanes(Lane* lanes, int count)
+{
+	if (!m_started) { memset(lanes, 0, sizeof(Lane) * count); return; }
+	uv_mutex_lock(&m_mutex);
+	for (int index = 0; index < count; ++index)
+	{
+		lanes[index] = m_lanes[index];
+		lanes[index].head = lanes[index].tail = NULL;
+	}
+	uv_mutex_unlock(&m_mutex);
+}
+
+SimpleTask* TaskPool::Pop(int priority)
+{
+	Lane& lane = m_lanes[priority];
+	SimpleTask* task = lane.head;
+	if (task)
+	{
+		lane.head = task->m_next; if (!lane.head) { lane.tail = NULL; }
+		task->m_next = NULL;
+		--lane.queued;
+	}
+	return task;
+}
+
+void TaskPool::PushDone(SimpleTask* task)
+{
+	task->m_next = NULL;
+	if (m_done_tail) { m_done_tail->m_next = task; } else { m_done_head = task; }
+	m_done_tail = task;
+}
+
+void TaskPool::_Thread(void* arg)
+{
+	TaskPool& pool = Instance();
+	int index = static_cast<int>(reinterpret_cast<intptr_t>(arg));
+	int lane_count = (index == 0)?(1):(TASK_PRIORITY_COUNT); // worker 0 is reserved for interactive tasks
+	uv_mutex_lock(&pool.m_mutex);
+	while (!pool.m_stopping)
+	{
+		SimpleTask* task = NULL;
+		for (int lane_index = 0; !task && (lane_index < lane_count); ++lane_index)
+		{
+			task = pool.Pop(lane_index);
+		}
+		if (!task) { uv_cond_wait(&pool.m_cond, &pool.m_mutex); continue; }
+		Lane& lane = pool.m_lanes[task->m_priority];
+		++lane.running;
+		pool.m_current[index] = task;
+		uv_mutex_unlock(&pool.m_mutex);
+		task->DoWork();
+		uv_mutex_lock(&pool.m_mutex);
+		pool.m_current[index] = NULL;
+		--lane.running; ++lane.completed;
+		pool.PushDone(task);
+		uv_async_send(&pool.m_async);
+	}
+	uv_mutex_unlock(&pool.m_mutex);
+}
+
+#if UV_VERSION_MAJOR >= 1
+void TaskPool::_Done(uv_async_t* async)
+#else
+void TaskPool::_Done(uv_async_t* async, int status)
+#endif
+{
+	TaskPool& pool = Instance();
+	uv_mutex_lock(&pool.m_mutex);
+	SimpleTask* task = pool.m_done_head;
+	pool.m_done_head = pool.m_done_tail = NULL;
+	uv_mutex_unlock(&pool.m_mutex);
+	while (task)
+	{
+		SimpleTask* next = task->m_next;
+		task->m_next = NULL;
+		task->Complete(task->m_status);
+		delete task; task = NULL; // self destruct
+		task = next;
+		if (--pool.m_pending == 0) { uv_unref(reinterpret_cast<uv_handle_t*>(&pool.m_async)); }
+	}
+}
+
 } // namespace Nanx
 
 namespace node_sdl2 {
@@ -667,10 +987,7 @@ public:
 public:
 	static v8::Local<v8::Value> Hold(SDL_Window* window) { return NewInstance(window); }
 	static SDL_Window* Drop(v8::Local<v8::Value> value) { WrapWindow* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
-	static void Free(SDL_Window* window)
-	{
-		if (window) { SDL_DestroyWindow(window); window = NULL; }
-	}
+	static inline void Free(SDL_Window* window);
 public:
 	static v8::Local<v8::Object> NewInstance(SDL_Window* window)
 	{
@@ -752,12 +1069,39 @@ class WrapSurface : public Nan::ObjectWrap
 {
 private:
 	SDL_Surface* m_surface;
+	SDL_Window* m_window; // set while this borrows the window's surface, which SDL frees on resize or destroy
 public:
-	WrapSurface(SDL_Surface* surface) : m_surface(surface) {}
-	~WrapSurface() { Free(m_surface); m_surface = NULL; }
+	WrapSurface(SDL_Surface* surface, SDL_Window* window = NULL) : m_surface(surface), m_window(window) {}
+	~WrapSurface()
+	{
+		if (m_window) { InvalidateWindowSurface(m_window); } // never freed here, the window owns it
+		else { Free(m_surface); }
+		m_surface = NULL;
+	}
 public:
 	SDL_Surface* Peek() { return m_surface; }
 	SDL_Surface* Drop() { SDL_Surface* surface = m_surface; m_surface = NULL; return surface; }
+	// the window keeps a pointer to the wrapper borrowing its surface, see SDL_GetWindowSurface
+	static v8::Local<v8::Value> HoldWindowSurface(SDL_Window* window, SDL_Surface* surface)
+	{
+		InvalidateWindowSurface(window);
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::Object> instance = GetObjectTemplate()->NewInstance();
+		WrapSurface* wrap = new WrapSurface(surface, window);
+		wrap->Wrap(instance);
+		SDL_SetWindowData(window, "node-sdl2-surface", wrap);
+		return scope.Escape(instance);
+	}
+	static void InvalidateWindowSurface(SDL_Window* window)
+	{
+		WrapSurface* wrap = static_cast<WrapSurface*>(SDL_SetWindowData(window, "node-sdl2-surface", NULL));
+		if (wrap) { wrap->m_surface = NULL; wrap->m_window = NULL; }
+	}
+	static SDL_Surface* BorrowedWindowSurface(SDL_Window* window)
+	{
+		WrapSurface* wrap = static_cast<WrapSurface*>(SDL_GetWindowData(window, "node-sdl2-surface"));
+		return (wrap)?(wrap->m_surface):(NULL);
+	}
 public:
 	static WrapSurface* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
 	static WrapSurface* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapSurface>(object); }
@@ -802,18 +1146,62 @@ private:
 	NANX_MEMBER_UINT32_GET(::Uint32, pitch)
 };
 
+void WrapWindow::Free(SDL_Window* window)
+{
+	if (window) { WrapSurface::InvalidateWindowSurface(window); SDL_DestroyWindow(window); window = NULL; }
+}
+
 // wrap SDL_Renderer pointer
 
+class WrapTexture;
+
 class WrapRenderer : public Nan::ObjectWrap
 {
 private:
 	SDL_Renderer* m_renderer;
+	WrapTexture* m_textures; // textures created by this renderer
 public:
-	WrapRenderer(SDL_Renderer* renderer) : m_renderer(renderer) {}
-	~WrapRenderer() { Free(m_renderer); m_renderer = NULL; }
+	static const int MAX_LAYER_DEPTH = 8;
+private:
+	SDL_Texture* m_layers[MAX_LAYER_DEPTH]; // layers being drawn, innermost last
+	SDL_Texture* m_layer_restore[MAX_LAYER_DEPTH]; // render target to restore after drawing each layer
+	int m_layer_depth;
+	SDL_RendererInfo m_info;
+	bool m_has_info;
+public:
+	WrapRenderer(SDL_Renderer* renderer) : m_renderer(renderer), m_textures(NULL), m_layer_depth(0), m_has_info(false) {}
+	~WrapRenderer() { InvalidateTextures(); Free(m_renderer); m_renderer = NULL; }
 public:
 	SDL_Renderer* Peek() { return m_renderer; }
 	SDL_Renderer* Drop() { SDL_Renderer* renderer = m_renderer; m_renderer = NULL; return renderer; }
+	// queried once for the name, texture formats and max texture size, which do not change over the renderer's life
+	// the flags are as created and may be stale, PRESENTVSYNC can be toggled later, query SDL_GetRendererInfo for them
+	const SDL_RendererInfo* GetInfo()
+	{
+		if (!m_has_info && m_renderer) { m_has_info = (SDL_GetRendererInfo(m_renderer, &m_info) == 0); }
+		return (m_has_info && m_renderer)?(&m_info):(NULL);
+	}
+	inline void AddTexture(WrapTexture* texture);
+	inline void RemoveTexture(WrapTexture* texture);
+	inline void InvalidateTextures(); // SDL_DestroyRenderer destroys the textures too
+	inline WrapTexture* FindTexture(SDL_Texture* texture);
+	inline void InvalidateLayers();
+	int GetLayerDepth() { return m_layer_depth; }
+	bool PushLayer(SDL_Texture* layer, SDL_Texture* restore)
+	{
+		if (m_layer_depth >= MAX_LAYER_DEPTH) { return false; }
+		m_layers[m_layer_depth] = layer; m_layer_restore[m_layer_depth] = restore; ++m_layer_depth;
+		return true;
+	}
+	bool PopLayer(SDL_Texture** layer, SDL_Texture** restore)
+	{
+		if (m_layer_depth <= 0) { return false; }
+		--m_layer_depth; *layer = m_layers[m_layer_depth]; *restore = m_layer_restore[m_layer_depth];
+		return true;
+	}
+	// counts SDL_RENDER_TARGETS_RESET and SDL_RENDER_DEVICE_RESET events, layers drawn before the last one are lost
+	static unsigned int& TargetsResetCount() { static unsigned int count = 0; return count; }
+	static void TargetsReset() { ++TargetsResetCount(); }
 public:
 	static WrapRenderer* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
 	static WrapRenderer* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapRenderer>(object); }
@@ -851,18 +1239,163 @@ private:
 	}
 };
 
+// wrap SDL_Texture pointer, owned by its renderer
+
+class WrapTexture : public Nan::ObjectWrap
+{
+	friend class WrapRenderer;
+private:
+	SDL_Texture* m_texture;
+	WrapRenderer* m_renderer; // owner, kept alive by m_hold_renderer
+	Nan::Persistent<v8::Value> m_hold_renderer;
+	WrapTexture* m_prev;
+	WrapTexture* m_next;
+	Nan::Persistent<v8::Object> m_locked; // ArrayBuffer over the locked pixels
+	bool m_dirty; // layer content must be redrawn
+	unsigned int m_reset_count; // WrapRenderer::TargetsResetCount() when the layer was drawn
+public:
+	WrapTexture(SDL_Texture* texture, v8::Local<v8::Value> renderer) :
+		m_texture(texture), m_renderer(NULL), m_prev(NULL), m_next(NULL), m_dirty(true), m_reset_count(WrapRenderer::TargetsResetCount())
+	{
+		m_renderer = WrapRenderer::Unwrap(renderer);
+		if (m_texture && m_renderer) { m_hold_renderer.Reset(renderer); m_renderer->AddTexture(this); }
+	}
+	~WrapTexture() { Free(Drop()); }
+public:
+	SDL_Texture* Peek() { return m_texture; }
+	SDL_Texture* Drop()
+	{
+		SDL_Texture* texture = m_texture; m_texture = NULL;
+		Detach();
+		return texture;
+	}
+	void SetLocked(v8::Local<v8::Object> buffer) { m_locked.Reset(buffer); }
+	bool IsDirty() { return m_dirty || (m_reset_count != WrapRenderer::TargetsResetCount()); }
+	void SetDirty() { m_dirty = true; }
+	void SetClean() { m_dirty = false; m_reset_count = WrapRenderer::TargetsResetCount(); }
+	void ReleaseLocked()
+	{
+		if (m_locked.IsEmpty()) { return; }
+		Nan::HandleScope scope;
+		#if NODE_VERSION_AT_LEAST(4, 0, 0)
+		v8::Local<v8::ArrayBuffer> buffer = v8::Local<v8::ArrayBuffer>::Cast(Nan::New<v8::Object>(m_locked));
+		if (buffer->IsNeuterable()) { buffer->Neuter(); } // script must not touch unlocked pixels
+		#endif
+		m_locked.Reset();
+	}
+private:
+	void Detach()
+	{
+		ReleaseLocked();
+		if (m_renderer) { m_renderer->RemoveTexture(this); m_renderer = NULL; }
+		m_hold_renderer.Reset();
+	}
+public:
+	static WrapTexture* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
+	static WrapTexture* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapTexture>(object); }
+	static SDL_Texture* Peek(v8::Local<v8::Value> value) { WrapTexture* wrap = Unwrap(value); return (wrap)?(wrap->Peek()):(NULL); }
+public:
+	static v8::Local<v8::Value> Hold(SDL_Texture* texture, v8::Local<v8::Value> renderer) { return NewInstance(texture, renderer); }
+	static SDL_Texture* Drop(v8::Local<v8::Value> value) { WrapTexture* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
+	static void Free(SDL_Texture* texture)
+	{
+		if (texture) { SDL_DestroyTexture(texture); texture = NULL; }
+	}
+public:
+	static v8::Local<v8::Object> NewInstance(SDL_Texture* texture, v8::Local<v8::Value> renderer)
+	{
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::ObjectTemplate> object_template = GetObjectTemplate();
+		v8::Local<v8::Object> instance = object_template->NewInstance();
+		WrapTexture* wrap = new WrapTexture(texture, renderer);
+		wrap->Wrap(instance);
+		return scope.Escape(instance);
+	}
+private:
+	static v8::Local<v8::ObjectTemplate> GetObjectTemplate()
+	{
+		Nan::EscapableHandleScope scope;
+		static Nan::Persistent<v8::ObjectTemplate> g_object_template;
+		if (g_object_template.IsEmpty())
+		{
+			v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>();
+			g_object_template.Reset(object_template);
+			object_template->SetInternalFieldCount(1);
+		}
+		v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>(g_object_template);
+		return scope.Escape(object_template);
+	}
+};
+
+void WrapRenderer::AddTexture(WrapTexture* texture)
+{
+	texture->m_prev = NULL;
+	texture->m_next = m_textures;
+	if (m_textures) { m_textures->m_prev = texture; }
+	m_textures = texture;
+}
+
+void WrapRenderer::RemoveTexture(WrapTexture* texture)
+{
+	if (texture->m_prev) { texture->m_prev->m_next = texture->m_next; } else if (m_textures == texture) { m_textures = texture->m_next; }
+	if (texture->m_next) { texture->m_next->m_prev = texture->m_prev; }
+	texture->m_prev = texture->m_next = NULL;
+}
+
+void WrapRenderer::InvalidateTextures()
+{
+	while (m_textures)
+	{
+		m_textures->m_texture = NULL; // already destroyed with the renderer
+		m_textures->Detach();
+	}
+	m_layer_depth = 0;
+}
+
+WrapTexture* WrapRenderer::FindTexture(SDL_Texture* texture)
+{
+	for (WrapTexture* wrap = m_textures; wrap; wrap = wrap->m_next)
+	{
+		if (texture && (wrap->m_texture == texture)) { return wrap; }
+	}
+	return NULL;
+}
+
+void WrapRenderer::InvalidateLayers()
+{
+	for (WrapTexture* wrap = m_textures; wrap; wrap = wrap->m_next) { wrap->SetDirty(); }
+}
+
 // wrap SDL_Joystick pointer
 
 class WrapJoystick : public Nan::ObjectWrap
 {
 private:
 	SDL_Joystick* m_joystick;
+	WrapJoystick* m_prev; // open joysticks, in the order they were opened
+	WrapJoystick* m_next;
 public:
-	WrapJoystick(SDL_Joystick* joystick) : m_joystick(joystick) {}
-	~WrapJoystick() { Free(m_joystick); m_joystick = NULL; }
+	WrapJoystick(SDL_Joystick* joystick) : m_joystick(joystick), m_prev(NULL), m_next(NULL) { if (m_joystick) { Link(); } }
+	~WrapJoystick() { Unlink(); Free(m_joystick); m_joystick = NULL; }
 public:
 	SDL_Joystick* Peek() { return m_joystick; }
-	SDL_Joystick* Drop() { SDL_Joystick* joystick = m_joystick; m_joystick = NULL; return joystick; }
+	SDL_Joystick* Drop() { Unlink(); SDL_Joystick* joystick = m_joystick; m_joystick = NULL; return joystick; }
+	WrapJoystick* Next() { return m_next; }
+	static WrapJoystick* First() { return Head(); }
+private:
+	static WrapJoystick*& Head() { static WrapJoystick* g_head = NULL; return g_head; }
+	void Link()
+	{
+		WrapJoystick** link = &Head();
+		while (*link) { m_prev = *link; link = &(*link)->m_next; }
+		*link = this;
+	}
+	void Unlink()
+	{
+		if (m_prev) { m_prev->m_next = m_next; } else if (Head() == this) { Head() = m_next; }
+		if (m_next) { m_next->m_prev = m_prev; }
+		m_prev = m_next = NULL;
+	}
 public:
 	static WrapJoystick* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
 	static WrapJoystick* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapJoystick>(object); }
@@ -900,6 +1433,71 @@ private:
 	}
 };
 
+class WrapGameController : public Nan::ObjectWrap
+{
+private:
+	SDL_GameController* m_gamecontroller;
+	WrapGameController* m_prev; // open game controllers, in the order they were opened
+	WrapGameController* m_next;
+public:
+	WrapGameController(SDL_GameController* gamecontroller) : m_gamecontroller(gamecontroller), m_prev(NULL), m_next(NULL) { if (m_gamecontroller) { Link(); } }
+	~WrapGameController() { Unlink(); Free(m_gamecontroller); m_gamecontroller = NULL; }
+public:
+	SDL_GameController* Peek() { return m_gamecontroller; }
+	SDL_GameController* Drop() { Unlink(); SDL_GameController* gamecontroller = m_gamecontroller; m_gamecontroller = NULL; return gamecontroller; }
+	WrapGameController* Next() { return m_next; }
+	static WrapGameController* First() { return Head(); }
+private:
+	static WrapGameController*& Head() { static WrapGameController* g_head = NULL; return g_head; }
+	void Link()
+	{
+		WrapGameController** link = &Head();
+		while (*link) { m_prev = *link; link = &(*link)->m_next; }
+		*link = this;
+	}
+	void Unlink()
+	{
+		if (m_prev) { m_prev->m_next = m_next; } else if (Head() == this) { Head() = m_next; }
+		if (m_next) { m_next->m_prev = m_prev; }
+		m_prev = m_next = NULL;
+	}
+public:
+	static WrapGameController* Unwrap(v8::Local<v8::Value> value) { return (value->IsObject())?(Unwrap(v8::Local<v8::Object>::Cast(value))):(NULL); }
+	static WrapGameController* Unwrap(v8::Local<v8::Object> object) { return Nan::ObjectWrap::Unwrap<WrapGameController>(object); }
+	static SDL_GameController* Peek(v8::Local<v8::Value> value) { WrapGameController* wrap = Unwrap(value); return (wrap)?(wrap->Peek()):(NULL); }
+public:
+	static v8::Local<v8::Value> Hold(SDL_GameController* gamecontroller) { return NewInstance(gamecontroller); }
+	static SDL_GameController* Drop(v8::Local<v8::Value> value) { WrapGameController* wrap = Unwrap(value); return (wrap)?(wrap->Drop()):(NULL); }
+	static void Free(SDL_GameController* gamecontroller)
+	{
+		if (gamecontroller) { SDL_GameControllerClose(gamecontroller); gamecontroller = NULL; }
+	}
+public:
+	static v8::Local<v8::Object> NewInstance(SDL_GameController* gamecontroller)
+	{
+		Nan::EscapableHandleScope scope;
+		v8::Local<v8::ObjectTemplate> object_template = GetObjectTemplate();
+		v8::Local<v8::Object> instance = object_template->NewInstance();
+		WrapGameController* wrap = new WrapGameController(gamecontroller);
+		wrap->Wrap(instance);
+		return scope.Escape(instance);
+	}
+private:
+	static v8::Local<v8::ObjectTemplate> GetObjectTemplate()
+	{
+		Nan::EscapableHandleScope scope;
+		static Nan::Persistent<v8::ObjectTemplate> g_object_template;
+		if (g_object_template.IsEmpty())
+		{
+			v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>();
+			g_object_template.Reset(object_template);
+			object_template->SetInternalFieldCount(1);
+		}
+		v8::Local<v8::ObjectTemplate> object_template = Nan::New<v8::ObjectTemplate>(g_object_template);
+		return scope.Escape(object_template);
+	}
+};
+
 NAN_MODULE_INIT(init);
 
 } // namespace node_sdl2